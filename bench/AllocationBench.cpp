@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <libcron/Cron.h>
+
+using namespace libcron;
+
+namespace
+{
+    std::atomic<uint64_t> allocations{ 0 };
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+// Inlining the replacement operators makes GCC mistake free() for a mismatch with new.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Counts the allocations of the whole benchmark executable.
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    // Work capturing more than std::function stores inline.
+    struct Work
+    {
+        void operator()(const TaskInformation&) const
+        {
+            benchmark::DoNotOptimize(values);
+        }
+
+        uint64_t values[4] = { 1, 2, 3, 4 };
+    };
+
+    std::map<std::string, std::string> every_day(int64_t count)
+    {
+        std::map<std::string, std::string> res;
+
+        for (int64_t i = 0; i < count; ++i)
+        {
+            res[std::to_string(i)] = "0 0 12 * * ?";
+        }
+
+        return res;
+    }
+
+    void report(benchmark::State& state, uint64_t allocated)
+    {
+        state.counters["allocations_per_task"] = benchmark::Counter(
+                static_cast<double>(allocated) / static_cast<double>(state.range(0)), benchmark::Counter::kAvgIterations);
+    }
+}
+
+// Allocations for the work only, with the names and expressions already in place.
+static void BM_Cron_add_schedule_allocations(benchmark::State& state)
+{
+    auto schedules = every_day(state.range(0));
+    uint64_t allocated = 0;
+
+    for (auto _ : state)
+    {
+        Cron<UTCClock> cron;
+        auto before = allocations.load();
+
+        for (const auto& s : schedules)
+        {
+            cron.add_schedule(s.first, s.second, Work{});
+        }
+
+        allocated += allocations.load() - before;
+    }
+
+    report(state, allocated);
+}
+
+BENCHMARK(BM_Cron_add_schedule_allocations)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_Cron_add_schedules_allocations(benchmark::State& state)
+{
+    auto schedules = every_day(state.range(0));
+    uint64_t allocated = 0;
+
+    for (auto _ : state)
+    {
+        Cron<UTCClock> cron;
+        auto before = allocations.load();
+        cron.add_schedule(schedules, Work{});
+        allocated += allocations.load() - before;
+    }
+
+    report(state, allocated);
+}
+
+BENCHMARK(BM_Cron_add_schedules_allocations)->Arg(100000)->Unit(benchmark::kMillisecond);
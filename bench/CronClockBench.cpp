@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+#include <libcron/CronClock.h>
+
+using namespace libcron;
+
+// Called by Cron::tick() and when adding schedules; LocalClock also looks up the UTC offset each time.
+static void BM_UTCClock_now(benchmark::State& state)
+{
+    UTCClock clock;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(clock.now());
+    }
+}
+
+BENCHMARK(BM_UTCClock_now);
+
+static void BM_LocalClock_now(benchmark::State& state)
+{
+    LocalClock clock;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(clock.now());
+    }
+}
+
+BENCHMARK(BM_LocalClock_now);
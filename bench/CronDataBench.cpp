@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <libcron/CronData.h>
+#include "LegacyCronData.h"
+
+using namespace libcron;
+
+namespace
+{
+    const std::vector<std::string>& expressions()
+    {
+        static const std::vector<std::string> e{
+                "* * * * * ?",
+                "0 0 12 * * MON-FRI",
+                "0 0 12 1/2 * ?",
+                "0 0 */12 ? * *",
+                "0,3,40-50 * * * * ?",
+                "0 0 0 ? JAN-MAR,DEC FRI,MON,THU",
+                "0 5 0 * 8 ?",
+                "@hourly ?"
+        };
+
+        return e;
+    }
+}
+
+static void BM_CronData_parse(benchmark::State& state)
+{
+    const auto& e = expressions();
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CronData::create_uncached(e[i++ % e.size()]));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CronData_parse);
+
+static void BM_LegacyCronData_parse(benchmark::State& state)
+{
+    const auto& e = expressions();
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        LegacyCronData legacy;
+        benchmark::DoNotOptimize(legacy.parse(e[i++ % e.size()]));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LegacyCronData_parse);
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <libcron/CronRandomization.h>
+
+using namespace libcron;
+
+namespace
+{
+    const std::vector<std::string>& expressions()
+    {
+        static const std::vector<std::string> e{
+                "0 0 R(13-20) * * ?",
+                "0 0 0 ? * R(0-6)",
+                "0 R(45-15) */12 ? * *",
+                "0 0 0 ? R(DEC-MAR) R(SAT-SUN)",
+                "R(0-59) R(0-59) R(0-23) R(1-31) R(1-12) ?",
+                "0 0 12 * * MON-FRI"
+        };
+
+        return e;
+    }
+}
+
+static void BM_CronRandomization_parse(benchmark::State& state)
+{
+    const auto& e = expressions();
+    CronRandomization randomization;
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(randomization.parse(e[i++ % e.size()]));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CronRandomization_parse);
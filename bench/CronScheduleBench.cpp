@@ -0,0 +1,161 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <libcron/CronData.h>
+#include <libcron/CronSchedule.h>
+#include "LegacyCronSchedule.h"
+
+using namespace libcron;
+using namespace std::chrono;
+
+namespace
+{
+    // Each expression is benchmarked from a point in time just after an occurrence, i.e. where the search
+    // has to cover the longest distance to find the next one.
+    struct Case
+    {
+        const char* expression;
+        system_clock::time_point from;
+    };
+
+    system_clock::time_point at(date::year_month_day ymd, int h = 0, int m = 0, int s = 0)
+    {
+        return date::sys_days{ ymd } + hours{ h } + minutes{ m } + seconds{ s };
+    }
+
+    const std::vector<Case>& cases()
+    {
+        using namespace date;
+
+        static const std::vector<Case> c{
+                { "* * * * * ?", at(2021_y / 1 / 1) },
+                { "0 0 12 * * MON-FRI", at(2021_y / 1 / 1, 12, 0, 1) },
+                { "59 59 23 31 12 ?", at(2021_y / 1 / 1) },
+                { "59 59 23 ? 2 SAT", at(2021_y / 3 / 1) },
+                { "0 0 0 29 2 ?", at(2096_y / 2 / 29, 0, 0, 1) }
+        };
+
+        return c;
+    }
+
+    template<typename Schedule>
+    void calculate(benchmark::State& state)
+    {
+        const auto& c = cases()[static_cast<size_t>(state.range(0))];
+        auto data = CronData::create_uncached(c.expression);
+        Schedule schedule(data);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(schedule.calculate_from(c.from));
+        }
+
+        state.SetLabel(c.expression);
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+static void BM_CronSchedule_calculate_from(benchmark::State& state)
+{
+    calculate<CronSchedule>(state);
+}
+
+BENCHMARK(BM_CronSchedule_calculate_from)->DenseRange(0, 4);
+
+static void BM_LegacyCronSchedule_calculate_from(benchmark::State& state)
+{
+    calculate<LegacyCronSchedule>(state);
+}
+
+BENCHMARK(BM_LegacyCronSchedule_calculate_from)->DenseRange(0, 4);
+
+static void BM_CronSchedule_calculate_previous(benchmark::State& state)
+{
+    // Searching backwards from just after an occurrence finds it immediately, so search from just before it.
+    const auto& c = cases()[static_cast<size_t>(state.range(0))];
+    auto data = CronData::create_uncached(c.expression);
+    CronSchedule schedule(data);
+    auto to = std::get<1>(schedule.calculate_from(c.from)) - seconds{ 1 };
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(schedule.calculate_previous(to));
+    }
+
+    state.SetLabel(c.expression);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CronSchedule_calculate_previous)->DenseRange(0, 4);
+
+static void BM_CronSchedule_occurrences(benchmark::State& state)
+{
+    const auto& c = cases()[static_cast<size_t>(state.range(0))];
+    auto data = CronData::create_uncached(c.expression);
+    CronSchedule schedule(data);
+
+    for (auto _ : state)
+    {
+        auto count = 0;
+
+        for (auto t : schedule.occurrences(c.from))
+        {
+            benchmark::DoNotOptimize(t);
+
+            if (++count == 1000)
+            {
+                break;
+            }
+        }
+    }
+
+    state.SetLabel(c.expression);
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK(BM_CronSchedule_occurrences)->DenseRange(0, 3);
+
+static void BM_CronSchedule_calculate_from_repeatedly(benchmark::State& state)
+{
+    const auto& c = cases()[static_cast<size_t>(state.range(0))];
+    auto data = CronData::create_uncached(c.expression);
+    CronSchedule schedule(data);
+
+    for (auto _ : state)
+    {
+        auto from = c.from;
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            auto t = std::get<1>(schedule.calculate_from(from));
+            benchmark::DoNotOptimize(t);
+            from = t + seconds{ 1 };
+        }
+    }
+
+    state.SetLabel(c.expression);
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK(BM_CronSchedule_calculate_from_repeatedly)->DenseRange(0, 3);
+
+// Expressions that are valid, but never occur, so that the search gives up only after its limit.
+static void BM_CronSchedule_calculate_from_never(benchmark::State& state)
+{
+    const char* expressions[] = { "0 0 0 30 2 ?", "0 0 0 31 4,6,9,11 ?" };
+    auto expression = expressions[state.range(0)];
+    auto data = CronData::create_uncached(expression);
+    CronSchedule schedule(data);
+    auto from = date::sys_days{ date::year{ 2021 } / 1 / 1 };
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(schedule.calculate_from(from));
+    }
+
+    state.SetLabel(expression);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CronSchedule_calculate_from_never)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
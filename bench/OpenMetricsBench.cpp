@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <libcron/Cron.h>
+#include <libcron/OpenMetrics.h>
+
+using namespace libcron;
+using namespace std::chrono;
+
+namespace
+{
+    class BenchClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return seconds{ 0 };
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = date::sys_days{ date::year{ 2021 } / 1 / 1 };
+    };
+
+    // Renders tasks that have all run, with the default cap on the tasks that get series of their own.
+    void render(benchmark::State& state, size_t max_tasks)
+    {
+        Cron<BenchClock, Locker, HeapTaskQueue> cron;
+        std::map<std::string, std::string> schedules;
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            schedules["task " + std::to_string(i)] = "0 * * * * ?";
+        }
+
+        cron.add_schedule(schedules, [](auto&)
+        {
+        });
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            cron.get_clock().add(minutes{ 1 } + milliseconds{ 10 * i });
+            cron.tick();
+        }
+
+        OpenMetricsExporter exporter{ max_tasks };
+        std::string text;
+
+        for (auto _ : state)
+        {
+            text.clear();
+            exporter.render(cron, text);
+            benchmark::DoNotOptimize(text.data());
+        }
+
+        state.counters["bytes"] = static_cast<double>(text.size());
+    }
+}
+
+static void BM_OpenMetrics_render(benchmark::State& state)
+{
+    render(state, OpenMetricsExporter::DEFAULT_MAX_TASKS);
+}
+
+BENCHMARK(BM_OpenMetrics_render)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_OpenMetrics_render_uncapped(benchmark::State& state)
+{
+    render(state, std::numeric_limits<size_t>::max());
+}
+
+BENCHMARK(BM_OpenMetrics_render_uncapped)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,498 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <libcron/Cron.h>
+
+using namespace libcron;
+using namespace std::chrono;
+
+namespace
+{
+    class BenchClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return seconds{ 0 };
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = date::sys_days{ date::year{ 2021 } / 1 / 1 };
+    };
+
+    // Adds tasks that each run once a day at a random time, so that each tick expires about
+    // count / 86400 tasks.
+    template<typename CronType>
+    void add_daily_tasks(CronType& cron, int64_t count)
+    {
+        std::mt19937 twister{ 4711 };
+        std::map<std::string, std::string> schedules;
+
+        for (int64_t i = 0; i < count; ++i)
+        {
+            schedules[std::to_string(i)] = std::to_string(twister() % 60) + " "
+                                           + std::to_string(twister() % 60) + " "
+                                           + std::to_string(twister() % 24) + " * * ?";
+        }
+
+        cron.add_schedule(schedules, [](auto&)
+        {
+        });
+    }
+
+    // Adds tasks using a handful of distinct expressions, most of them expiring each minute.
+    template<typename CronType>
+    void add_minutely_tasks(CronType& cron, int64_t count)
+    {
+        const char* expressions[] = { "0 * * * * ?", "30 * * * * ?", "0 */5 * * * ?", "0 0 * * * ?" };
+        std::map<std::string, std::string> schedules;
+
+        for (int64_t i = 0; i < count; ++i)
+        {
+            schedules[std::to_string(i)] = expressions[i % 4];
+        }
+
+        cron.add_schedule(schedules, [](auto&)
+        {
+        });
+    }
+
+    template<template<typename> class QueueType>
+    void tick(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        add_daily_tasks(cron, state.range(0));
+        size_t expired = 0;
+
+        for (auto _ : state)
+        {
+            cron.get_clock().add(seconds{ 1 });
+            expired += cron.tick();
+        }
+
+        state.counters["expired"] = benchmark::Counter(static_cast<double>(expired), benchmark::Counter::kAvgIterations);
+    }
+
+    // Ticks each half minute, when most tasks expire together.
+    template<template<typename> class QueueType, typename HookType = NullHooks>
+    void tick_shared(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType, InlineExecutor, HookType> cron;
+        add_minutely_tasks(cron, state.range(0));
+        size_t expired = 0;
+
+        for (auto _ : state)
+        {
+            cron.get_clock().add(seconds{ 30 });
+            expired += cron.tick();
+        }
+
+        state.counters["expired"] = benchmark::Counter(static_cast<double>(expired), benchmark::Counter::kAvgIterations);
+    }
+
+    // Ticks each second, with range(0) tasks of which range(1) expire each second and the others once a year.
+    template<template<typename> class QueueType>
+    void tick_density(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        std::map<std::string, std::string> schedules;
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            schedules[std::to_string(i)] = i < state.range(1) ? "* * * * * ?" : "0 0 12 1 6 ?";
+        }
+
+        cron.add_schedule(schedules, [](auto&)
+        {
+        });
+
+        size_t expired = 0;
+
+        for (auto _ : state)
+        {
+            cron.get_clock().add(seconds{ 1 });
+            expired += cron.tick();
+        }
+
+        state.counters["expired"] = benchmark::Counter(static_cast<double>(expired), benchmark::Counter::kAvgIterations);
+    }
+
+    void densities(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "tasks", "due" });
+
+        for (auto due : { 0, 100, 1000, 10000, 100000 })
+        {
+            b->Args({ 100000, due });
+        }
+
+        b->Unit(benchmark::kMicrosecond);
+    }
+
+    // As tick_shared(), recording the expiries and runs of the tasks.
+    template<template<typename> class QueueType>
+    void tick_shared_traced(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        cron.set_trace_recorder(std::make_shared<TraceRecorder>());
+        add_minutely_tasks(cron, state.range(0));
+        size_t expired = 0;
+
+        for (auto _ : state)
+        {
+            cron.get_clock().add(seconds{ 30 });
+            expired += cron.tick();
+        }
+
+        state.counters["expired"] = benchmark::Counter(static_cast<double>(expired), benchmark::Counter::kAvgIterations);
+    }
+
+    // As tick(), with a reader taking a snapshot after each tick.
+    template<template<typename> class QueueType>
+    void tick_snapshot(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        add_daily_tasks(cron, state.range(0));
+        size_t tasks = 0;
+
+        for (auto _ : state)
+        {
+            cron.get_clock().add(seconds{ 1 });
+            cron.tick();
+            tasks += cron.get_snapshot()->tasks.size();
+        }
+
+        benchmark::DoNotOptimize(tasks);
+    }
+
+    template<template<typename> class QueueType>
+    void add_remove(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        add_daily_tasks(cron, state.range(0));
+
+        for (auto _ : state)
+        {
+            cron.add_schedule("extra", "30 30 12 * * ?", [](auto&)
+            {
+            });
+            cron.remove_schedule("extra");
+        }
+    }
+
+    // As add_remove(), removing the task through its handle.
+    template<template<typename> class QueueType>
+    void add_remove_handle(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        add_daily_tasks(cron, state.range(0));
+
+        for (auto _ : state)
+        {
+            auto handle = cron.add_schedule_handle("extra", "30 30 12 * * ?", [](auto&)
+            {
+            });
+            cron.remove_schedule(handle);
+        }
+    }
+
+    // Pauses and resumes a tenth of the tasks, using a tag.
+    template<template<typename> class QueueType>
+    void pause_resume_tagged(benchmark::State& state)
+    {
+        Cron<BenchClock, NullLock, QueueType> cron;
+        std::mt19937 twister{ 4711 };
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            auto handle = cron.add_schedule_handle(std::to_string(i), std::to_string(twister() % 60) + " "
+                                                               + std::to_string(twister() % 60) + " "
+                                                               + std::to_string(twister() % 24) + " * * ?",
+                                            [](auto&)
+                                            {
+                                            });
+
+            if (i % 10 == 0)
+            {
+                cron.tag_schedule(handle, "tagged");
+            }
+        }
+
+        for (auto _ : state)
+        {
+            cron.pause_tagged("tagged");
+            cron.resume_tagged("tagged");
+        }
+    }
+
+    // Adds tasks that all use the same expression, and so share their expiry.
+    template<typename CronType>
+    void add_shared_tasks(CronType& cron, int64_t count)
+    {
+        std::map<std::string, std::string> schedules;
+
+        for (int64_t i = 0; i < count; ++i)
+        {
+            schedules[std::to_string(i)] = "0 * * * * ?";
+        }
+
+        cron.add_schedule(schedules, [](auto&)
+        {
+        });
+    }
+
+    // Removes a tenth of the tasks, in random order.
+    template<template<typename> class QueueType>
+    void bulk_remove(benchmark::State& state, bool shared = false)
+    {
+        auto count = state.range(0);
+        std::mt19937 twister{ 4711 };
+        std::vector<std::string> names;
+
+        for (int64_t i = 0; i < count / 10; ++i)
+        {
+            names.push_back(std::to_string(twister() % static_cast<uint32_t>(count)));
+        }
+
+        Cron<BenchClock, NullLock, QueueType> cron;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            cron.clear_schedules();
+
+            if (shared)
+            {
+                add_shared_tasks(cron, count);
+            }
+            else
+            {
+                add_daily_tasks(cron, count);
+            }
+
+            state.ResumeTiming();
+
+            for (const auto& name : names)
+            {
+                cron.remove_schedule(name);
+            }
+        }
+    }
+}
+
+static void BM_TaskQueue_tick(benchmark::State& state)
+{
+    tick<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_tick)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_tick(benchmark::State& state)
+{
+    tick<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TimingWheelQueue_tick(benchmark::State& state)
+{
+    tick<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_tick)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_tick_shared(benchmark::State& state)
+{
+    tick_shared<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_tick_shared)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_tick_shared(benchmark::State& state)
+{
+    tick_shared<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_shared)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TimingWheelQueue_tick_shared(benchmark::State& state)
+{
+    tick_shared<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_tick_shared)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_tick_density(benchmark::State& state)
+{
+    tick_density<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_tick_density)->Apply(densities);
+
+static void BM_HeapTaskQueue_tick_density(benchmark::State& state)
+{
+    tick_density<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_density)->Apply(densities);
+
+static void BM_TimingWheelQueue_tick_density(benchmark::State& state)
+{
+    tick_density<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_tick_density)->Apply(densities);
+
+static void BM_HeapTaskQueue_tick_shared_traced(benchmark::State& state)
+{
+    tick_shared_traced<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_shared_traced)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+// The cost of timing the phases of ticks, compared to BM_HeapTaskQueue_tick_shared
+static void BM_HeapTaskQueue_tick_shared_steady_timing(benchmark::State& state)
+{
+    tick_shared<HeapTaskQueue, TimingHooks<SteadyTicks>>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_shared_steady_timing)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_tick_shared_cycle_timing(benchmark::State& state)
+{
+    tick_shared<HeapTaskQueue, TimingHooks<CycleTicks>>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_shared_cycle_timing)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_tick_snapshot(benchmark::State& state)
+{
+    tick_snapshot<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_tick_snapshot)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_tick_snapshot(benchmark::State& state)
+{
+    tick_snapshot<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_tick_snapshot)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_add_remove(benchmark::State& state)
+{
+    add_remove<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_add_remove)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_add_remove(benchmark::State& state)
+{
+    add_remove<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_add_remove)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TimingWheelQueue_add_remove(benchmark::State& state)
+{
+    add_remove<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_add_remove)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_add_remove_handle(benchmark::State& state)
+{
+    add_remove_handle<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_add_remove_handle)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_HeapTaskQueue_add_remove_handle(benchmark::State& state)
+{
+    add_remove_handle<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_add_remove_handle)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TimingWheelQueue_add_remove_handle(benchmark::State& state)
+{
+    add_remove_handle<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_add_remove_handle)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_TaskQueue_pause_resume_tagged(benchmark::State& state)
+{
+    pause_resume_tagged<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_pause_resume_tagged)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_HeapTaskQueue_pause_resume_tagged(benchmark::State& state)
+{
+    pause_resume_tagged<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_pause_resume_tagged)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TimingWheelQueue_pause_resume_tagged(benchmark::State& state)
+{
+    pause_resume_tagged<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_pause_resume_tagged)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TaskQueue_bulk_remove(benchmark::State& state)
+{
+    bulk_remove<TaskQueue>(state);
+}
+
+BENCHMARK(BM_TaskQueue_bulk_remove)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_HeapTaskQueue_bulk_remove(benchmark::State& state)
+{
+    bulk_remove<HeapTaskQueue>(state);
+}
+
+BENCHMARK(BM_HeapTaskQueue_bulk_remove)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TimingWheelQueue_bulk_remove(benchmark::State& state)
+{
+    bulk_remove<TimingWheelQueue>(state);
+}
+
+BENCHMARK(BM_TimingWheelQueue_bulk_remove)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TaskQueue_bulk_remove_shared(benchmark::State& state)
+{
+    bulk_remove<TaskQueue>(state, true);
+}
+
+BENCHMARK(BM_TaskQueue_bulk_remove_shared)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_HeapTaskQueue_bulk_remove_shared(benchmark::State& state)
+{
+    bulk_remove<HeapTaskQueue>(state, true);
+}
+
+BENCHMARK(BM_HeapTaskQueue_bulk_remove_shared)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TimingWheelQueue_bulk_remove_shared(benchmark::State& state)
+{
+    bulk_remove<TimingWheelQueue>(state, true);
+}
+
+BENCHMARK(BM_TimingWheelQueue_bulk_remove_shared)->RangeMultiplier(10)->Range(10000, 100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+#include <libcron/TraceRecorder.h>
+
+using namespace libcron;
+using namespace std::chrono;
+
+static void BM_TraceRecorder_record(benchmark::State& state)
+{
+    TraceRecorder recorder;
+    std::string name = "refresh-customer-cache";
+    auto now = steady_clock::now();
+
+    for (auto _ : state)
+    {
+        recorder.record_run(name, now, microseconds{ 150 }, milliseconds{ 2 });
+    }
+
+    benchmark::DoNotOptimize(recorder.get_recorded());
+}
+
+BENCHMARK(BM_TraceRecorder_record);
+
+// Writes a full ring of the given size.
+static void BM_TraceRecorder_write_json(benchmark::State& state)
+{
+    TraceRecorder recorder{ static_cast<size_t>(state.range(0)) };
+    auto now = steady_clock::now();
+
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        recorder.record_run("task " + std::to_string(i), now + microseconds{ i }, microseconds{ 150 },
+                            milliseconds{ 2 });
+    }
+
+    std::string json;
+
+    for (auto _ : state)
+    {
+        json.clear();
+        recorder.write_json(json);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_TraceRecorder_write_json)->RangeMultiplier(16)->Range(1024, 65536)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace libcron
+{
+    // A multi-producer, single-consumer queue. Producers push with a compare-and-swap and never wait for
+    // each other or for the consumer; the consumer takes everything pushed so far in a single exchange.
+    template<typename T>
+    class ChangeQueue
+    {
+        public:
+            ChangeQueue() = default;
+
+            ChangeQueue(const ChangeQueue&) = delete;
+
+            ChangeQueue& operator=(const ChangeQueue&) = delete;
+
+            ~ChangeQueue()
+            {
+                release(head.exchange(nullptr, std::memory_order_acquire));
+            }
+
+            // May be called from any thread.
+            void push(T value)
+            {
+                auto n = new Node{ std::move(value), head.load(std::memory_order_relaxed) };
+
+                while (!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+                {
+                }
+            }
+
+            bool empty() const
+            {
+                return head.load(std::memory_order_relaxed) == nullptr;
+            }
+
+            // Calls f(value) for each value pushed so far, in the order they were pushed. Only one thread
+            // may consume at a time.
+            template<typename Function>
+            void consume(Function&& f)
+            {
+                // The values are linked from the last pushed to the first; reverse them.
+                Node* first = nullptr;
+
+                for (auto n = head.exchange(nullptr, std::memory_order_acquire); n != nullptr;)
+                {
+                    auto next = n->next;
+                    n->next = first;
+                    first = n;
+                    n = next;
+                }
+
+                while (first != nullptr)
+                {
+                    auto next = first->next;
+                    f(first->value);
+                    delete first;
+                    first = next;
+                }
+            }
+
+        private:
+            struct Node
+            {
+                T value;
+                Node* next;
+            };
+
+            static void release(Node* n)
+            {
+                while (n != nullptr)
+                {
+                    auto next = n->next;
+                    delete n;
+                    n = next;
+                }
+            }
+
+            std::atomic<Node*> head{ nullptr };
+    };
+}
@@ -1,15 +1,35 @@
 #pragma once
 
 #include <string>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <map>
+#include <optional>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 #include "Task.h"
+#include "TaskHandle.h"
+#include "TaskMetrics.h"
+#include "TaskTags.h"
 #include "CronClock.h"
+#include "ChangeQueue.h"
 #include "TaskQueue.h"
+#include "HeapTaskQueue.h"
+#include "TimingWheelQueue.h"
+#include "Executor.h"
+#include "Hooks.h"
+#include "Snapshot.h"
+#include "Waiters.h"
+
+#if defined(__cpp_lib_jthread) || (defined(__has_include) && __has_include(<stop_token>) && __cplusplus > 201703L)
+#include <stop_token>
+#endif
 
 namespace libcron
 {
@@ -29,24 +49,151 @@ namespace libcron
             std::recursive_mutex m{};
     };
 
-    template<typename ClockType, typename LockType>
+    // Instead of locking, changes to the schedules are queued without locking and applied by the thread
+    // calling tick(), at the start of each tick. Adding, removing, updating and clearing schedules may be done
+    // from any thread and never waits for tick() or its tasks, nor the other way around. Everything else must
+    // be done on the thread calling tick(), and count() and has_schedule() only reflect the applied changes.
+    class DeferredChanges
+    {
+        public:
+            static constexpr bool defers_changes = true;
+
+            void lock() {}
+            void unlock() {}
+    };
+
+    template<typename LockType, typename = void>
+    struct defers_changes : std::false_type
+    {
+    };
+
+    template<typename LockType>
+    struct defers_changes<LockType, std::void_t<decltype(LockType::defers_changes)>>
+            : std::bool_constant<LockType::defers_changes>
+    {
+    };
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
     class Cron;
 
-    template<typename ClockType, typename LockType>
-    std::ostream& operator<<(std::ostream& stream, const Cron<ClockType, LockType>& c);
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::ostream& operator<<(std::ostream& stream, const Cron<ClockType, LockType, QueueType, ExecutorType, HookType>& c);
 
+    // QueueType holds the tasks ordered by their next expiry; TaskQueue (a sorted vector), HeapTaskQueue or
+    // TimingWheelQueue, the latter two being suitable for large numbers of tasks.
+    // ExecutorType runs the work of expired tasks; InlineExecutor runs it within tick(), ThreadPoolExecutor
+    // on worker threads.
+    // HookType is called at the phases of each tick, see NullHooks; TimingHooks measures where the time goes.
     template<typename ClockType = libcron::LocalClock, 
-             typename LockType = libcron::NullLock>
+             typename LockType = libcron::NullLock,
+             template<typename> class QueueType = libcron::TaskQueue,
+             typename ExecutorType = libcron::InlineExecutor,
+             typename HookType = libcron::NullHooks>
     class Cron
     {
         public:
-            bool add_schedule(std::string name, const std::string& schedule, Task::TaskFunction work);
+            ~Cron()
+            {
+#if defined(LIBCRON_COROUTINES)
+                waiters.destroy();
+#endif
+            }
+
+            // Returns false if the schedule is invalid.
+            bool add_schedule(std::string name, const std::string& schedule, Task::TaskFunction work,
+                              Overlap overlap = Overlap::Skip)
+            {
+                return static_cast<bool>(add_schedule_handle(std::move(name), schedule, std::move(work), overlap));
+            }
+
+            // As the above, returning the handle of the task, which is false if the schedule is invalid. Operations
+            // through the handle find the task in O(1), without comparing names, and never affect another task,
+            // even one with the same name. A schedule that never occurs yields a handle to a task that has already
+            // finished.
+            TaskHandle add_schedule_handle(std::string name, const std::string& schedule, Task::TaskFunction work,
+                                           Overlap overlap = Overlap::Skip);
             
             template<typename Schedules = std::map<std::string, std::string>>
             std::tuple<bool, std::string, std::string>
-            add_schedule(const Schedules& name_schedule_map, Task::TaskFunction work);
+            add_schedule(const Schedules& name_schedule_map, Task::TaskFunction work, Overlap overlap = Overlap::Skip);
             void clear_schedules();
             void remove_schedule(const std::string& name);
+            bool has_schedule(const std::string& name) const;
+
+            // Replaces the schedule of an existing task, keeping its work. Returns false if the schedule is
+            // invalid or there is no task with the given name.
+            bool update_schedule(const std::string& name, const std::string& schedule);
+
+            // As the above, for the task with the given handle. With DeferredChanges, whether the task exists is
+            // only known once the change has been applied, so these return true for any handle that is not false.
+            bool remove_schedule(TaskHandle handle);
+
+            bool update_schedule(TaskHandle handle, const std::string& schedule);
+
+            // Stops the task from expiring until it is resumed, keeping its work and state. Returns false if there
+            // is no such task or it is already paused.
+            bool pause_schedule(TaskHandle handle);
+
+            // Lets a paused task expire again, calculating its next occurrence from now on, as when adding it; the
+            // occurrences while it was paused are skipped. A task whose schedule no longer occurs is removed.
+            // Returns false if there is no such task or it is not paused.
+            bool resume_schedule(TaskHandle handle);
+
+            bool has_schedule(TaskHandle handle) const;
+
+            // Adds the task to the tasks with the given tag; a task may have several tags. Returns false if there is
+            // no such task.
+            bool tag_schedule(TaskHandle handle, const std::string& tag);
+
+            // Pauses or resumes all tasks with the given tag, as pause_schedule and resume_schedule do, without
+            // searching the other tasks. Resuming calculates the next expiry of tasks sharing a schedule once,
+            // and puts them back in order at once. Return the number of tasks paused or resumed; with
+            // DeferredChanges, 0 as the change is yet to be applied.
+            size_t pause_tagged(const std::string& tag);
+
+            size_t resume_tagged(const std::string& tag);
+
+            // The state of the task, or nothing if there is no such task.
+            std::optional<TaskStatus> get_status(TaskHandle handle) const;
+
+            // The metrics of the runs of the task, or nothing if there is no such task. They are kept for every
+            // task: runs, skipped runs, runs after missed occurrences, and histograms of the delay of runs and
+            // the time they took.
+            std::optional<MetricsSummary> get_metrics(TaskHandle handle) const;
+
+            // The metrics of all tasks added together.
+            MetricsSummary get_metrics() const;
+
+            // The metrics of all runs of all tasks, including those that have since been removed. Unlike the above,
+            // these only ever grow, as counters exported to monitoring systems should.
+            const TaskMetrics& get_totals() const
+            {
+                return executor.get_totals();
+            }
+
+            // The time taken by tick(), while the tasks are locked.
+            const TickMetrics& get_tick_metrics() const
+            {
+                return tick_metrics;
+            }
+
+            // Calls f(task, metrics) for every task that has expired at least once, for instance to find the tasks
+            // that are often late. The tasks are locked while doing so.
+            template<typename Function>
+            void for_each_metrics(Function&& f) const
+            {
+                tasks.lock_queue();
+                tasks.for_each([&f](const Task& t)
+                               {
+                                   if (t.get_metrics())
+                                   {
+                                       f(t, *t.get_metrics());
+                                   }
+                               });
+                tasks.release_queue();
+            }
 
             size_t count() const
             {
@@ -57,72 +204,376 @@ namespace libcron
             size_t
             tick()
             {
-                return tick(clock.now());
+                hooks.on_tick_begin();
+                auto now = clock.now();
+                hooks.on_clock_read(now);
+                return tick_at(now);
             }
 
             size_t
-            tick(std::chrono::system_clock::time_point now);
+            tick(std::chrono::system_clock::time_point now)
+            {
+                hooks.on_tick_begin();
+                hooks.on_clock_read(now);
+                return tick_at(now);
+            }
+
+            // Calls tick() whenever a task is due until stop() is called, sleeping in between. Adding,
+            // removing or updating schedules from another thread wakes the loop to recalculate its deadline.
+            void run()
+            {
+                run_until(std::chrono::system_clock::time_point::max());
+            }
+
+            // As run(), but also returns once the clock reaches 'end'.
+            void run_until(std::chrono::system_clock::time_point end);
+
+#if defined(__cpp_lib_jthread)
+            void run(std::stop_token token)
+            {
+                std::stop_callback on_stop(token, [this]()
+                                                  {
+                                                      stop();
+                                                  });
+                run();
+            }
+#endif
+
+            // Makes run() and run_until() return; if neither is running, the next call returns immediately.
+            void stop();
 
             std::chrono::system_clock::duration
             time_until_next() const;
 
+            // When, according to the system clock, the next task expires; this is on a whole second for
+            // clocks following the system clock. time_point::max() when there are no tasks.
+            std::chrono::system_clock::time_point
+            get_next_wakeup();
+
+            // Called after schedules have been added, removed or updated, to let event loops waiting for
+            // get_next_wakeup() know that it may have changed. Pass an empty function to remove it. The listener may
+            // be called on any thread changing schedules, but is not guarded: set or remove it only while no other
+            // thread uses the instance.
+            void set_change_listener(std::function<void()> listener)
+            {
+                change_listener = std::move(listener);
+            }
+
+            // Records expiries and runs of tasks into the recorder, which may then be written out from any thread
+            // without stopping tick(); see TraceRecorder. Pass nullptr to stop recording. Locks the tasks.
+            void set_trace_recorder(std::shared_ptr<TraceRecorder> recorder)
+            {
+                tasks.lock_queue();
+                executor.set_trace_recorder(std::move(recorder));
+                tasks.release_queue();
+            }
+
             ClockType& get_clock()
             {
                 return clock;
             }
 
+            ExecutorType& get_executor()
+            {
+                return executor;
+            }
+
+            HookType& get_hooks()
+            {
+                return hooks;
+            }
+
+            const HookType& get_hooks() const
+            {
+                return hooks;
+            }
+
             void recalculate_schedule()
             {
-                for (auto& t : tasks.get_tasks())
+                auto now = clock.now();
+
+                tasks.lock_queue();
+                tasks.recalculate(now, [this, &now](Task& t)
+                                       {
+                                           using namespace std::chrono_literals;
+                                           // Ensure that next schedule is in the future
+                                           return reschedule(t, now + 1s);
+                                       });
+                snapshot_stale = true;
+                tasks.release_queue();
+                notify_change();
+            }
+
+#if defined(LIBCRON_COROUTINES)
+            // Awaitable suspending the calling coroutine until the next occurrence of the schedule after the
+            // current second, when the resumer is called with its handle from within tick(). co_await yields
+            // a tuple of whether an occurrence was found and its time point. Waiting does not allocate.
+            // Coroutines still waiting when the instance is destroyed are destroyed along with it. With
+            // DeferredChanges, await and destroy waiting coroutines on the thread calling tick().
+            template<typename Resumer = InlineResumer>
+            NextOccurrence<Cron, Resumer> next(const CronSchedule& schedule, Resumer resumer = {})
+            {
+                return NextOccurrence<Cron, Resumer>{ *this, schedule, std::move(resumer) };
+            }
+
+            // As above; an invalid expression resumes the coroutine immediately, without an occurrence.
+            template<typename Resumer = InlineResumer>
+            NextOccurrence<Cron, Resumer> next(const std::string& expression, Resumer resumer = {})
+            {
+                auto data = CronData::create(expression);
+                return NextOccurrence<Cron, Resumer>{ *this, CronSchedule{ data }, std::move(resumer), data.is_valid() };
+            }
+
+            // Used by NextOccurrence
+            void add_waiter(Waiter& w)
+            {
+                tasks.lock_queue();
+                waiters.add(w);
+                tasks.release_queue();
+                notify_change();
+            }
+
+            void remove_waiter(Waiter& w)
+            {
+                tasks.lock_queue();
+                waiters.remove(w);
+                tasks.release_queue();
+            }
+#endif
+
+            // Returns the latest snapshot of the tasks, without locking them. May be called from any thread.
+            //
+            // Snapshots are only taken once this has been called; the first call returns an empty snapshot and
+            // wakes run() or the TimerFd to take one. After that, a new snapshot is taken at the end of each tick
+            // that changed the tasks and, with run(), whenever the schedules change. The order of the tasks in a
+            // snapshot only changes when tasks are added, removed, updated or paused.
+            std::shared_ptr<const Snapshot> get_snapshot()
+            {
+                if (!snapshots_enabled.exchange(true))
                 {
-                    using namespace std::chrono_literals;
-                    // Ensure that next schedule is in the future
-                    t.calculate_next(clock.now() + 1s);
+                    notify_change();
                 }
+
+                return snapshots.load();
             }
 
+            // These lock the tasks, and so wait for a running tick; see get_snapshot() for an alternative.
             void get_time_until_expiry_for_tasks(
                     std::vector<std::tuple<std::string, std::chrono::system_clock::duration>>& status) const;
 
-            friend std::ostream& operator<<<>(std::ostream& stream, const Cron<ClockType, LockType>& c);
+            friend std::ostream& operator<<<>(std::ostream& stream, const Cron<ClockType, LockType, QueueType, ExecutorType, HookType>& c);
 
         private:
-            TaskQueue<LockType> tasks{};
+            struct Change
+            {
+                enum class Kind
+                {
+                    Add,
+                    Remove,
+                    Update,
+                    Pause,
+                    Resume,
+                    Tag,
+                    PauseTagged,
+                    ResumeTagged,
+                    Clear
+                };
+
+                Kind kind;
+                std::vector<Task> tasks{};
+                // The task to change is given by its handle, or by its name if the handle is false. The name is
+                // the tag for the changes of tagged tasks.
+                TaskHandle handle{};
+                std::string name{};
+                std::optional<CronSchedule> schedule{};
+            };
+
+            // Changes are queued rather than applied when made by the tasks themselves during tick(), or
+            // always with DeferredChanges.
+            bool defer_change() const
+            {
+                return defers_changes<LockType>::value || ticking.load() == std::this_thread::get_id();
+            }
+
+            void apply(Change& change);
+
+            // Applies the queued changes; the tasks must be locked.
+            void apply_changes()
+            {
+                changes.consume([this](Change& c)
+                                {
+                                    apply(c);
+                                });
+            }
+
+            void notify_change();
+
+            // Calculates the next expiry of a task, releasing its handle when there is none as the task is then
+            // removed by the queue; the tasks must be locked.
+            bool reschedule(Task& t, std::chrono::system_clock::time_point from)
+            {
+                bool res = t.calculate_next(from);
+
+                if (!res)
+                {
+                    handles.release(t.get_handle());
+                }
+
+                return res;
+            }
+
+            // Updates the task with the given handle, or name if the handle is false; the tasks must be locked.
+            bool update(TaskHandle handle, const std::string& name, const CronSchedule& schedule);
+
+            void removed(TaskHandle handle)
+            {
+                if (handle)
+                {
+                    handles.release(handle);
+                }
+            }
+
+            // These apply the changes of tagged tasks; the tasks must be locked.
+            bool tag(TaskHandle handle, const std::string& tag);
+
+            size_t pause_tagged_tasks(const std::string& tag);
+
+            size_t resume_tagged_tasks(const std::string& tag);
+
+            // Makes the task share its schedule with the other tasks with an identical schedule; the tasks must
+            // be locked.
+            void share_schedule(Task& t)
+            {
+                t.set_schedule(shared_schedules.get(t.get_schedule()));
+            }
+
+            // Publishes a snapshot if one is wanted and the tasks have changed since the last one; the tasks
+            // must be locked.
+            void publish_snapshot(std::chrono::system_clock::time_point now);
+
+            // Writes the state of all tasks into 's', at the positions of the last layout unless the tasks are to
+            // be laid out anew.
+            void write_snapshot(Snapshot& s, bool layout);
+
+            // Brings 's', published before the last snapshot, up to date by writing only the tasks that ran
+            // since. Returns false if a task is no longer there.
+            bool update_snapshot(Snapshot& s) const;
+
+            static void copy_to(TaskSnapshot& s, const Task& t)
+            {
+                s.name.assign(t.get_name());
+                s.next = t.get_next_schedule();
+                s.last_run = t.get_last_run();
+                s.delay = t.get_delay();
+                s.paused = t.is_paused();
+            }
+
+            size_t tick_at(std::chrono::system_clock::time_point now);
+
+            // The time until the first task or waiting coroutine expires. Returns false if there are none.
+            bool time_until_first(std::chrono::system_clock::time_point now, std::chrono::system_clock::duration& d) const;
+
+            QueueType<LockType> tasks{};
+            ChangeQueue<Change> changes{};
+            SharedSchedules shared_schedules{};
+            // Identifies the next task added; changes may be made from several threads.
+            std::atomic<uint64_t> next_id{ 1 };
+            TaskHandles handles{};
+            TaskTags tags{};
+            // The thread running tick(), if any
+            std::atomic<std::thread::id> ticking{};
+#if defined(LIBCRON_COROUTINES)
+            Waiters waiters{};
+#endif
             ClockType clock{};
             bool first_tick = true;
             std::chrono::system_clock::time_point last_tick{};
+            // Wakes run() early when schedules change or it is to stop. Changes only take the mutex to wake
+            // run() while it sleeps.
+            std::mutex run_mutex{};
+            std::condition_variable run_condition{};
+            std::atomic<bool> schedules_changed{ false };
+            std::atomic<bool> run_sleeping{ false };
+            bool stop_requested = false;
+            std::function<void()> change_listener{};
+            SnapshotPublisher snapshots{};
+            std::atomic<bool> snapshots_enabled{ false };
+            // Set when tasks have been added, removed or moved, for the next snapshot to be written in full.
+            std::atomic<bool> snapshot_stale{ true };
+            // The tasks that ran since the last snapshot, and those that ran before that one, which is what a
+            // recycled snapshot lacks.
+            std::vector<TaskHandle> snapshot_changes{};
+            std::vector<TaskHandle> previous_snapshot_changes{};
+            // Where each task is in the snapshots since the last layout, by the index of its handle
+            std::vector<uint32_t> snapshot_positions{};
+            uint64_t snapshot_version = 0;
+            // The version of the last snapshot for which the tasks were laid out, after tasks were added or removed
+            uint64_t snapshot_layout = 0;
+            TickMetrics tick_metrics{};
+            HookType hooks{};
+            // Last, so that running work finishes before the tasks are destroyed.
+            ExecutorType executor{};
     };
     
-    template<typename ClockType, typename LockType>
-    bool Cron<ClockType, LockType>::add_schedule(std::string name, const std::string& schedule, Task::TaskFunction work)
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    TaskHandle Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::add_schedule_handle(std::string name,
+                                                                                           const std::string& schedule,
+                                                                                           Task::TaskFunction work,
+                                                                                           Overlap overlap)
     {
         auto cron = CronData::create(schedule);
-        bool res = cron.is_valid();
-        if (res)
+        TaskHandle res{};
+        if (cron.is_valid())
         {
-            tasks.lock_queue();
-            Task t{std::move(name), CronSchedule{cron}, work };
-            if (t.calculate_next(clock.now()))
+            Task t{std::move(name), CronSchedule{cron}, std::move(work), overlap };
+            t.set_id(next_id++);
+            res = handles.allocate();
+            t.set_handle(res);
+            if (!t.calculate_next(clock.now()))
             {
-                tasks.push(t);
-                tasks.sort();
+                handles.release(res);
             }
-            tasks.release_queue();
+            else
+            {
+                if (defer_change())
+                {
+                    Change c{ Change::Kind::Add };
+                    c.tasks.push_back(std::move(t));
+                    changes.push(std::move(c));
+                }
+                else
+                {
+                    tasks.lock_queue();
+                    share_schedule(t);
+                    tasks.push(t);
+                    snapshot_stale = true;
+                    tasks.release_queue();
+                }
+            }
+            notify_change();
         }
 
         return res;
     }
 
-    template<typename ClockType, typename LockType>
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
     template<typename Schedules>
     std::tuple<bool, std::string, std::string>
-    Cron<ClockType, LockType>::add_schedule(const Schedules& name_schedule_map, Task::TaskFunction work)
+    Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::add_schedule(const Schedules& name_schedule_map,
+                                                                              Task::TaskFunction work, Overlap overlap)
     {
         bool is_valid = true;
         std::tuple<bool, std::string, std::string> res{false, "", ""};
 
         std::vector<Task> tasks_to_add;
         tasks_to_add.reserve(name_schedule_map.size());
+        // The tasks refer to a single copy of the work.
+        SharedTaskFunction shared_work{ std::move(work) };
+        // Tasks with identical schedules calculate their first expiry once.
+        SharedSchedules added_schedules;
+        auto now = clock.now();
 
         for (auto it = name_schedule_map.begin(); is_valid && it != name_schedule_map.end(); ++it)
         {
@@ -131,8 +582,9 @@ namespace libcron
             is_valid = cron.is_valid();
             if (is_valid)
             {
-                Task t{std::move(name), CronSchedule{cron}, work };
-                if (t.calculate_next(clock.now()))
+                Task t{std::move(name), added_schedules.get(CronSchedule{cron}), shared_work, overlap };
+                t.set_id(next_id++);
+                if (t.calculate_next(now))
                 {
                     tasks_to_add.push_back(std::move(t));
                 }
@@ -147,48 +599,554 @@ namespace libcron
         // Only add tasks and sort once if all elements in the map where valid
         if (is_valid && tasks_to_add.size() > 0)
         {
-            tasks.lock_queue();
-            tasks.push(tasks_to_add);
-            tasks.sort();
-            tasks.release_queue();
+            for (auto& t : tasks_to_add)
+            {
+                t.set_handle(handles.allocate());
+            }
+
+            if (defer_change())
+            {
+                changes.push(Change{ Change::Kind::Add, std::move(tasks_to_add) });
+            }
+            else
+            {
+                tasks.lock_queue();
+                for (auto& t : tasks_to_add)
+                {
+                    share_schedule(t);
+                }
+                tasks.push(tasks_to_add);
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
         }
 
         std::get<0>(res) = is_valid;
         return res;
     }
 
-    template<typename ClockType, typename LockType>
-    void Cron<ClockType, LockType>::clear_schedules()
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::clear_schedules()
     {
-        tasks.clear();
+        if (defer_change())
+        {
+            changes.push(Change{ Change::Kind::Clear });
+        }
+        else
+        {
+            tasks.lock_queue();
+            tasks.for_each([this](const Task& t)
+                           {
+                               handles.release(t.get_handle());
+                           });
+            tasks.clear();
+            tags.clear();
+            snapshot_stale = true;
+            tasks.release_queue();
+        }
+        notify_change();
     }
     
-    template<typename ClockType, typename LockType>
-    void Cron<ClockType, LockType>::remove_schedule(const std::string& name)
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::remove_schedule(const std::string& name)
     {
-        tasks.remove(name);
+        if (defer_change())
+        {
+            Change c{ Change::Kind::Remove };
+            c.name = name;
+            changes.push(std::move(c));
+        }
+        else
+        {
+            tasks.lock_queue();
+            removed(tasks.remove(name));
+            snapshot_stale = true;
+            tasks.release_queue();
+        }
+        notify_change();
     }
 
-    template<typename ClockType, typename LockType>
-    std::chrono::system_clock::duration Cron<ClockType, LockType>::time_until_next() const
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::has_schedule(const std::string& name) const
     {
-        std::chrono::system_clock::duration d{};
-        if (tasks.empty())
+        return tasks.contains(name);
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::update_schedule(const std::string& name, const std::string& schedule)
+    {
+        auto cron = CronData::create(schedule);
+        bool res = cron.is_valid();
+        if (res)
         {
-            d = std::numeric_limits<std::chrono::minutes>::max();
+            Change c{ Change::Kind::Update };
+            c.name = name;
+            c.schedule.emplace(cron);
+
+            if (defer_change())
+            {
+                // Whether the task exists is only known once the change is applied.
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                res = update(TaskHandle{}, name, *c.schedule);
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::update(TaskHandle handle, const std::string& name,
+                                                                              const CronSchedule& schedule)
+    {
+        auto f = [this, &schedule, now = clock.now()](Task& t)
+                 {
+                     t.set_schedule(shared_schedules.get(schedule));
+                     // A task whose new schedule never occurs is removed, as it would never run again.
+                     return reschedule(t, now);
+                 };
+
+        return handle ? tasks.update(handle, f) : tasks.update(name, f);
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::remove_schedule(TaskHandle handle)
+    {
+        bool res = static_cast<bool>(handle);
+
+        if (res)
+        {
+            if (defer_change())
+            {
+                Change c{ Change::Kind::Remove };
+                c.handle = handle;
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                auto removed_handle = tasks.remove(handle);
+                removed(removed_handle);
+                res = static_cast<bool>(removed_handle);
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::update_schedule(TaskHandle handle, const std::string& schedule)
+    {
+        auto cron = CronData::create(schedule);
+        bool res = handle && cron.is_valid();
+        if (res)
+        {
+            Change c{ Change::Kind::Update };
+            c.handle = handle;
+            c.schedule.emplace(cron);
+
+            if (defer_change())
+            {
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                res = update(handle, c.name, *c.schedule);
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::pause_schedule(TaskHandle handle)
+    {
+        bool res = static_cast<bool>(handle);
+
+        if (res)
+        {
+            if (defer_change())
+            {
+                Change c{ Change::Kind::Pause };
+                c.handle = handle;
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                res = tasks.pause(handle);
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::resume_schedule(TaskHandle handle)
+    {
+        bool res = static_cast<bool>(handle);
+
+        if (res)
+        {
+            if (defer_change())
+            {
+                Change c{ Change::Kind::Resume };
+                c.handle = handle;
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                res = tasks.resume(handle, [this, now = clock.now()](Task& t)
+                                           {
+                                               return reschedule(t, now);
+                                           });
+                snapshot_stale = true;
+                tasks.release_queue();
+            }
+            notify_change();
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::has_schedule(TaskHandle handle) const
+    {
+        tasks.lock_queue();
+        bool res = tasks.find(handle) != nullptr;
+        tasks.release_queue();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::tag_schedule(TaskHandle handle, const std::string& tag_name)
+    {
+        bool res = static_cast<bool>(handle);
+
+        if (res)
+        {
+            if (defer_change())
+            {
+                Change c{ Change::Kind::Tag };
+                c.handle = handle;
+                c.name = tag_name;
+                changes.push(std::move(c));
+            }
+            else
+            {
+                tasks.lock_queue();
+                res = tag(handle, tag_name);
+                tasks.release_queue();
+            }
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    size_t Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::pause_tagged(const std::string& tag_name)
+    {
+        size_t res = 0;
+
+        if (defer_change())
+        {
+            Change c{ Change::Kind::PauseTagged };
+            c.name = tag_name;
+            changes.push(std::move(c));
+        }
+        else
+        {
+            tasks.lock_queue();
+            res = pause_tagged_tasks(tag_name);
+            snapshot_stale = true;
+            tasks.release_queue();
+        }
+        notify_change();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    size_t Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::resume_tagged(const std::string& tag_name)
+    {
+        size_t res = 0;
+
+        if (defer_change())
+        {
+            Change c{ Change::Kind::ResumeTagged };
+            c.name = tag_name;
+            changes.push(std::move(c));
         }
         else
         {
-            d = tasks.top().time_until_expiry(clock.now());
+            tasks.lock_queue();
+            res = resume_tagged_tasks(tag_name);
+            snapshot_stale = true;
+            tasks.release_queue();
+        }
+        notify_change();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::tag(TaskHandle handle, const std::string& tag_name)
+    {
+        bool res = tasks.find(handle) != nullptr;
+
+        if (res)
+        {
+            tags.add(tag_name, handle, [this](TaskHandle h)
+                                       {
+                                           return tasks.find(h) != nullptr;
+                                       });
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    size_t Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::pause_tagged_tasks(const std::string& tag_name)
+    {
+        size_t res = 0;
+        auto tagged = tags.find(tag_name, [this](TaskHandle h)
+                                          {
+                                              return tasks.find(h) != nullptr;
+                                          });
+
+        if (tagged != nullptr)
+        {
+            for (auto handle : *tagged)
+            {
+                res += tasks.pause(handle) ? 1 : 0;
+            }
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    size_t Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::resume_tagged_tasks(const std::string& tag_name)
+    {
+        size_t res = 0;
+        auto tagged = tags.find(tag_name, [this](TaskHandle h)
+                                          {
+                                              return tasks.find(h) != nullptr;
+                                          });
+
+        if (tagged != nullptr)
+        {
+            res = tasks.resume(*tagged, [this, now = clock.now()](Task& t)
+                                        {
+                                            return reschedule(t, now);
+                                        });
+        }
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::optional<TaskStatus> Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::get_status(TaskHandle handle) const
+    {
+        std::optional<TaskStatus> res{};
+
+        tasks.lock_queue();
+        auto t = tasks.find(handle);
+
+        if (t != nullptr)
+        {
+            res = TaskStatus{ t->is_paused(), t->get_next_schedule(), t->get_last_run(), t->get_fire_count() };
+        }
+
+        tasks.release_queue();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::optional<MetricsSummary> Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::get_metrics(TaskHandle handle) const
+    {
+        std::optional<MetricsSummary> res{};
+
+        tasks.lock_queue();
+        auto t = tasks.find(handle);
+
+        if (t != nullptr)
+        {
+            res.emplace();
+
+            if (t->get_metrics())
+            {
+                res->add(*t->get_metrics());
+            }
+            else
+            {
+                res->tasks = 1;
+            }
+        }
+
+        tasks.release_queue();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    MetricsSummary Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::get_metrics() const
+    {
+        MetricsSummary res{};
+
+        tasks.lock_queue();
+        tasks.for_each([&res](const Task& t)
+                       {
+                           if (t.get_metrics())
+                           {
+                               res.add(*t.get_metrics());
+                           }
+                           else
+                           {
+                               ++res.tasks;
+                           }
+                       });
+        tasks.release_queue();
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::apply(Change& change)
+    {
+        switch (change.kind)
+        {
+            case Change::Kind::Add:
+                for (auto& t : change.tasks)
+                {
+                    share_schedule(t);
+                }
+                tasks.push(change.tasks);
+                break;
+            case Change::Kind::Remove:
+                removed(change.handle ? tasks.remove(change.handle) : tasks.remove(change.name));
+                break;
+            case Change::Kind::Update:
+                update(change.handle, change.name, *change.schedule);
+                break;
+            case Change::Kind::Pause:
+                tasks.pause(change.handle);
+                break;
+            case Change::Kind::Resume:
+                tasks.resume(change.handle, [this, now = clock.now()](Task& t)
+                                            {
+                                                return reschedule(t, now);
+                                            });
+                break;
+            case Change::Kind::Tag:
+                tag(change.handle, change.name);
+                break;
+            case Change::Kind::PauseTagged:
+                pause_tagged_tasks(change.name);
+                break;
+            case Change::Kind::ResumeTagged:
+                resume_tagged_tasks(change.name);
+                break;
+            case Change::Kind::Clear:
+                tasks.for_each([this](const Task& t)
+                               {
+                                   handles.release(t.get_handle());
+                               });
+                tasks.clear();
+                tags.clear();
+                break;
+        }
+
+        snapshot_stale = true;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::chrono::system_clock::duration Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::time_until_next() const
+    {
+        std::chrono::system_clock::duration d{};
+        tasks.lock_queue();
+        if (!time_until_first(clock.now(), d))
+        {
+            d = std::numeric_limits<std::chrono::minutes>::max();
         }
+        tasks.release_queue();
 
         return d;
     }
 
-    template<typename ClockType, typename LockType>
-    size_t Cron<ClockType, LockType>::tick(std::chrono::system_clock::time_point now)
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::time_until_first(std::chrono::system_clock::time_point now,
+                                                                                        std::chrono::system_clock::duration& d) const
+    {
+        bool res = !tasks.empty();
+        if (res)
+        {
+            d = tasks.top().time_until_expiry(now);
+        }
+
+#if defined(LIBCRON_COROUTINES)
+        if (!waiters.empty())
+        {
+            auto earliest = waiters.earliest();
+            auto until = earliest > now ? earliest - now : std::chrono::system_clock::duration::zero();
+            d = res ? std::min(d, until) : until;
+            res = true;
+        }
+#endif
+
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    size_t Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::tick_at(std::chrono::system_clock::time_point now)
     {
         tasks.lock_queue();
+        auto started = std::chrono::steady_clock::now();
+        apply_changes();
+        ticking.store(std::this_thread::get_id());
         size_t res = 0;
 
         if(!first_tick)
@@ -224,10 +1182,14 @@ namespace libcron
             {
                 // Time changes of more than 3 hours are considered to be corrections to the
                 // clock or timezone, and the new time is used immediately.
-                for (auto& t : tasks.get_tasks())
-                {
-                    t.calculate_next(now);
-                }
+                tasks.recalculate(now, [this, &now](Task& t)
+                                       {
+                                           return reschedule(t, now);
+                                       });
+                snapshot_stale = true;
+#if defined(LIBCRON_COROUTINES)
+                waiters.recalculate(now);
+#endif
             }
             else
             {
@@ -242,58 +1204,299 @@ namespace libcron
 
         last_tick = now;
 
-        if (!tasks.empty())
+        try
+        {
+            res = tasks.expire(now, [this, &now](Task& t)
+                                    {
+                                        auto scheduled = t.get_next_schedule();
+                                        hooks.on_task_fire(t);
+                                        executor.execute(t, now);
+                                        hooks.on_task_done(t);
+
+                                        if (t.check_missed(scheduled, now))
+                                        {
+                                            executor.get_totals().record_miss();
+                                        }
+
+                                        using namespace std::chrono_literals;
+                                        bool keep = reschedule(t, now + 1s);
+                                        hooks.on_reschedule(t, keep);
+
+                                        if (!keep)
+                                        {
+                                            executor.record_metrics();
+                                            snapshot_stale = true;
+                                        }
+                                        else if (snapshots_enabled)
+                                        {
+                                            snapshot_changes.push_back(t.get_handle());
+                                        }
+
+                                        return keep;
+                                    });
+        }
+        catch (...)
+        {
+            // The queue is left in order, with the task that threw still due, so that ticking can go on.
+            ticking.store(std::thread::id{});
+            snapshot_stale = true;
+            tasks.release_queue();
+            throw;
+        }
+
+        executor.record_metrics();
+
+        // Changes made by the tasks themselves
+        apply_changes();
+        ticking.store(std::thread::id{});
+
+        publish_snapshot(now);
+        tick_metrics.record(std::chrono::steady_clock::now() - started);
+        hooks.on_tick_end(res);
+
+#if defined(LIBCRON_COROUTINES)
+        // Resumed without holding the lock, as the coroutines may wait again.
+        auto due = waiters.take_due(now);
+        tasks.release_queue();
+        Waiters::resume(due);
+#else
+        tasks.release_queue();
+#endif
+        return res;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::run_until(std::chrono::system_clock::time_point end)
+    {
+        using namespace std::chrono;
+
+        // Wake up at least this often, in case the offset of a local clock changes.
+        constexpr system_clock::duration longest_sleep = hours{1};
+
+        std::unique_lock<std::mutex> lock(run_mutex);
+        bool due = true;
+
+        while (!stop_requested && clock.now() < end)
         {
-            for (size_t i = 0; i < tasks.size(); i++)
+            schedules_changed = false;
+            lock.unlock();
+
+            if (due)
             {
-                if (tasks.at(i).is_expired(now))
-                {
-                    auto& t = tasks.at(i);
-                    t.execute(now);
+                // Tasks expire on whole seconds. Ticking on them keeps ticks at least a second apart,
+                // which tick() requires, even when woken a little late.
+                tick(floor<seconds>(clock.now()));
+            }
+
+            if (!changes.empty() || (snapshots_enabled && snapshot_stale))
+            {
+                tasks.lock_queue();
+                apply_changes();
+                publish_snapshot(clock.now());
+                tasks.release_queue();
+            }
 
-                    using namespace std::chrono_literals;
-                    if (!t.calculate_next(now + 1s))
-                    {
-                        tasks.remove(t);
-                    }
+            auto wakeup = get_next_wakeup();
+            auto system_now = system_clock::now();
+            auto deadline = std::min(wakeup, system_now + std::min(end - clock.now(), longest_sleep));
+            bool expired = deadline <= system_now;
 
-                    res++;
-                }
+            lock.lock();
+
+            if (expired)
+            {
+                due = true;
+            }
+            else
+            {
+                run_sleeping = true;
+                due = !run_condition.wait_until(lock, deadline, [this]()
+                                                                {
+                                                                    return stop_requested || schedules_changed;
+                                                                });
+                run_sleeping = false;
             }
+        }
+
+        stop_requested = false;
+    }
 
-            // Only sort if at least one task was executed
-            if (res > 0)
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::chrono::system_clock::time_point Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::get_next_wakeup()
+    {
+        using namespace std::chrono;
+
+        auto res = system_clock::time_point::max();
+
+        tasks.lock_queue();
+        system_clock::duration until_expiry{};
+
+        if (time_until_first(clock.now(), until_expiry))
+        {
+            auto system_now = system_clock::now();
+            res = system_now;
+
+            if (until_expiry > until_expiry.zero())
             {
-                tasks.sort();
+                // Rounding removes the time passed between reading the two clocks, unless the clock
+                // is not one following the system clock.
+                res = round<seconds>(system_now + until_expiry);
+
+                if (res <= system_now)
+                {
+                    res = system_now + until_expiry;
+                }
             }
         }
 
         tasks.release_queue();
+
         return res;
     }
 
-    template<typename ClockType, typename LockType>
-    void Cron<ClockType, LockType>::get_time_until_expiry_for_tasks(std::vector<std::tuple<std::string,
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::stop()
+    {
+        std::lock_guard<std::mutex> lock(run_mutex);
+        stop_requested = true;
+        run_condition.notify_all();
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::notify_change()
+    {
+        // Either run() sees the flag before it sleeps, or this sees that it sleeps. Only the first change
+        // since run() last woke needs to wake it.
+        if (!schedules_changed.exchange(true) && run_sleeping)
+        {
+            std::lock_guard<std::mutex> lock(run_mutex);
+            run_condition.notify_all();
+        }
+
+        if (change_listener)
+        {
+            change_listener();
+        }
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::publish_snapshot(std::chrono::system_clock::time_point now)
+    {
+        if (!snapshots_enabled)
+        {
+            return;
+        }
+
+        bool full = snapshot_stale.exchange(false);
+
+        if (full || !snapshot_changes.empty())
+        {
+            auto version = ++snapshot_version;
+
+            if (full)
+            {
+                snapshot_layout = version;
+            }
+
+            snapshots.publish([this, now, version, full](Snapshot& s)
+                              {
+                                  // Unless readers hold on to snapshots, the recycled one is the one published
+                                  // before the last, and differs from the tasks only in those that ran since.
+                                  bool recent = !full && s.version + 2 == version && s.version >= snapshot_layout;
+
+                                  if (!recent || !update_snapshot(s))
+                                  {
+                                      write_snapshot(s, full);
+                                  }
+
+                                  s.taken = now;
+                                  s.version = version;
+                              });
+
+            previous_snapshot_changes.swap(snapshot_changes);
+            snapshot_changes.clear();
+        }
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::write_snapshot(Snapshot& s, bool layout)
+    {
+        // Resizing keeps the existing entries, and the memory of their names.
+        s.tasks.resize(tasks.size());
+        uint32_t position = 0;
+
+        tasks.for_each([this, &s, &position, layout](const Task& t)
+                       {
+                           auto index = t.get_handle().get_index();
+
+                           if (layout)
+                           {
+                               if (index >= snapshot_positions.size())
+                               {
+                                   snapshot_positions.resize(index + 1);
+                               }
+
+                               snapshot_positions[index] = position++;
+                           }
+
+                           copy_to(s.tasks[snapshot_positions[index]], t);
+                       });
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    bool Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::update_snapshot(Snapshot& s) const
+    {
+        for (const auto* changes : { &previous_snapshot_changes, &snapshot_changes })
+        {
+            for (auto handle : *changes)
+            {
+                auto t = tasks.find(handle);
+
+                if (t == nullptr)
+                {
+                    return false;
+                }
+
+                copy_to(s.tasks[snapshot_positions[handle.get_index()]], *t);
+            }
+        }
+
+        return true;
+    }
+
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    void Cron<ClockType, LockType, QueueType, ExecutorType, HookType>::get_time_until_expiry_for_tasks(std::vector<std::tuple<std::string,
                                                           std::chrono::system_clock::duration>>& status) const
     {
         auto now = clock.now();
         status.clear();
 
-        std::for_each(tasks.get_tasks().cbegin(), tasks.get_tasks().cend(),
-                      [&status, &now](const Task& t)
-                      {
-                          status.emplace_back(t.get_name(), t.time_until_expiry(now));
-                      });
+        tasks.lock_queue();
+        tasks.for_each([&status, &now](const Task& t)
+                       {
+                           status.emplace_back(t.get_name(), t.time_until_expiry(now));
+                       });
+        tasks.release_queue();
     }
 
-    template<typename ClockType, typename LockType>
-    std::ostream& operator<<(std::ostream& stream, const Cron<ClockType, LockType>& c)
+    template<typename ClockType, typename LockType, template<typename> class QueueType, typename ExecutorType,
+             typename HookType>
+    std::ostream& operator<<(std::ostream& stream, const Cron<ClockType, LockType, QueueType, ExecutorType, HookType>& c)
     {
-        std::for_each(c.tasks.get_tasks().cbegin(), c.tasks.get_tasks().cend(),
-                      [&stream, &c](const Task& t)
-                      {
-                          stream << t.get_status(c.clock.now()) << '\n';
-                      });
+        c.tasks.lock_queue();
+        c.tasks.for_each([&stream, &c](const Task& t)
+                         {
+                             stream << t.get_status(c.clock.now()) << '\n';
+                         });
+        c.tasks.release_queue();
 
         return stream;
     }
@@ -1,11 +1,11 @@
 #pragma once
 
-#include <set>
-#include <regex>
+#include <algorithm>
+#include <array>
 #include <string>
-#include <vector>
-#include <unordered_map>
+#include <string_view>
 #include <libcron/TimeTypes.h>
+#include <libcron/CronField.h>
 
 namespace libcron
 {
@@ -15,8 +15,32 @@ namespace libcron
             static const int NUMBER_OF_LONG_MONTHS = 7;
             static const libcron::Months months_with_31[NUMBER_OF_LONG_MONTHS];
 
+            static constexpr size_t DEFAULT_CACHE_CAPACITY = 4096;
+
+            struct CacheStatistics
+            {
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+                uint64_t evictions = 0;
+                size_t size = 0;
+                size_t capacity = 0;
+            };
+
+            // Returns the parsed expression, reusing the result of earlier calls when possible.
+            // The cache is safe to use from any thread.
             static CronData create(const std::string& cron_expression);
 
+            // Parses the expression without consulting or updating the cache.
+            static CronData create_uncached(std::string_view cron_expression);
+
+            // Limits the number of cached expressions; when full, the least recently used ones are evicted.
+            // A capacity of 0 disables caching. Changing the capacity empties the cache.
+            static void set_cache_capacity(size_t capacity);
+
+            static CacheStatistics get_cache_statistics();
+
+            static void clear_cache();
+
             CronData() = default;
 
             CronData(const CronData&) = default;
@@ -28,36 +52,60 @@ namespace libcron
                 return valid;
             }
 
-            const std::set<Seconds>& get_seconds() const
+            const CronField<Seconds>& get_seconds() const
             {
                 return seconds;
             }
 
-            const std::set<Minutes>& get_minutes() const
+            const CronField<Minutes>& get_minutes() const
             {
                 return minutes;
             }
 
-            const std::set<Hours>& get_hours() const
+            const CronField<Hours>& get_hours() const
             {
                 return hours;
             }
 
-            const std::set<DayOfMonth>& get_day_of_month() const
+            const CronField<DayOfMonth>& get_day_of_month() const
             {
                 return day_of_month;
             }
 
-            const std::set<Months>& get_months() const
+            const CronField<Months>& get_months() const
             {
                 return months;
             }
 
-            const std::set<DayOfWeek>& get_day_of_week() const
+            const CronField<DayOfWeek>& get_day_of_week() const
             {
                 return day_of_week;
             }
 
+            // Expressions are equal when they allow the same time points, e.g. "@hourly" and "0 0 * * * ?".
+            bool operator==(const CronData& other) const
+            {
+                return seconds == other.seconds && minutes == other.minutes && hours == other.hours
+                       && day_of_month == other.day_of_month && months == other.months
+                       && day_of_week == other.day_of_week && valid == other.valid;
+            }
+
+            bool operator!=(const CronData& other) const
+            {
+                return !(*this == other);
+            }
+
+            size_t hash() const
+            {
+                uint64_t h = seconds.get_mask();
+                h = h * 31 + minutes.get_mask();
+                h = h * 31 + hours.get_mask();
+                h = h * 31 + day_of_month.get_mask();
+                h = h * 31 + months.get_mask();
+                h = h * 31 + day_of_week.get_mask();
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+
             template<typename T>
             static uint8_t value_of(T t)
             {
@@ -65,147 +113,140 @@ namespace libcron
             }
 
             template<typename T>
-            static bool has_any_in_range(const std::set<T>& set, uint8_t low, uint8_t high)
+            static bool has_any_in_range(const CronField<T>& set, uint8_t low, uint8_t high)
             {
-                bool found = false;
-
-                for (auto i = low; !found && i <= high; ++i)
-                {
-                    found |= set.find(static_cast<T>(i)) != set.end();
-                }
-
-                return found;
+                auto next = set.next(low);
+                return next != -1 && next <= high;
             }
 
             template<typename T>
-            bool convert_from_string_range_to_number_range(const std::string& range, std::set<T>& numbers);
+            bool convert_from_string_range_to_number_range(std::string_view range, CronField<T>& numbers);
 
             template<typename T>
             static std::string& replace_string_name_with_numeric(std::string& s);
 
         private:
-            void parse(const std::string& cron_expression);
+            static constexpr int NUMBER_OF_FIELDS = 6;
 
-            template<typename T>
-            bool validate_numeric(const std::string& s, std::set<T>& numbers);
+            // Numbers larger than this are out of range for every field, so parsing saturates here.
+            static constexpr int32_t MAX_NUMBER = 0xFFFF;
+
+            void parse(std::string_view cron_expression);
+
+            static bool split_fields(std::string_view expression,
+                                     std::array<std::string_view, NUMBER_OF_FIELDS>& fields);
+
+            static std::string expand_macros(std::string_view cron_expression);
 
             template<typename T>
-            bool validate_literal(const std::string& s,
-                                  std::set<T>& numbers,
-                                  const std::vector<std::string>& names);
+            bool parse_field(std::string_view field, CronField<T>& numbers);
 
             template<typename T>
-            bool process_parts(const std::vector<std::string>& parts, std::set<T>& numbers);
+            static bool read_number(std::string_view s, size_t& pos, int32_t& number);
 
             template<typename T>
-            bool add_number(std::set<T>& set, int32_t number);
+            static int match_name(std::string_view s, size_t pos);
 
             template<typename T>
-            bool is_within_limits(int32_t low, int32_t high);
+            static constexpr const std::string_view* names_of();
 
             template<typename T>
-            bool get_range(const std::string& s, T& low, T& high);
+            bool add_number(CronField<T>& set, int32_t number);
 
             template<typename T>
-            bool get_step(const std::string& s, uint8_t& start, uint8_t& step);
+            bool is_within_limits(int32_t low, int32_t high);
+
+            static bool is_space(char c);
 
-            std::vector<std::string> split(const std::string& s, char token);
+            static bool is_digit(char c);
 
-            bool is_number(const std::string& s);
+            static char to_upper(char c);
 
             bool is_between(int32_t value, int32_t low_limit, int32_t high_limit);
 
             bool validate_date_vs_months() const;
 
-            bool check_dom_vs_dow(const std::string& dom, const std::string& dow) const;
+            bool check_dom_vs_dow(std::string_view dom, std::string_view dow) const;
 
-            std::set<Seconds> seconds{};
-            std::set<Minutes> minutes{};
-            std::set<Hours> hours{};
-            std::set<DayOfMonth> day_of_month{};
-            std::set<Months> months{};
-            std::set<DayOfWeek> day_of_week{};
+            CronField<Seconds> seconds{};
+            CronField<Minutes> minutes{};
+            CronField<Hours> hours{};
+            CronField<DayOfMonth> day_of_month{};
+            CronField<Months> months{};
+            CronField<DayOfWeek> day_of_week{};
             bool valid = false;
 
-            static const std::vector<std::string> month_names;
-            static const std::vector<std::string> day_names;
-            static std::unordered_map<std::string, CronData> cache;
+            static constexpr std::string_view month_names[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                                                "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+            static constexpr std::string_view day_names[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
 
             template<typename T>
-            void add_full_range(std::set<T>& set);
+            void add_full_range(CronField<T>& set);
     };
 
     template<typename T>
-    bool CronData::validate_numeric(const std::string& s, std::set<T>& numbers)
+    bool CronData::parse_field(std::string_view field, CronField<T>& numbers)
     {
-        std::vector<std::string> parts = split(s, ',');
-
-        return process_parts(parts, numbers);
-    }
-
-    template<typename T>
-    bool CronData::validate_literal(const std::string& s,
-                                    std::set<T>& numbers,
-                                    const std::vector<std::string>& names)
-    {
-        std::vector<std::string> parts = split(s, ',');
+        // The parts are separated by ',', an empty part is an error except for a single trailing ','.
+        if (field.size() > 1 && field.back() == ',')
+        {
+            field.remove_suffix(1);
+        }
 
-        auto value_of_first_name = value_of(T::First);
+        bool res = true;
 
-        // Replace each found name with the corresponding value.
-        for (const auto& name : names)
+        for (size_t start = 0; res && start <= field.size();)
         {
-            std::regex m(name, std::regex_constants::ECMAScript | std::regex_constants::icase);
+            auto end = field.find(',', start);
 
-            for (auto& part : parts)
+            if (end == std::string_view::npos)
             {
-                std::string replaced;
-                std::regex_replace(std::back_inserter(replaced), part.begin(), part.end(), m,
-                                   std::to_string(value_of_first_name));
-
-                part = replaced;
+                end = field.size();
             }
 
-            value_of_first_name++;
+            res = convert_from_string_range_to_number_range<T>(field.substr(start, end - start), numbers);
+            start = end + 1;
         }
 
-        return process_parts(parts, numbers);
+        return res;
     }
 
     template<typename T>
-    bool CronData::process_parts(const std::vector<std::string>& parts, std::set<T>& numbers)
+    constexpr const std::string_view* CronData::names_of()
     {
-        bool res = true;
-
-        for (const auto& p : parts)
+        if constexpr (std::is_same<T, libcron::Months>())
         {
-            res &= convert_from_string_range_to_number_range(p, numbers);
+            return month_names;
+        }
+        else if constexpr (std::is_same<T, libcron::DayOfWeek>())
+        {
+            return day_names;
+        }
+        else
+        {
+            return nullptr;
         }
-
-        return res;
     }
 
     template<typename T>
-    bool CronData::get_range(const std::string& s, T& low, T& high)
+    int CronData::match_name(std::string_view s, size_t pos)
     {
-        bool res = false;
+        // Returns the index of the name starting at 'pos', or -1 if there is none.
+        int res = -1;
+        auto names = names_of<T>();
 
-        auto value_range = R"#((\d+)-(\d+))#";
-
-        std::regex range(value_range, std::regex_constants::ECMAScript);
-
-        std::smatch match;
-
-        if (std::regex_match(s.begin(), s.end(), match, range))
+        if (names != nullptr && pos + 3 <= s.size())
         {
-            auto left = std::stoi(match[1].str());
-            auto right = std::stoi(match[2].str());
+            auto count = value_of(T::Last) - value_of(T::First) + 1;
 
-            if (is_within_limits<T>(left, right))
+            for (int i = 0; res == -1 && i < count; ++i)
             {
-                low = static_cast<T>(left);
-                high = static_cast<T>(right);
-                res = true;
+                if (to_upper(s[pos]) == names[i][0]
+                    && to_upper(s[pos + 1]) == names[i][1]
+                    && to_upper(s[pos + 2]) == names[i][2])
+                {
+                    res = i;
+                }
             }
         }
 
@@ -213,61 +254,66 @@ namespace libcron
     }
 
     template<typename T>
-    bool CronData::get_step(const std::string& s, uint8_t& start, uint8_t& step)
+    bool CronData::read_number(std::string_view s, size_t& pos, int32_t& number)
     {
+        // A number is a run of digits. For months and days of week, names may be used in place of digits,
+        // each name standing for the decimal digits of its value, i.e. "OCT" reads as "10".
         bool res = false;
+        number = 0;
 
-        auto value_range = R"#((\d+|\*)/(\d+))#";
+        auto append = [&number](int32_t digit)
+                      {
+                          number = std::min(number * 10 + digit, MAX_NUMBER);
+                      };
 
-        std::regex range(value_range, std::regex_constants::ECMAScript);
-
-        std::smatch match;
-
-        if (std::regex_match(s.begin(), s.end(), match, range))
+        for (bool more = true; more && pos < s.size();)
         {
-            int raw_start;
+            int name;
 
-            if (match[1].str() == "*")
+            if (is_digit(s[pos]))
             {
-                raw_start = value_of(T::First);
+                append(s[pos] - '0');
+                ++pos;
+                res = true;
             }
-            else
+            else if ((name = match_name<T>(s, pos)) != -1)
             {
-                raw_start = std::stoi(match[1].str());
-            }
+                auto value = value_of(T::First) + name;
 
-            auto raw_step = std::stoi(match[2].str());
+                if (value >= 10)
+                {
+                    append(value / 10);
+                }
 
-            if (is_within_limits<T>(raw_start, raw_start) && raw_step > 0)
-            {
-                start = static_cast<uint8_t>(raw_start);
-                step = static_cast<uint8_t>(raw_step);
+                append(value % 10);
+                pos += 3;
                 res = true;
             }
+            else
+            {
+                more = false;
+            }
         }
 
         return res;
     }
 
     template<typename T>
-    void CronData::add_full_range(std::set<T>& set)
+    void CronData::add_full_range(CronField<T>& set)
     {
         for (auto v = value_of(T::First); v <= value_of(T::Last); ++v)
         {
-            if (set.find(static_cast<T>(v)) == set.end())
-            {
-                set.emplace(static_cast<T>(v));
-            }
+            set.emplace(static_cast<T>(v));
         }
     }
 
     template<typename T>
-    bool CronData::add_number(std::set<T>& set, int32_t number)
+    bool CronData::add_number(CronField<T>& set, int32_t number)
     {
         bool res = true;
 
         // Don't add if already there
-        if (set.find(static_cast<T>(number)) == set.end())
+        if (!set.contains(number))
         {
             // Check range
             if (is_within_limits<T>(number, number))
@@ -291,99 +337,118 @@ namespace libcron
     }
 
     template<typename T>
-    bool CronData::convert_from_string_range_to_number_range(const std::string& range, std::set<T>& numbers)
+    bool CronData::convert_from_string_range_to_number_range(std::string_view range, CronField<T>& numbers)
     {
-        T left;
-        T right;
-        uint8_t step_start;
-        uint8_t step;
-
-        bool res = true;
+        // Accepts one of '*', '?', 'n', 'n-m', 'n/m' or '*/m'
+        bool res = false;
 
         if (range == "*" || range == "?")
         {
             // We treat the ignore-character '?' the same as the full range being allowed.
             add_full_range<T>(numbers);
+            res = true;
         }
-        else if (is_number(range))
-        {
-            res = add_number<T>(numbers, std::stoi(range));
-        }
-        else if (get_range<T>(range, left, right))
+        else
         {
-            // A range can be written as both 1-22 or 22-1, meaning totally different ranges.
-            // First case is 1...22 while 22-1 is only four hours: 22, 23, 0, 1.
-            if (left <= right)
+            size_t pos = 0;
+            int32_t left = value_of(T::First);
+            bool is_star = !range.empty() && range[0] == '*';
+
+            if (is_star)
             {
-                for (auto v = value_of(left); v <= value_of(right); ++v)
-                {
-                    res &= add_number(numbers, v);
-                }
+                ++pos;
             }
-            else
+
+            if (is_star || read_number<T>(range, pos, left))
             {
-                // 'left' and 'right' are not in value order. First, get values between 'left' and T::Last, inclusive
-                for (auto v = value_of(left); v <= value_of(T::Last); ++v)
+                int32_t right = 0;
+
+                if (pos == range.size())
                 {
-                    res = add_number(numbers, v);
+                    res = !is_star && add_number(numbers, left);
                 }
-
-                // Next, get values between T::First and 'right', inclusive.
-                for (auto v = value_of(T::First); v <= value_of(right); ++v)
+                else if (range[pos] == '-' && !is_star)
                 {
-                    res = add_number(numbers, v);
+                    ++pos;
+                    res = read_number<T>(range, pos, right)
+                          && pos == range.size()
+                          && is_within_limits<T>(left, right);
+
+                    if (res)
+                    {
+                        // A range can be written as both 1-22 or 22-1, meaning totally different ranges.
+                        // First case is 1...22 while 22-1 is only four hours: 22, 23, 0, 1.
+                        if (left <= right)
+                        {
+                            for (auto v = left; v <= right; ++v)
+                            {
+                                add_number(numbers, v);
+                            }
+                        }
+                        else
+                        {
+                            // 'left' and 'right' are not in value order. First, get values between 'left' and
+                            // T::Last, inclusive, then values between T::First and 'right', inclusive.
+                            for (auto v = left; v <= value_of(T::Last); ++v)
+                            {
+                                add_number(numbers, v);
+                            }
+
+                            for (auto v = static_cast<int32_t>(value_of(T::First)); v <= right; ++v)
+                            {
+                                add_number(numbers, v);
+                            }
+                        }
+                    }
+                }
+                else if (range[pos] == '/')
+                {
+                    ++pos;
+                    res = read_number<T>(range, pos, right)
+                          && pos == range.size()
+                          && is_within_limits<T>(left, left)
+                          && right > 0;
+
+                    // Add from 'left' to T::Last with a step of 'right'
+                    for (auto v = left; res && v <= value_of(T::Last); v += right)
+                    {
+                        add_number(numbers, v);
+                    }
                 }
             }
         }
-        else if (get_step<T>(range, step_start, step))
-        {
-            // Add from step_start to T::Last with a step of 'step'
-            for (auto v = step_start; v <= value_of(T::Last); v += step)
-            {
-                res = add_number(numbers, v);
-            }
-        }
-        else
-        {
-            res = false;
-        }
 
         return res;
     }
 
     template<typename T>
-    std::string & CronData::replace_string_name_with_numeric(std::string& s)
+    std::string& CronData::replace_string_name_with_numeric(std::string& s)
     {
-        auto value = static_cast<int>(T::First);
-
-        const std::vector<std::string>* name_source{};
-
         static_assert(std::is_same<T, libcron::Months>()
                       || std::is_same<T, libcron::DayOfWeek>(),
-                        "T must be either Months or DayOfWeek");
+                      "T must be either Months or DayOfWeek");
 
-        if constexpr (std::is_same<T, libcron::Months>())
-        {
-            name_source = &month_names;
-        }
-        else
-        {
-            name_source = &day_names;
-        }
+        std::string replaced;
+        replaced.reserve(s.size());
 
-        for (const auto& name : *name_source)
+        for (size_t pos = 0; pos < s.size();)
         {
-            std::regex m(name, std::regex_constants::ECMAScript | std::regex_constants::icase);
-
-            std::string replaced;
-
-            std::regex_replace(std::back_inserter(replaced), s.begin(), s.end(), m, std::to_string(value));
-
-            s = replaced;
+            auto name = match_name<T>(s, pos);
 
-            ++value;
+            if (name == -1)
+            {
+                replaced += s[pos];
+                ++pos;
+            }
+            else
+            {
+                replaced += std::to_string(value_of(T::First) + name);
+                pos += 3;
+            }
         }
 
+        s = replaced;
+
         return s;
     }
 }
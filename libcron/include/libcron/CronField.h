@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "libcron/TimeTypes.h"
+
+namespace libcron
+{
+    namespace bits
+    {
+        // Number of set bits
+        inline int count(uint64_t v)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            return static_cast<int>(__popcnt64(v));
+#elif defined(_MSC_VER)
+            int c = 0;
+            for (; v != 0; v &= v - 1)
+            {
+                ++c;
+            }
+            return c;
+#else
+            return __builtin_popcountll(v);
+#endif
+        }
+
+        // Index of the lowest set bit, v must not be zero.
+        inline int lowest(uint64_t v)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, v);
+            return static_cast<int>(index);
+#elif defined(_MSC_VER)
+            int index = 0;
+            for (; (v & 1u) == 0; v >>= 1)
+            {
+                ++index;
+            }
+            return index;
+#else
+            return __builtin_ctzll(v);
+#endif
+        }
+
+        // Index of the highest set bit, v must not be zero.
+        inline int highest(uint64_t v)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanReverse64(&index, v);
+            return static_cast<int>(index);
+#elif defined(_MSC_VER)
+            int index = -1;
+            for (; v != 0; v >>= 1)
+            {
+                ++index;
+            }
+            return index;
+#else
+            return 63 - __builtin_clzll(v);
+#endif
+        }
+    }
+
+    // Selects the smallest mask able to hold all values of a field.
+    template<typename T>
+    struct FieldMask;
+
+    template<>
+    struct FieldMask<Seconds>
+    {
+        using type = uint64_t;
+    };
+
+    template<>
+    struct FieldMask<Minutes>
+    {
+        using type = uint64_t;
+    };
+
+    template<>
+    struct FieldMask<Hours>
+    {
+        using type = uint32_t;
+    };
+
+    template<>
+    struct FieldMask<DayOfMonth>
+    {
+        using type = uint32_t;
+    };
+
+    template<>
+    struct FieldMask<Months>
+    {
+        using type = uint16_t;
+    };
+
+    template<>
+    struct FieldMask<DayOfWeek>
+    {
+        using type = uint8_t;
+    };
+
+    // The allowed values of a single cron field, stored as a bitmask where bit N is set when value N is allowed.
+    // Offers a std::set-like interface in addition to constant time "next allowed value" queries.
+    template<typename T>
+    class CronField
+    {
+        public:
+            using mask_type = typename FieldMask<T>::type;
+
+            class const_iterator
+            {
+                public:
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = T;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = const T*;
+                    using reference = T;
+
+                    const_iterator() = default;
+
+                    explicit const_iterator(uint64_t remaining)
+                            : remaining(remaining)
+                    {
+                    }
+
+                    T operator*() const
+                    {
+                        return static_cast<T>(bits::lowest(remaining));
+                    }
+
+                    const_iterator& operator++()
+                    {
+                        remaining &= remaining - 1;
+                        return *this;
+                    }
+
+                    const_iterator operator++(int)
+                    {
+                        auto copy = *this;
+                        ++(*this);
+                        return copy;
+                    }
+
+                    bool operator==(const const_iterator& other) const
+                    {
+                        return remaining == other.remaining;
+                    }
+
+                    bool operator!=(const const_iterator& other) const
+                    {
+                        return remaining != other.remaining;
+                    }
+
+                private:
+                    // The values not yet visited, the current value being the lowest set bit.
+                    uint64_t remaining = 0;
+            };
+
+            using iterator = const_iterator;
+
+            static constexpr int first_value = static_cast<int>(T::First);
+            static constexpr int last_value = static_cast<int>(T::Last);
+
+            bool contains(T value) const
+            {
+                return contains(static_cast<int>(value));
+            }
+
+            bool contains(int value) const
+            {
+                return value >= first_value && value <= last_value && (mask >> value) & 1u;
+            }
+
+            const_iterator find(T value) const
+            {
+                return contains(value) ? const_iterator{above(static_cast<int>(value))} : end();
+            }
+
+            const_iterator begin() const
+            {
+                return const_iterator{mask};
+            }
+
+            const_iterator end() const
+            {
+                return const_iterator{};
+            }
+
+            size_t size() const
+            {
+                return static_cast<size_t>(bits::count(mask));
+            }
+
+            bool empty() const
+            {
+                return mask == 0;
+            }
+
+            std::pair<const_iterator, bool> insert(T value)
+            {
+                auto v = static_cast<int>(value);
+                bool inserted = !contains(v);
+                mask = static_cast<mask_type>(mask | bit(v));
+                return { const_iterator{above(v)}, inserted };
+            }
+
+            std::pair<const_iterator, bool> emplace(T value)
+            {
+                return insert(value);
+            }
+
+            size_t erase(T value)
+            {
+                bool found = contains(value);
+                mask = static_cast<mask_type>(mask & ~bit(static_cast<int>(value)));
+                return found ? 1 : 0;
+            }
+
+            const_iterator erase(const_iterator it)
+            {
+                auto v = static_cast<int>(*it);
+                mask = static_cast<mask_type>(mask & ~bit(v));
+                return const_iterator{above(v)};
+            }
+
+            void clear()
+            {
+                mask = 0;
+            }
+
+            // Returns the lowest allowed value >= from, or -1 if there is none.
+            int next(int from) const
+            {
+                auto m = from <= 0 ? uint64_t{mask} : above(from);
+                return m == 0 ? -1 : bits::lowest(m);
+            }
+
+            // Returns the highest allowed value <= from, or -1 if there is none.
+            int previous(int from) const
+            {
+                auto m = below(from);
+                return m == 0 ? -1 : bits::highest(m);
+            }
+
+            int first() const
+            {
+                return next(0);
+            }
+
+            int last() const
+            {
+                return mask == 0 ? -1 : bits::highest(mask);
+            }
+
+            mask_type get_mask() const
+            {
+                return mask;
+            }
+
+            bool operator==(const CronField& other) const
+            {
+                return mask == other.mask;
+            }
+
+            bool operator!=(const CronField& other) const
+            {
+                return mask != other.mask;
+            }
+
+        private:
+            static uint64_t bit(int value)
+            {
+                return uint64_t{1} << value;
+            }
+
+            // The allowed values >= from
+            uint64_t above(int from) const
+            {
+                return from > 63 ? 0 : uint64_t{mask} & (~uint64_t{0} << from);
+            }
+
+            // The allowed values <= from
+            uint64_t below(int from) const
+            {
+                return from < 0 ? 0 : from >= 63 ? uint64_t{mask} : uint64_t{mask} & ((uint64_t{2} << from) - 1);
+            }
+
+            mask_type mask = 0;
+    };
+}
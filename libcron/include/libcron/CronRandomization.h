@@ -25,7 +25,7 @@ namespace libcron
                                                              int& selected_value,
                                                              std::pair<int, int> limit = std::make_pair(-1, -1));
 
-            std::pair<int, int> day_limiter(const std::set<Months>& month);
+            std::pair<int, int> day_limiter(const CronField<Months>& month);
 
             int cap(int value, int lower, int upper);
 
@@ -57,7 +57,7 @@ namespace libcron
             }
 
             libcron::CronData cd;
-            std::set<T> numbers;
+            CronField<T> numbers;
             res.first = cd.convert_from_string_range_to_number_range<T>(
                     std::to_string(left) + "-" + std::to_string(right), numbers);
 
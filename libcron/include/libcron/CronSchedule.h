@@ -2,6 +2,12 @@
 
 #include "libcron/CronData.h"
 #include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#if __cplusplus > 201703L && __has_include(<ranges>)
+#include <ranges>
+#endif
 #if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable:4244)
@@ -18,6 +24,104 @@ namespace libcron
     class CronSchedule
     {
         public:
+            // Marks the end of an Occurrences range, which is reached only if no further time point can be found.
+            struct OccurrenceSentinel
+            {
+            };
+
+            // Yields successive time points matching the schedule. Each step continues the search from the
+            // previous time point, so it neither repeats the search from scratch nor allocates.
+            class OccurrenceIterator
+            {
+                public:
+                    using iterator_category = std::input_iterator_tag;
+                    using value_type = std::chrono::system_clock::time_point;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = const value_type*;
+                    using reference = value_type;
+
+                    OccurrenceIterator() = default;
+
+                    OccurrenceIterator(const CronSchedule& schedule, std::chrono::system_clock::time_point from)
+                            : schedule(&schedule),
+                              dt(to_calendar_time(date::floor<std::chrono::seconds>(from)))
+                    {
+                        found = schedule.find_next(dt);
+                    }
+
+                    value_type operator*() const
+                    {
+                        return to_time_point(dt);
+                    }
+
+                    OccurrenceIterator& operator++()
+                    {
+                        // Any overflow of the seconds is carried by find_next
+                        dt.sec = static_cast<uint8_t>(dt.sec + 1);
+                        found = schedule->find_next(dt);
+                        return *this;
+                    }
+
+                    OccurrenceIterator operator++(int)
+                    {
+                        auto copy = *this;
+                        ++(*this);
+                        return copy;
+                    }
+
+                    friend bool operator==(const OccurrenceIterator& it, OccurrenceSentinel)
+                    {
+                        return !it.found;
+                    }
+
+                    friend bool operator==(OccurrenceSentinel, const OccurrenceIterator& it)
+                    {
+                        return !it.found;
+                    }
+
+                    friend bool operator!=(const OccurrenceIterator& it, OccurrenceSentinel)
+                    {
+                        return it.found;
+                    }
+
+                    friend bool operator!=(OccurrenceSentinel, const OccurrenceIterator& it)
+                    {
+                        return it.found;
+                    }
+
+                private:
+                    const CronSchedule* schedule = nullptr;
+                    DateTime dt{};
+                    bool found = false;
+            };
+
+            // The time points at or after 'from' that match the schedule, in order.
+            // Refers to the schedule, which must outlive the range and its iterators.
+            class Occurrences
+            {
+                public:
+                    Occurrences() = default;
+
+                    Occurrences(const CronSchedule& schedule, std::chrono::system_clock::time_point from)
+                            : schedule(&schedule), from(from)
+                    {
+                    }
+
+                    OccurrenceIterator begin() const
+                    {
+                        return OccurrenceIterator{ *schedule, from };
+                    }
+
+                    OccurrenceSentinel end() const
+                    {
+                        return OccurrenceSentinel{};
+                    }
+
+                private:
+                    const CronSchedule* schedule = nullptr;
+                    std::chrono::system_clock::time_point from{};
+            };
+
             explicit CronSchedule(CronData& data)
                     : data(data)
             {
@@ -27,9 +131,24 @@ namespace libcron
 
             CronSchedule& operator=(const CronSchedule&) = default;
 
+            const CronData& get_data() const
+            {
+                return data;
+            }
+
             std::tuple<bool, std::chrono::system_clock::time_point>
             calculate_from(const std::chrono::system_clock::time_point& from) const;
 
+            // Calculates the latest time point at or before 'to' that matches the schedule, i.e. the last time
+            // the schedule should have fired. Fractions of seconds are discarded, just like for calculate_from.
+            std::tuple<bool, std::chrono::system_clock::time_point>
+            calculate_previous(const std::chrono::system_clock::time_point& to) const;
+
+            Occurrences occurrences(std::chrono::system_clock::time_point from) const
+            {
+                return Occurrences{ *this, from };
+            }
+
             // https://github.com/HowardHinnant/date/wiki/Examples-and-Recipes#obtaining-ymd-hms-components-from-a-time_point
             static DateTime to_calendar_time(std::chrono::system_clock::time_point time)
             {
@@ -49,8 +168,34 @@ namespace libcron
                 return dt;
             }
 
+            static std::chrono::system_clock::time_point to_time_point(const DateTime& dt)
+            {
+                return date::sys_days{ date::year{ dt.year } / date::month{ dt.month } / date::day{ dt.day } }
+                       + std::chrono::hours{ dt.hour }
+                       + std::chrono::minutes{ dt.min }
+                       + std::chrono::seconds{ dt.sec };
+            }
+
         private:
+            // The longest gap between two occurrences is eight years, for the 29th of February across a
+            // century that isn't a leap year.
+            static constexpr int MAX_YEARS_TO_SEARCH = 10;
+
+            bool find_next(DateTime& dt) const;
+
+            int next_allowed_day(const DateTime& dt) const;
+
+            bool find_previous(DateTime& dt) const;
+
+            int previous_allowed_day(const DateTime& dt) const;
+
             CronData data;
     };
 
 }
+
+#if defined(__cpp_lib_ranges)
+// The iterators refer to the schedule rather than to the range, so they remain valid after the range is gone.
+template<>
+inline constexpr bool std::ranges::enable_borrowed_range<libcron::CronSchedule::Occurrences> = true;
+#endif
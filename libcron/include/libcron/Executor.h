@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Task.h"
+#include "TraceRecorder.h"
+
+namespace libcron
+{
+    // Runs the work of expired tasks on the thread calling Cron::tick, while the tasks are locked.
+    class InlineExecutor
+    {
+        public:
+            void execute(Task& t, std::chrono::system_clock::time_point now)
+            {
+                auto started = std::chrono::steady_clock::now();
+
+                try
+                {
+                    t.execute(now);
+                }
+                catch (...)
+                {
+                    if (t.get_metrics())
+                    {
+                        runs.add(*t.get_metrics(), t.get_delay(), std::chrono::steady_clock::now() - started);
+                        t.get_metrics()->record_failure();
+                        totals.record_failure();
+                    }
+
+                    // The tasks may be removed before the next tick.
+                    runs.record(totals);
+                    throw;
+                }
+
+                auto run_time = std::chrono::steady_clock::now() - started;
+                runs.add(*t.get_metrics(), t.get_delay(), run_time);
+
+                if (trace)
+                {
+                    trace->record_fire(t.get_name(), started, t.get_delay());
+                    trace->record_run(t.get_name(), started, run_time, t.get_delay());
+                }
+            }
+
+            // Called by Cron::tick once the expired tasks have run, and before any of them is removed.
+            void record_metrics() noexcept
+            {
+                runs.record(totals);
+            }
+
+            // The metrics of all runs of all tasks, including those that have since been removed.
+            TaskMetrics& get_totals()
+            {
+                return totals;
+            }
+
+            const TaskMetrics& get_totals() const
+            {
+                return totals;
+            }
+
+            // Called by Cron::set_trace_recorder, with the tasks locked.
+            void set_trace_recorder(std::shared_ptr<TraceRecorder> recorder)
+            {
+                trace = std::move(recorder);
+            }
+
+        private:
+            RunSamples runs{};
+            TaskMetrics totals{};
+            std::shared_ptr<TraceRecorder> trace{};
+    };
+
+    // A run of a task scheduled for 'scheduled', expired at 'expired' and dispatched at 'dispatched'.
+    struct TaskRun
+    {
+        std::chrono::system_clock::time_point scheduled;
+        std::chrono::system_clock::time_point expired;
+        uint64_t fire_count;
+        std::chrono::steady_clock::time_point dispatched;
+    };
+
+    // The work of a task and its runs on the worker threads, kept alive by the runs while the task
+    // itself may be removed.
+    struct TaskRuns
+    {
+        TaskRuns(std::string name, uint64_t id, TaskFunction work, Overlap overlap,
+                 std::shared_ptr<TaskMetrics> metrics)
+                : name(std::move(name)), id(id), work(std::move(work)), overlap(overlap), metrics(std::move(metrics))
+        {
+        }
+
+        std::string name;
+        uint64_t id;
+        TaskFunction work;
+        Overlap overlap;
+        std::shared_ptr<TaskMetrics> metrics;
+        size_t running = 0;
+        // Runs waiting for the previous one to finish, with Overlap::Queue.
+        std::deque<TaskRun> waiting{};
+    };
+
+    // Runs the work of expired tasks on a fixed number of worker threads, so that Cron::tick only has
+    // to decide which tasks are due:
+    //
+    //      Cron<LocalClock, Locker, TaskQueue, ThreadPoolExecutor> cron;
+    //
+    // The Overlap of each task decides what happens when it expires while its previous run is still
+    // in progress. TaskInformation::get_actual_time() and get_delay() include the time the run has waited for a worker thread.
+    // Exceptions thrown by the work are caught and counted as failed runs, as there is no caller to pass them to.
+    // Runs waiting for a worker thread are unbounded, unless limited by set_max_pending().
+    class ThreadPoolExecutor
+    {
+        public:
+            explicit ThreadPoolExecutor(size_t thread_count = default_thread_count());
+
+            ~ThreadPoolExecutor();
+
+            ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+
+            ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+            void execute(Task& t, std::chrono::system_clock::time_point now);
+
+            // The worker threads record the metrics of each run as it finishes.
+            void record_metrics() noexcept
+            {
+            }
+
+            // Blocks until all dispatched runs, including those waiting for a previous run, have finished.
+            void wait_until_idle();
+
+            // Lets the current worker threads finish all dispatched runs, then starts 'count' new ones.
+            void set_thread_count(size_t count);
+
+            size_t get_thread_count() const;
+
+            // Runs expiring while 'count' runs are already dispatched but not finished are skipped, as with
+            // Overlap::Skip, rather than waiting for a worker thread. Unlimited by default.
+            void set_max_pending(size_t count);
+
+            // Number of runs skipped because the previous run of the task had not finished, or too many runs
+            // were pending.
+            size_t get_skipped() const;
+
+            // The metrics of all runs of all tasks, including those that have since been removed.
+            TaskMetrics& get_totals()
+            {
+                return totals;
+            }
+
+            const TaskMetrics& get_totals() const
+            {
+                return totals;
+            }
+
+            // Expiries are recorded by the thread calling Cron::tick, runs by the worker threads.
+            void set_trace_recorder(std::shared_ptr<TraceRecorder> recorder);
+
+            static size_t default_thread_count();
+
+        private:
+            struct Job
+            {
+                std::shared_ptr<TaskRuns> runs;
+                TaskRun run;
+            };
+
+            void start(size_t count);
+
+            void stop();
+
+            void work();
+
+            mutable std::mutex m{};
+            std::condition_variable work_available{};
+            std::condition_variable idle{};
+            std::deque<Job> jobs{};
+            std::vector<std::thread> workers{};
+            // Runs dispatched but not yet finished
+            size_t pending = 0;
+            size_t max_pending = std::numeric_limits<size_t>::max();
+            size_t skipped = 0;
+            bool stopping = false;
+            TaskMetrics totals{};
+            std::shared_ptr<TraceRecorder> trace{};
+    };
+}
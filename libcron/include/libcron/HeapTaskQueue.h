@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Task.h"
+#include "TaskSlots.h"
+
+namespace libcron
+{
+    // A task queue ordered as a 4-ary min-heap on the next expiry, usable as the queue of a Cron instance
+    // in place of the sorted TaskQueue:
+    //
+    //      Cron<LocalClock, NullLock, HeapTaskQueue> cron;
+    //
+    // The heap holds small entries referring to the tasks, which stay in place in a separate vector. Finding
+    // the next task to expire is O(1), while adding a task and rescheduling an expired one is O(log n), making
+    // the cost of a tick proportional to the number of expired tasks rather than to the total number of tasks.
+    // Each task knows its position in the heap, so removing, updating or pausing a task by name or handle is
+    // O(log n) as well.
+    template<typename LockType>
+    class HeapTaskQueue
+    {
+        public:
+            size_t size() const noexcept
+            {
+                return slots.size();
+            }
+
+            // Whether there is no task to expire; paused tasks are included in size() only.
+            bool empty() const noexcept
+            {
+                return heap.empty();
+            }
+
+            void push(Task& t)
+            {
+                push(std::move(t));
+            }
+
+            void push(Task&& t)
+            {
+                insert(slots.allocate(std::move(t)));
+            }
+
+            void push(std::vector<Task>& tasks_to_insert)
+            {
+                heap.reserve(heap.size() + tasks_to_insert.size());
+
+                for (auto& t : tasks_to_insert)
+                {
+                    auto s = slots.allocate(std::move(t));
+                    heap.push_back(Entry{ slots.task(s).get_next_schedule(), s });
+                }
+
+                make_heap();
+            }
+
+            const Task& top() const
+            {
+                return slots.task(heap[0].slot);
+            }
+
+            // Calls f(task) for every task expired at 'now', in order of expiry. f returns false if the task is
+            // to be removed, otherwise the task is moved to its new place in the heap.
+            // Returns the number of expired tasks.
+            template<typename Function>
+            size_t expire(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for every task, f returns false if the task is to be removed.
+            template<typename Function>
+            void recalculate(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for the task with the given name or handle, after which the task is moved to its new
+            // place in the heap. f returns false if the task is to be removed. Returns false if there is no such
+            // task.
+            template<typename Function>
+            bool update(const std::string& name, Function&& f)
+            {
+                return update_at(slots.find(name), f);
+            }
+
+            template<typename Function>
+            bool update(TaskHandle handle, Function&& f)
+            {
+                return update_at(slots.find(handle), f);
+            }
+
+            // Takes the task out of the heap until it is resumed. Returns false if there is no such task or it is
+            // already paused.
+            bool pause(TaskHandle handle);
+
+            // Calls f(task) for the paused task, after which it is put back into the heap. f returns false if the
+            // task is to be removed. Returns false if there is no such task or it is not paused.
+            template<typename Function>
+            bool resume(TaskHandle handle, Function&& f);
+
+            // As above, for each of the tasks. Returns the number of tasks that were paused.
+            template<typename Function>
+            size_t resume(const std::vector<TaskHandle>& handles, Function&& f)
+            {
+                size_t res = 0;
+
+                for (auto handle : handles)
+                {
+                    res += resume(handle, f) ? 1 : 0;
+                }
+
+                return res;
+            }
+
+            template<typename Function>
+            void for_each(Function&& f) const
+            {
+                for (const auto& e : heap)
+                {
+                    f(slots.task(e.slot));
+                }
+
+                if (heap.size() < slots.size())
+                {
+                    slots.for_each_paused(f);
+                }
+            }
+
+            bool contains(const std::string& name) const
+            {
+                lock.lock();
+                auto res = slots.find(name) != TaskSlots<uint32_t>::NONE;
+                lock.unlock();
+
+                return res;
+            }
+
+            void clear()
+            {
+                lock.lock();
+                heap.clear();
+                slots.clear();
+                lock.unlock();
+            }
+
+            // Returns the task with the given handle, or nullptr. The queue must be locked while using it.
+            const Task* find(TaskHandle handle) const
+            {
+                auto s = slots.find(handle);
+                return s == TaskSlots<uint32_t>::NONE ? nullptr : &slots.task(s);
+            }
+
+            // Returns the handle of the removed task, which is false if there was no such task.
+            TaskHandle remove(const std::string& to_remove)
+            {
+                lock.lock();
+                auto res = remove_slot(slots.find(to_remove));
+                lock.unlock();
+
+                return res;
+            }
+
+            TaskHandle remove(TaskHandle to_remove)
+            {
+                lock.lock();
+                auto res = remove_slot(slots.find(to_remove));
+                lock.unlock();
+
+                return res;
+            }
+
+            void lock_queue() const
+            {
+                /* Do not allow to manipulate the Queue */
+                lock.lock();
+            }
+
+            void release_queue() const
+            {
+                /* Allow Access to the Queue Manipulating-Functions */
+                lock.unlock();
+            }
+
+        private:
+            static constexpr size_t ARITY = 4;
+
+            struct Entry
+            {
+                std::chrono::system_clock::time_point next;
+                uint32_t slot;
+            };
+
+            void set(size_t i, Entry e)
+            {
+                heap[i] = e;
+                slots.data(e.slot) = static_cast<uint32_t>(i);
+            }
+
+            void insert(uint32_t s)
+            {
+                heap.push_back(Entry{ slots.task(s).get_next_schedule(), s });
+                slots.data(s) = static_cast<uint32_t>(heap.size() - 1);
+                sift_up(heap.size() - 1);
+            }
+
+            void sift_up(size_t i);
+
+            void sift_down(size_t i);
+
+            void make_heap();
+
+            void remove_at(size_t i);
+
+            TaskHandle remove_slot(uint32_t s);
+
+            template<typename Function>
+            bool update_at(uint32_t s, Function& f);
+
+            mutable LockType lock;
+            std::vector<Entry> heap{};
+            // The data of each slot is the position of its entry in the heap; paused tasks have no entry.
+            TaskSlots<uint32_t> slots{};
+    };
+
+    template<typename LockType>
+    template<typename Function>
+    size_t HeapTaskQueue<LockType>::expire(std::chrono::system_clock::time_point now, Function&& f)
+    {
+        size_t res = 0;
+
+        // Tasks that are still expired after f has been called are put back after the loop, to make sure that
+        // each task runs at most once per call.
+        std::vector<uint32_t> deferred;
+
+        try
+        {
+            while (!heap.empty() && slots.task(heap[0].slot).is_expired(now))
+            {
+                auto s = heap[0].slot;
+                auto& t = slots.task(s);
+                ++res;
+
+                if (!f(t))
+                {
+                    remove_at(0);
+                    slots.release(s);
+                }
+                else if (t.is_expired(now))
+                {
+                    remove_at(0);
+                    deferred.push_back(s);
+                }
+                else
+                {
+                    heap[0].next = t.get_next_schedule();
+                    sift_down(0);
+                }
+            }
+        }
+        catch (...)
+        {
+            // The task that threw is left at the top.
+            for (auto s : deferred)
+            {
+                insert(s);
+            }
+
+            throw;
+        }
+
+        for (auto s : deferred)
+        {
+            insert(s);
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    void HeapTaskQueue<LockType>::recalculate(std::chrono::system_clock::time_point, Function&& f)
+    {
+        size_t kept = 0;
+
+        for (size_t i = 0; i < heap.size(); ++i)
+        {
+            auto s = heap[i].slot;
+
+            if (f(slots.task(s)))
+            {
+                heap[kept++] = Entry{ slots.task(s).get_next_schedule(), s };
+            }
+            else
+            {
+                slots.release(s);
+            }
+        }
+
+        heap.resize(kept);
+        make_heap();
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool HeapTaskQueue<LockType>::update_at(uint32_t s, Function& f)
+    {
+        bool res = s != TaskSlots<uint32_t>::NONE;
+
+        if (res)
+        {
+            auto& t = slots.task(s);
+
+            if (!f(t))
+            {
+                remove_slot(s);
+            }
+            else if (!t.is_paused())
+            {
+                auto i = slots.data(s);
+                heap[i].next = t.get_next_schedule();
+                sift_down(i);
+                sift_up(slots.data(s));
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    TaskHandle HeapTaskQueue<LockType>::remove_slot(uint32_t s)
+    {
+        TaskHandle res{};
+
+        if (s != TaskSlots<uint32_t>::NONE)
+        {
+            res = slots.task(s).get_handle();
+
+            if (!slots.task(s).is_paused())
+            {
+                remove_at(slots.data(s));
+            }
+
+            slots.release(s);
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    bool HeapTaskQueue<LockType>::pause(TaskHandle handle)
+    {
+        auto s = slots.find(handle);
+        bool res = s != TaskSlots<uint32_t>::NONE && !slots.task(s).is_paused();
+
+        if (res)
+        {
+            remove_at(slots.data(s));
+            slots.task(s).set_paused(true);
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool HeapTaskQueue<LockType>::resume(TaskHandle handle, Function&& f)
+    {
+        auto s = slots.find(handle);
+        bool res = s != TaskSlots<uint32_t>::NONE && slots.task(s).is_paused();
+
+        if (res)
+        {
+            slots.task(s).set_paused(false);
+
+            if (f(slots.task(s)))
+            {
+                insert(s);
+            }
+            else
+            {
+                slots.release(s);
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    void HeapTaskQueue<LockType>::sift_up(size_t i)
+    {
+        auto e = heap[i];
+
+        while (i > 0 && e.next < heap[(i - 1) / ARITY].next)
+        {
+            auto parent = (i - 1) / ARITY;
+            set(i, heap[parent]);
+            i = parent;
+        }
+
+        set(i, e);
+    }
+
+    template<typename LockType>
+    void HeapTaskQueue<LockType>::sift_down(size_t i)
+    {
+        auto e = heap[i];
+        bool done = false;
+
+        while (!done)
+        {
+            auto first_child = i * ARITY + 1;
+            auto last_child = std::min(first_child + ARITY, heap.size());
+            auto smallest = i;
+            auto smallest_next = e.next;
+
+            for (auto c = first_child; c < last_child; ++c)
+            {
+                if (heap[c].next < smallest_next)
+                {
+                    smallest = c;
+                    smallest_next = heap[c].next;
+                }
+            }
+
+            if (smallest == i)
+            {
+                done = true;
+            }
+            else
+            {
+                set(i, heap[smallest]);
+                i = smallest;
+            }
+        }
+
+        set(i, e);
+    }
+
+    template<typename LockType>
+    void HeapTaskQueue<LockType>::make_heap()
+    {
+        for (size_t i = 0; i < heap.size(); ++i)
+        {
+            slots.data(heap[i].slot) = static_cast<uint32_t>(i);
+        }
+
+        for (auto i = heap.size() / ARITY + 1; i-- > 0;)
+        {
+            if (i < heap.size())
+            {
+                sift_down(i);
+            }
+        }
+    }
+
+    template<typename LockType>
+    void HeapTaskQueue<LockType>::remove_at(size_t i)
+    {
+        auto last = heap.back();
+        heap.pop_back();
+
+        if (i < heap.size())
+        {
+            set(i, last);
+            sift_down(i);
+            sift_up(slots.data(last.slot));
+        }
+    }
+}
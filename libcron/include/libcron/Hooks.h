@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "Task.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define LIBCRON_HAS_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define LIBCRON_HAS_RDTSC
+#endif
+
+namespace libcron
+{
+    // The hooks called by Cron::tick, given as its HookType. For each tick, in order:
+    //
+    //      on_tick_begin()                     before anything else, including reading the clock
+    //      on_clock_read(now)                  once the time of the tick is known
+    //      for each expired task:
+    //          on_task_fire(task)              before its work is run, or handed to the executor
+    //          on_task_done(task)              once it has
+    //          on_reschedule(task, keep)       once its next occurrence is calculated; keep is false when
+    //                                          it has none and is removed
+    //      on_tick_end(expired)                before the tasks are released
+    //
+    // They are called on the thread calling tick(), with the tasks locked from on_task_fire on. A policy only
+    // needs to be default constructible and have these members; NullHooks has empty inline ones, so it adds
+    // nothing to tick().
+    class NullHooks
+    {
+        public:
+            void on_tick_begin() noexcept {}
+            void on_clock_read(std::chrono::system_clock::time_point) noexcept {}
+            void on_task_fire(const Task&) noexcept {}
+            void on_task_done(const Task&) noexcept {}
+            void on_reschedule(const Task&, bool) noexcept {}
+            void on_tick_end(size_t) noexcept {}
+    };
+
+    // Time stamps for TimingHooks, in nanoseconds of std::chrono::steady_clock.
+    struct SteadyTicks
+    {
+        static uint64_t now() noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    };
+
+    // Time stamps for TimingHooks read from the time stamp counter where there is one (x86), which is several
+    // times cheaper than steady_clock. The counter runs at a fixed rate on current processors, but not
+    // necessarily one cycle per nanosecond, so the phases are best compared to each other. Elsewhere, these
+    // are SteadyTicks.
+    struct CycleTicks
+    {
+        static uint64_t now() noexcept
+        {
+#if defined(LIBCRON_HAS_RDTSC)
+            return __rdtsc();
+#else
+            return SteadyTicks::now();
+#endif
+        }
+    };
+
+    // Where the time of one or more ticks went, in the units of the time stamps.
+    struct TickPhases
+    {
+        uint64_t total() const noexcept
+        {
+            return clock + queue + callbacks + reschedule;
+        }
+
+        uint64_t ticks = 0;
+        // Expired tasks
+        uint64_t fired = 0;
+        // Reading the clock, in tick() without a time
+        uint64_t clock = 0;
+        // Locking and applying changes, finding the expired tasks, keeping the queue ordered, and publishing
+        // snapshots
+        uint64_t queue = 0;
+        // The work of the tasks, or handing it to the executor
+        uint64_t callbacks = 0;
+        // Calculating the next occurrences of the tasks
+        uint64_t reschedule = 0;
+    };
+
+    // A HookType splitting the time of each tick into the phases of TickPhases:
+    //
+    //      Cron<LocalClock, NullLock, TaskQueue, InlineExecutor, TimingHooks<CycleTicks>> cron;
+    //      ...
+    //      auto phases = cron.get_hooks().get_total();
+    //
+    // Each hook reads the time once, which is included in the phase it ends. The phases are published at the end
+    // of each tick, and may be read from any thread; each value is exact on its own, but values read together
+    // may be from different ticks.
+    template<typename Ticks = SteadyTicks>
+    class TimingHooks
+    {
+        public:
+            void on_tick_begin() noexcept
+            {
+                mark = Ticks::now();
+            }
+
+            void on_clock_read(std::chrono::system_clock::time_point) noexcept
+            {
+                current.clock = lap();
+            }
+
+            void on_task_fire(const Task&) noexcept
+            {
+                current.queue += lap();
+            }
+
+            void on_task_done(const Task&) noexcept
+            {
+                current.callbacks += lap();
+            }
+
+            void on_reschedule(const Task&, bool) noexcept
+            {
+                current.reschedule += lap();
+                ++current.fired;
+            }
+
+            void on_tick_end(size_t) noexcept
+            {
+                current.queue += lap();
+                current.ticks = 1;
+                last.store(current);
+                total.add(current);
+                current = TickPhases{};
+            }
+
+            // The last tick
+            TickPhases get_last() const noexcept
+            {
+                return last.load();
+            }
+
+            // All ticks together
+            TickPhases get_total() const noexcept
+            {
+                return total.load();
+            }
+
+        private:
+            // Written only by the thread calling tick(), so updating takes no atomic read-modify-write.
+            class Phases
+            {
+                public:
+                    void store(const TickPhases& p) noexcept
+                    {
+                        set(ticks, p.ticks);
+                        set(fired, p.fired);
+                        set(clock, p.clock);
+                        set(queue, p.queue);
+                        set(callbacks, p.callbacks);
+                        set(reschedule, p.reschedule);
+                    }
+
+                    void add(const TickPhases& p) noexcept
+                    {
+                        store(TickPhases{ get(ticks) + p.ticks, get(fired) + p.fired, get(clock) + p.clock,
+                                          get(queue) + p.queue, get(callbacks) + p.callbacks,
+                                          get(reschedule) + p.reschedule });
+                    }
+
+                    TickPhases load() const noexcept
+                    {
+                        return TickPhases{ get(ticks), get(fired), get(clock), get(queue), get(callbacks),
+                                           get(reschedule) };
+                    }
+
+                private:
+                    static uint64_t get(const std::atomic<uint64_t>& a) noexcept
+                    {
+                        return a.load(std::memory_order_relaxed);
+                    }
+
+                    static void set(std::atomic<uint64_t>& a, uint64_t value) noexcept
+                    {
+                        a.store(value, std::memory_order_relaxed);
+                    }
+
+                    std::atomic<uint64_t> ticks{ 0 };
+                    std::atomic<uint64_t> fired{ 0 };
+                    std::atomic<uint64_t> clock{ 0 };
+                    std::atomic<uint64_t> queue{ 0 };
+                    std::atomic<uint64_t> callbacks{ 0 };
+                    std::atomic<uint64_t> reschedule{ 0 };
+            };
+
+            uint64_t lap() noexcept
+            {
+                auto t = Ticks::now();
+                auto res = t - mark;
+                mark = t;
+                return res;
+            }
+
+            uint64_t mark = 0;
+            TickPhases current{};
+            Phases last{};
+            Phases total{};
+    };
+}
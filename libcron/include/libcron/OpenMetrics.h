@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Task.h"
+#include "TaskMetrics.h"
+
+namespace libcron
+{
+    // Renders the state of a Cron instance as OpenMetrics text, for Prometheus and compatible scrapers:
+    //
+    //      OpenMetricsExporter exporter;
+    //      std::string body;
+    //      exporter.render(cron, body);
+    //
+    // Besides the metrics of all tasks together, each task that has run gets its own series, labelled with
+    // its name. As each of these includes a histogram, they are limited to the max_tasks tasks with the highest
+    // total delay; the tasks are only locked while choosing them, not while rendering. Chosen tasks sharing a
+    // name are exported as a single series, adding up their counters and histograms.
+    //
+    // The exporter keeps its memory between calls, as may the caller with the text, so rendering does not
+    // allocate once both have grown to size. An exporter is to be used by one thread at a time.
+    class OpenMetricsExporter
+    {
+        public:
+            static constexpr size_t DEFAULT_MAX_TASKS = 1000;
+
+            explicit OpenMetricsExporter(size_t max_tasks = DEFAULT_MAX_TASKS)
+                    : max_tasks(max_tasks)
+            {
+            }
+
+            // Appends the text, ending with "# EOF", to 'out'.
+            template<typename CronType>
+            void render(const CronType& cron, std::string& out)
+            {
+                chosen = 0;
+                dropped = 0;
+
+                cron.for_each_metrics([this](const Task& t, const TaskMetrics& metrics)
+                                      {
+                                          choose(t, metrics);
+                                      });
+
+                auto until_next = cron.time_until_next();
+                bool has_next = until_next != std::chrono::system_clock::duration{ std::numeric_limits<std::chrono::minutes>::max() };
+
+                render(cron.count(), has_next, until_next, cron.get_tick_metrics(), cron.get_totals(), out);
+            }
+
+        private:
+            static constexpr size_t NOT_MERGED = std::numeric_limits<size_t>::max();
+
+            struct Entry
+            {
+                std::chrono::microseconds total_delay{};
+                std::string name{};
+                std::shared_ptr<const TaskMetrics> metrics{};
+                // The counters of the series, added up over the tasks sharing the name
+                uint64_t runs = 0;
+                uint64_t skipped = 0;
+                uint64_t missed = 0;
+                uint64_t failed = 0;
+                // Index of the delays in 'merged_delays' when several tasks share the name
+                size_t merged = NOT_MERGED;
+            };
+
+            // Turns the chosen entries, ordered by name, into one entry per name.
+            void merge_names();
+
+            // Keeps the task if it is among the max_tasks tasks with the highest total delay so far; the tasks
+            // are locked.
+            void choose(const Task& t, const TaskMetrics& metrics);
+
+            void render(size_t tasks, bool has_next, std::chrono::system_clock::duration until_next,
+                        const TickMetrics& ticks, const TaskMetrics& totals, std::string& out);
+
+            size_t max_tasks;
+            // The first 'chosen' entries are the chosen tasks, kept as a min-heap on the total delay while
+            // choosing. The others are kept for their memory.
+            std::vector<Entry> entries{};
+            size_t chosen = 0;
+            // The delays of tasks sharing a name, added up; kept for their memory as the entries are.
+            std::vector<LatencyCounts> merged_delays{};
+            // Tasks that have run, but are not chosen
+            size_t dropped = 0;
+    };
+}
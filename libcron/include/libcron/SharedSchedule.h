@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include "CronData.h"
+#include "CronSchedule.h"
+
+namespace libcron
+{
+    // A schedule shared by the tasks of a Cron instance that have identical schedules. It remembers the last
+    // occurrence it calculated, so that tasks expiring together, or recalculated together after a clock change,
+    // calculate their next occurrence once rather than once per task.
+    class SharedSchedule
+    {
+        public:
+            explicit SharedSchedule(const CronSchedule& schedule)
+                    : schedule(schedule)
+            {
+            }
+
+            const CronSchedule& get_schedule() const
+            {
+                return schedule;
+            }
+
+            std::tuple<bool, std::chrono::system_clock::time_point>
+            calculate_from(std::chrono::system_clock::time_point from)
+            {
+                if (!calculated || from != last_from)
+                {
+                    last_result = schedule.calculate_from(from);
+                    last_from = from;
+                    calculated = true;
+                }
+
+                return last_result;
+            }
+
+        private:
+            CronSchedule schedule;
+            bool calculated = false;
+            std::chrono::system_clock::time_point last_from{};
+            std::tuple<bool, std::chrono::system_clock::time_point> last_result{};
+    };
+
+    // The distinct schedules of a Cron instance, so that memory for schedules grows with the number of distinct
+    // expressions rather than with the number of tasks. Not thread safe; Cron only uses it while the tasks are locked.
+    class SharedSchedules
+    {
+        public:
+            // Returns the shared schedule allowing the same time points as 'schedule', adding it if there is none.
+            std::shared_ptr<SharedSchedule> get(const CronSchedule& schedule)
+            {
+                auto it = schedules.find(schedule.get_data());
+
+                if (it != schedules.end())
+                {
+                    return it->second;
+                }
+
+                if (schedules.size() >= purge_at)
+                {
+                    purge();
+                }
+
+                auto res = std::make_shared<SharedSchedule>(schedule);
+                schedules.emplace(schedule.get_data(), res);
+
+                return res;
+            }
+
+            // Number of distinct schedules, including those of removed tasks that have not been purged yet.
+            size_t size() const
+            {
+                return schedules.size();
+            }
+
+        private:
+            struct Hash
+            {
+                size_t operator()(const CronData& data) const
+                {
+                    return data.hash();
+                }
+            };
+
+            // Drops the schedules no task uses any more. Purging again only once the number of schedules has
+            // doubled keeps the cost of purging constant per added schedule.
+            void purge()
+            {
+                for (auto it = schedules.begin(); it != schedules.end();)
+                {
+                    if (it->second.use_count() == 1)
+                    {
+                        it = schedules.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+
+                purge_at = std::max(MIN_PURGE_AT, schedules.size() * 2);
+            }
+
+            static constexpr size_t MIN_PURGE_AT = 64;
+
+            std::unordered_map<CronData, std::shared_ptr<SharedSchedule>, Hash> schedules{};
+            size_t purge_at = MIN_PURGE_AT;
+    };
+}
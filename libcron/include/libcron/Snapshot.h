@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace libcron
+{
+    // The state of a task when a Snapshot was taken.
+    struct TaskSnapshot
+    {
+        std::string name{};
+        std::chrono::system_clock::time_point next{};
+        // time_point::min() if the task has not run yet.
+        std::chrono::system_clock::time_point last_run{};
+        // The delay of the last run in relation to its schedule.
+        std::chrono::system_clock::duration delay{};
+        // A paused task does not expire, and its next expiry is not meaningful.
+        bool paused = false;
+    };
+
+    // A read-only copy of the state of all tasks, as of 'taken' according to the clock of the Cron instance.
+    struct Snapshot
+    {
+        std::chrono::system_clock::time_point taken{};
+        std::vector<TaskSnapshot> tasks{};
+        // Counts the snapshots published by the Cron instance, which uses it to update recycled snapshots.
+        uint64_t version = 0;
+    };
+
+    // Holds the latest snapshot. Readers take a reference to it and keep it alive for as long as they use it,
+    // so they never see a partially written snapshot. The pointer to it is loaded and replaced atomically; readers
+    // never wait while a snapshot is written, nor for the tasks to be unlocked.
+    //
+    // Snapshots are recycled: when the last reference to a replaced snapshot goes away, it is handed back to be
+    // written again by the next publish(), which keeps its memory, including that of the names, for reuse.
+    class SnapshotPublisher
+    {
+        public:
+            // May be called from any thread; never returns null.
+            std::shared_ptr<const Snapshot> load() const
+            {
+                auto res = std::atomic_load(&current);
+                return res ? res : empty();
+            }
+
+            // Calls fill(snapshot) to write the next snapshot and publishes it. Only one thread may publish
+            // at a time.
+            template<typename Fill>
+            void publish(Fill&& fill)
+            {
+                std::unique_ptr<Snapshot> next;
+
+                {
+                    std::lock_guard<std::mutex> lock(recycled->m);
+                    next = std::move(recycled->spare);
+                }
+
+                if (!next)
+                {
+                    next = std::make_unique<Snapshot>();
+                }
+
+                fill(*next);
+
+                std::shared_ptr<const Snapshot> published{ next.release(), Recycle{ recycled } };
+
+                // The previous snapshot is recycled here, unless a reader still holds it.
+                std::atomic_exchange(&current, std::move(published));
+            }
+
+        private:
+            // Shared with the snapshots, which may outlive the publisher.
+            struct Recycled
+            {
+                std::mutex m{};
+                std::unique_ptr<Snapshot> spare{};
+            };
+
+            struct Recycle
+            {
+                void operator()(const Snapshot* s) const
+                {
+                    std::unique_ptr<Snapshot> previous{ const_cast<Snapshot*>(s) };
+                    std::lock_guard<std::mutex> lock(recycled->m);
+                    recycled->spare.swap(previous);
+                }
+
+                std::shared_ptr<Recycled> recycled;
+            };
+
+            static std::shared_ptr<const Snapshot> empty()
+            {
+                static const auto res = std::make_shared<const Snapshot>();
+                return res;
+            }
+
+            // Only accessed through std::atomic_load() and std::atomic_exchange()
+            std::shared_ptr<const Snapshot> current{};
+            std::shared_ptr<Recycled> recycled = std::make_shared<Recycled>();
+    };
+}
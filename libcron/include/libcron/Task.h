@@ -2,47 +2,215 @@
 
 #include <functional>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 #include "CronData.h"
 #include "CronSchedule.h"
+#include "SharedSchedule.h"
+#include "TaskFunction.h"
+#include "TaskHandle.h"
+#include "TaskMetrics.h"
 
 namespace libcron
 {
+    // Information about a run of a task, passed to its work. It refers to the name of the task, so it must not
+    // be kept beyond the call.
     class TaskInformation
     {
         public:
-            virtual ~TaskInformation() = default;
-            virtual std::chrono::system_clock::duration get_delay() const = 0;
-            virtual std::string get_name() const = 0;
+            TaskInformation(std::string_view name, uint64_t id, std::chrono::system_clock::time_point scheduled,
+                            std::chrono::system_clock::time_point actual, uint64_t fire_count)
+                    : name(name), id(id), scheduled(scheduled), actual(actual), fire_count(fire_count)
+            {
+            }
+
+            std::string_view get_name() const
+            {
+                return name;
+            }
+
+            // Identifies the task within its Cron instance.
+            uint64_t get_id() const
+            {
+                return id;
+            }
+
+            // When the task was scheduled to run
+            std::chrono::system_clock::time_point get_scheduled_time() const
+            {
+                return scheduled;
+            }
+
+            // When the task was run
+            std::chrono::system_clock::time_point get_actual_time() const
+            {
+                return actual;
+            }
+
+            std::chrono::system_clock::duration get_delay() const
+            {
+                return actual - scheduled;
+            }
+
+            // The number of times the task has expired, including this one.
+            uint64_t get_fire_count() const
+            {
+                return fire_count;
+            }
+
+        private:
+            std::string_view name;
+            uint64_t id;
+            std::chrono::system_clock::time_point scheduled;
+            std::chrono::system_clock::time_point actual;
+            uint64_t fire_count;
     };
 
-    class Task : public TaskInformation
+    // What to do when a task expires while its previous run has not yet finished. Only applies when the work
+    // is run on other threads, see ThreadPoolExecutor.
+    enum class Overlap
+    {
+        // Do not run the task this time.
+        Skip,
+        // Run the task once the previous run has finished.
+        Queue,
+        // Run the task alongside the previous run.
+        Concurrent
+    };
+
+    struct TaskRuns;
+
+    class Task
     {
         public:
-            using TaskFunction = std::function<void(const TaskInformation&)>;
+            using TaskFunction = libcron::TaskFunction;
+
+            Task(std::string name, const CronSchedule schedule, TaskFunction task, Overlap overlap = Overlap::Skip)
+                    : Task(std::move(name), std::make_shared<SharedSchedule>(schedule), std::move(task), overlap)
+            {
+            }
 
-            Task(std::string name, const CronSchedule schedule, TaskFunction task)
-                    : name(std::move(name)), schedule(std::move(schedule)), task(std::move(task))
+            Task(std::string name, std::shared_ptr<SharedSchedule> schedule, TaskFunction task, Overlap overlap = Overlap::Skip)
+                    : name(std::move(name)), schedule(std::move(schedule)), task(std::move(task)), overlap(overlap)
             {
             }
 
             void execute(std::chrono::system_clock::time_point now)
+            {
+                start(now);
+                task(TaskInformation{ name, id, next_schedule, now, fire_count });
+            }
+
+            // Records a run at 'now' without running the work, for when the work is run elsewhere.
+            void start(std::chrono::system_clock::time_point now)
             {
                 // Next Schedule is still the current schedule, calculate delay (actual execution - planned execution)
                 delay = now - next_schedule;
 
+                allowed_from = now;
                 last_run = now;
-                task(*this);
+                ++fire_count;
+
+                if (!metrics)
+                {
+                    metrics = std::make_shared<TaskMetrics>();
+                }
+            }
+
+            // Counts a run skipped at expiry, leaving the last run, delay and fire count of the task as they were.
+            void record_skip()
+            {
+                if (!metrics)
+                {
+                    metrics = std::make_shared<TaskMetrics>();
+                }
+
+                metrics->record_skip();
+            }
+
+            // Counts a miss if the task expired so late, at 'now', that occurrences after the one it was
+            // 'scheduled' for have passed. Returns whether it did.
+            bool check_missed(std::chrono::system_clock::time_point scheduled, std::chrono::system_clock::time_point now);
+
+            const TaskFunction& get_work() const
+            {
+                return task;
+            }
+
+            // Moves the work out of the task, for when it is run elsewhere from then on.
+            TaskFunction take_work()
+            {
+                return std::move(task);
+            }
+
+            Overlap get_overlap() const
+            {
+                return overlap;
+            }
+
+            // State shared with the runs of the task on other threads; created by the executor on first use.
+            std::shared_ptr<TaskRuns>& get_runs()
+            {
+                return runs;
             }
 
-            std::chrono::system_clock::duration get_delay() const override
+            std::chrono::system_clock::duration get_delay() const
             {
                 return delay;
             }
 
-            Task(const Task& other) = default;
+            // The metrics of the runs of the task, created when it first expires; they are shared with the
+            // executor, which may record runs on other threads.
+            const std::shared_ptr<TaskMetrics>& get_metrics() const
+            {
+                return metrics;
+            }
+
+            uint64_t get_id() const
+            {
+                return id;
+            }
+
+            void set_id(uint64_t new_id)
+            {
+                id = new_id;
+            }
+
+            uint64_t get_fire_count() const
+            {
+                return fire_count;
+            }
+
+            TaskHandle get_handle() const
+            {
+                return handle;
+            }
+
+            void set_handle(TaskHandle new_handle)
+            {
+                handle = new_handle;
+            }
+
+            // A paused task is kept by its queue, but does not expire until it is resumed.
+            bool is_paused() const
+            {
+                return paused;
+            }
+
+            void set_paused(bool pause)
+            {
+                paused = pause;
+            }
+
+            Task(const Task& other) = delete;
 
-            Task& operator=(const Task&) = default;
+            Task& operator=(const Task&) = delete;
+
+            Task(Task&&) = default;
+
+            Task& operator=(Task&&) = default;
 
             bool calculate_next(std::chrono::system_clock::time_point from);
 
@@ -61,21 +229,59 @@ namespace libcron
             std::chrono::system_clock::duration
             time_until_expiry(std::chrono::system_clock::time_point now) const;
 
-            std::string get_name() const override
+            const std::string& get_name() const
             {
                 return name;
             }
 
+            std::chrono::system_clock::time_point get_next_schedule() const
+            {
+                return next_schedule;
+            }
+
+            // When the task last ran, time_point::min() if it has not run yet.
+            std::chrono::system_clock::time_point get_last_run() const
+            {
+                return last_run;
+            }
+
+            // The next schedule must be calculated again after changing the schedule.
+            void set_schedule(const CronSchedule& new_schedule)
+            {
+                schedule = std::make_shared<SharedSchedule>(new_schedule);
+            }
+
+            // Shares the calculation of the next schedule with other tasks; the schedule must be used by one
+            // thread at a time.
+            void set_schedule(std::shared_ptr<SharedSchedule> new_schedule)
+            {
+                schedule = std::move(new_schedule);
+            }
+
+            const CronSchedule& get_schedule() const
+            {
+                return schedule->get_schedule();
+            }
+
             std::string get_status(std::chrono::system_clock::time_point now) const;
 
         private:
             std::string name;
-            CronSchedule schedule;
+            uint64_t id = 0;
+            uint64_t fire_count = 0;
+            TaskHandle handle{};
+            bool paused = false;
+            std::shared_ptr<SharedSchedule> schedule;
             std::chrono::system_clock::time_point next_schedule;
             std::chrono::system_clock::duration delay = std::chrono::seconds(-1);
             TaskFunction task;
+            Overlap overlap = Overlap::Skip;
+            std::shared_ptr<TaskRuns> runs{};
+            std::shared_ptr<TaskMetrics> metrics{};
             bool valid = false;
-            std::chrono::system_clock::time_point last_run = std::numeric_limits<std::chrono::system_clock::time_point>::min();
+            // The task does not expire before this point, so that it does not run twice when the clock goes back.
+            std::chrono::system_clock::time_point allowed_from = std::numeric_limits<std::chrono::system_clock::time_point>::min();
+            std::chrono::system_clock::time_point last_run = std::chrono::system_clock::time_point::min();
     };
 }
 
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace libcron
+{
+    class TaskInformation;
+
+    // The work of a task. Unlike std::function it only needs to be movable, so it accepts lambdas capturing
+    // move-only values, and it stores callables of up to INLINE_SIZE bytes without allocating.
+    class TaskFunction
+    {
+        public:
+            static constexpr size_t INLINE_SIZE = 6 * sizeof(void*);
+
+            TaskFunction() noexcept = default;
+
+            TaskFunction(std::nullptr_t) noexcept
+            {
+            }
+
+            template<typename F,
+                     typename = std::enable_if_t<!std::is_same<std::decay_t<F>, TaskFunction>::value
+                                                 && std::is_invocable<std::decay_t<F>&, const TaskInformation&>::value>>
+            TaskFunction(F&& f)
+            {
+                using Target = std::decay_t<F>;
+
+                if constexpr (is_inline<Target>())
+                {
+                    new(&storage) Target(std::forward<F>(f));
+                    operations = &inline_operations<Target>;
+                }
+                else
+                {
+                    new(&storage) Target*(new Target(std::forward<F>(f)));
+                    operations = &heap_operations<Target>;
+                }
+            }
+
+            TaskFunction(TaskFunction&& other) noexcept
+            {
+                take(other);
+            }
+
+            TaskFunction& operator=(TaskFunction&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    reset();
+                    take(other);
+                }
+
+                return *this;
+            }
+
+            TaskFunction(const TaskFunction&) = delete;
+
+            TaskFunction& operator=(const TaskFunction&) = delete;
+
+            ~TaskFunction()
+            {
+                reset();
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return operations != nullptr;
+            }
+
+            // Throws std::bad_function_call when empty, as std::function does.
+            void operator()(const TaskInformation& info) const
+            {
+                if (operations == nullptr)
+                {
+                    throw std::bad_function_call{};
+                }
+
+                operations->invoke(&storage, info);
+            }
+
+            // Whether a callable of type F is stored without allocating.
+            template<typename F>
+            static constexpr bool is_inline()
+            {
+                return sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(Storage)
+                       && std::is_nothrow_move_constructible<F>::value;
+            }
+
+        private:
+            struct Storage
+            {
+                alignas(std::max_align_t) unsigned char bytes[INLINE_SIZE];
+            };
+
+            struct Operations
+            {
+                void (* invoke)(Storage* s, const TaskInformation& info);
+                // Moves the callable from 'from' to the uninitialised 'to', and destroys it in 'from'.
+                void (* relocate)(Storage* from, Storage* to) noexcept;
+                void (* destroy)(Storage* s) noexcept;
+            };
+
+            template<typename F>
+            static F* inline_target(Storage* s)
+            {
+                return std::launder(reinterpret_cast<F*>(s));
+            }
+
+            template<typename F>
+            static F*& heap_target(Storage* s)
+            {
+                return *std::launder(reinterpret_cast<F**>(s));
+            }
+
+            template<typename F>
+            static constexpr Operations inline_operations{
+                    [](Storage* s, const TaskInformation& info)
+                    {
+                        (*inline_target<F>(s))(info);
+                    },
+                    [](Storage* from, Storage* to) noexcept
+                    {
+                        new(to) F(std::move(*inline_target<F>(from)));
+                        inline_target<F>(from)->~F();
+                    },
+                    [](Storage* s) noexcept
+                    {
+                        inline_target<F>(s)->~F();
+                    }
+            };
+
+            template<typename F>
+            static constexpr Operations heap_operations{
+                    [](Storage* s, const TaskInformation& info)
+                    {
+                        (*heap_target<F>(s))(info);
+                    },
+                    [](Storage* from, Storage* to) noexcept
+                    {
+                        new(to) F*(heap_target<F>(from));
+                    },
+                    [](Storage* s) noexcept
+                    {
+                        delete heap_target<F>(s);
+                    }
+            };
+
+            void take(TaskFunction& other) noexcept
+            {
+                if (other.operations != nullptr)
+                {
+                    other.operations->relocate(&other.storage, &storage);
+                    operations = other.operations;
+                    other.operations = nullptr;
+                }
+            }
+
+            void reset() noexcept
+            {
+                if (operations != nullptr)
+                {
+                    operations->destroy(&storage);
+                    operations = nullptr;
+                }
+            }
+
+            // Mutable, as calling the work may change it, just like with std::function.
+            mutable Storage storage;
+            const Operations* operations = nullptr;
+    };
+
+    // Work shared by several tasks, such as those added together by Cron::add_schedule(map, work). Copies refer to
+    // the same callable, which is destroyed with the last of them; each copy is small enough to be stored inline.
+    class SharedTaskFunction
+    {
+        public:
+            explicit SharedTaskFunction(TaskFunction work)
+                    : work(std::make_shared<TaskFunction>(std::move(work)))
+            {
+            }
+
+            void operator()(const TaskInformation& info) const
+            {
+                (*work)(info);
+            }
+
+        private:
+            std::shared_ptr<TaskFunction> work;
+    };
+}
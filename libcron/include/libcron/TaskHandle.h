@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace libcron
+{
+    // Identifies a task of a Cron instance, as returned by Cron::add_schedule. The index locates the task
+    // directly, while the generation tells it apart from earlier and later tasks using the same index, so the
+    // handle of a removed task never refers to another task. A default constructed handle refers to no task.
+    class TaskHandle
+    {
+        public:
+            constexpr TaskHandle() noexcept = default;
+
+            constexpr TaskHandle(uint32_t index, uint32_t generation) noexcept
+                    : index(index), generation(generation)
+            {
+            }
+
+            constexpr uint32_t get_index() const noexcept
+            {
+                return index;
+            }
+
+            constexpr uint32_t get_generation() const noexcept
+            {
+                return generation;
+            }
+
+            // False for a default constructed handle, and when adding a task failed.
+            constexpr explicit operator bool() const noexcept
+            {
+                return generation != 0;
+            }
+
+            constexpr bool operator==(const TaskHandle& other) const noexcept
+            {
+                return index == other.index && generation == other.generation;
+            }
+
+            constexpr bool operator!=(const TaskHandle& other) const noexcept
+            {
+                return !(*this == other);
+            }
+
+        private:
+            uint32_t index = 0;
+            uint32_t generation = 0;
+    };
+
+    // The state of a task, as returned by Cron::get_status.
+    struct TaskStatus
+    {
+        bool paused = false;
+        // Not meaningful while the task is paused; its next expiry is calculated when it is resumed.
+        std::chrono::system_clock::time_point next{};
+        // time_point::min() if the task has not run yet.
+        std::chrono::system_clock::time_point last_run{};
+        uint64_t fire_count = 0;
+    };
+
+    // Hands out the handles of a Cron instance, reusing the indexes of released handles with a new generation.
+    // May be used from any thread without locking; a handle is only released once its task has been removed from
+    // the queue. Released indexes are kept on a lock-free stack, whose head holds a tag that changes on every
+    // update so that it cannot be swapped for an index that was taken and put back meanwhile.
+    class TaskHandles
+    {
+        public:
+            TaskHandles() = default;
+
+            ~TaskHandles();
+
+            TaskHandles(const TaskHandles&) = delete;
+
+            TaskHandles& operator=(const TaskHandles&) = delete;
+
+            TaskHandle allocate();
+
+            void release(TaskHandle handle);
+
+        private:
+            struct Entry
+            {
+                // Only changed by the thread releasing the index, before it is put on the stack.
+                std::atomic<uint32_t> generation{ 1 };
+                // The next free index plus one, while on the stack
+                std::atomic<uint32_t> next{ 0 };
+            };
+
+            // Indexes are kept in chunks of doubling size, which never move once allocated.
+            static constexpr uint32_t FIRST_CHUNK = 64;
+            static constexpr size_t CHUNKS = 27;
+
+            Entry& entry(uint32_t index);
+
+            std::array<std::atomic<Entry*>, CHUNKS> chunks{};
+            std::atomic<uint32_t> used{ 0 };
+            // The tag in the upper half, the first free index plus one in the lower half
+            std::atomic<uint64_t> free_head{ 0 };
+    };
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libcron
+{
+    // Hints that the memory is about to be written to.
+    inline void prefetch_for_write(const void* p) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p, 1);
+#else
+        (void)p;
+#endif
+    }
+
+    // The buckets of a latency histogram. As in HdrHistogram, values are in microseconds and each power of two
+    // is split into SUB_BUCKETS buckets, so that a value is known to within a quarter of itself with a fixed
+    // number of buckets. Values of 2^32 microseconds (about 71 minutes) or more share the last bucket.
+    class LatencyBuckets
+    {
+        public:
+            static constexpr size_t SUB_BUCKETS = 4;
+            static constexpr size_t COUNT = SUB_BUCKETS * 31;
+
+            static size_t index_of(std::chrono::nanoseconds d) noexcept
+            {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+                auto v = static_cast<uint32_t>(std::clamp<int64_t>(us, 0, UINT32_MAX));
+                size_t res = v;
+
+                if (v >= SUB_BUCKETS)
+                {
+                    auto power = log2(v);
+                    res = SUB_BUCKETS * (power - 1) + ((v >> (power - 2)) & (SUB_BUCKETS - 1));
+                }
+
+                return res;
+            }
+
+            // The highest value counted in the bucket
+            static std::chrono::microseconds highest(size_t index) noexcept;
+
+        private:
+            static size_t log2(uint32_t v) noexcept
+            {
+                size_t res = 0;
+
+                for (size_t shift = 16; shift > 0; shift /= 2)
+                {
+                    if (v >= (uint32_t{ 1 } << shift))
+                    {
+                        v >>= shift;
+                        res += shift;
+                    }
+                }
+
+                return res;
+            }
+    };
+
+    // A latency histogram that may be recorded to from any thread while being read from others. Recording is a
+    // single relaxed atomic increment; the counts of a single bucket wrap after 2^32 values.
+    class LatencyHistogram
+    {
+        public:
+            void record(std::chrono::nanoseconds d) noexcept
+            {
+                counts[LatencyBuckets::index_of(d)].fetch_add(1, std::memory_order_relaxed);
+            }
+
+            uint32_t count(size_t index) const noexcept
+            {
+                return counts[index].load(std::memory_order_relaxed);
+            }
+
+            void prefetch(std::chrono::nanoseconds d) const noexcept
+            {
+                prefetch_for_write(&counts[LatencyBuckets::index_of(d)]);
+            }
+
+        private:
+            std::array<std::atomic<uint32_t>, LatencyBuckets::COUNT> counts{};
+    };
+
+    // The counts of one or more latency histograms, added together.
+    class LatencyCounts
+    {
+        public:
+            void add(const LatencyHistogram& histogram) noexcept;
+
+            void add(const LatencyCounts& other) noexcept;
+
+            uint64_t count(size_t index) const noexcept
+            {
+                return counts[index];
+            }
+
+            uint64_t total() const noexcept;
+
+            // The value that the given fraction (0 to 1) of the values are at or below, rounded up to the highest
+            // value of its bucket. Zero when there are no values.
+            std::chrono::microseconds value_at_quantile(double quantile) const noexcept;
+
+        private:
+            std::array<uint64_t, LatencyBuckets::COUNT> counts{};
+    };
+
+    // Counters of the runs of a task, kept by Cron and its executor. They are updated with relaxed atomic
+    // operations, so they may be read from any thread while the task runs; each value is exact on its own, but
+    // values read together may be from different runs.
+    class TaskMetrics
+    {
+        public:
+            // A run that started 'delay' after it was scheduled, and took 'run_time'.
+            void record_run(std::chrono::nanoseconds delay, std::chrono::nanoseconds run_time) noexcept
+            {
+                auto delay_us = to_microseconds(delay);
+                auto run_time_us = to_microseconds(run_time);
+                runs.fetch_add(1, std::memory_order_relaxed);
+                last_delay.store(delay_us, std::memory_order_relaxed);
+                last_run_time.store(run_time_us, std::memory_order_relaxed);
+                total_delay.fetch_add(delay_us, std::memory_order_relaxed);
+                total_run_time.fetch_add(run_time_us, std::memory_order_relaxed);
+                delays.record(delay);
+                run_times.record(run_time);
+            }
+
+            // Fetches what record_run(delay, run_time) writes to.
+            void prefetch(std::chrono::nanoseconds delay, std::chrono::nanoseconds run_time) const noexcept
+            {
+                prefetch_for_write(&runs);
+                delays.prefetch(delay);
+                run_times.prefetch(run_time);
+            }
+
+            // The task expired while its previous run had not finished, and did not run, see Overlap::Skip.
+            void record_skip() noexcept
+            {
+                skipped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // The task expired so late that one or more of its occurrences passed without it running.
+            void record_miss() noexcept
+            {
+                missed.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // A run ended by throwing an exception; it is recorded as a run as well.
+            void record_failure() noexcept
+            {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // The number of finished runs
+            uint64_t get_runs() const noexcept
+            {
+                return runs.load(std::memory_order_relaxed);
+            }
+
+            uint64_t get_skipped() const noexcept
+            {
+                return skipped.load(std::memory_order_relaxed);
+            }
+
+            uint64_t get_missed() const noexcept
+            {
+                return missed.load(std::memory_order_relaxed);
+            }
+
+            uint64_t get_failed() const noexcept
+            {
+                return failed.load(std::memory_order_relaxed);
+            }
+
+            std::chrono::microseconds get_last_delay() const noexcept
+            {
+                return std::chrono::microseconds{ last_delay.load(std::memory_order_relaxed) };
+            }
+
+            std::chrono::microseconds get_last_run_time() const noexcept
+            {
+                return std::chrono::microseconds{ last_run_time.load(std::memory_order_relaxed) };
+            }
+
+            // The sums of the delays and run times of all runs
+            std::chrono::microseconds get_total_delay() const noexcept
+            {
+                return std::chrono::microseconds{ total_delay.load(std::memory_order_relaxed) };
+            }
+
+            std::chrono::microseconds get_total_run_time() const noexcept
+            {
+                return std::chrono::microseconds{ total_run_time.load(std::memory_order_relaxed) };
+            }
+
+            // The time from when runs were scheduled until they started, including any wait for a worker thread.
+            const LatencyHistogram& get_delays() const noexcept
+            {
+                return delays;
+            }
+
+            const LatencyHistogram& get_run_times() const noexcept
+            {
+                return run_times;
+            }
+
+        private:
+            static int64_t to_microseconds(std::chrono::nanoseconds d) noexcept
+            {
+                return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+            }
+
+            std::atomic<uint64_t> runs{ 0 };
+            std::atomic<uint64_t> skipped{ 0 };
+            std::atomic<uint64_t> missed{ 0 };
+            std::atomic<uint64_t> failed{ 0 };
+            std::atomic<int64_t> last_delay{ 0 };
+            std::atomic<int64_t> last_run_time{ 0 };
+            std::atomic<int64_t> total_delay{ 0 };
+            std::atomic<int64_t> total_run_time{ 0 };
+            LatencyHistogram delays{};
+            LatencyHistogram run_times{};
+    };
+
+    // Runs on the thread calling Cron::tick, recorded to the metrics of their tasks in one go at the end of the
+    // tick. The metrics of a task are rarely in the cache when it runs; recording the runs together lets the
+    // metrics of the next runs be fetched while recording one, rather than waiting for each in turn.
+    class RunSamples
+    {
+        public:
+            void add(TaskMetrics& metrics, std::chrono::nanoseconds delay, std::chrono::nanoseconds run_time)
+            {
+                samples.push_back(Sample{ &metrics, delay, run_time });
+            }
+
+            // Records the runs added since the last call to the metrics of their tasks, which must still exist, and
+            // to 'totals'.
+            void record(TaskMetrics& totals) noexcept;
+
+        private:
+            struct Sample
+            {
+                TaskMetrics* metrics;
+                std::chrono::nanoseconds delay;
+                std::chrono::nanoseconds run_time;
+            };
+
+            std::vector<Sample> samples{};
+    };
+
+    // The durations of the ticks of a Cron instance, updated as the metrics of tasks are.
+    class TickMetrics
+    {
+        public:
+            void record(std::chrono::nanoseconds duration) noexcept
+            {
+                ticks.fetch_add(1, std::memory_order_relaxed);
+                total_time.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+                                     std::memory_order_relaxed);
+                durations.record(duration);
+            }
+
+            uint64_t get_ticks() const noexcept
+            {
+                return ticks.load(std::memory_order_relaxed);
+            }
+
+            std::chrono::microseconds get_total_time() const noexcept
+            {
+                return std::chrono::microseconds{ total_time.load(std::memory_order_relaxed) };
+            }
+
+            const LatencyHistogram& get_durations() const noexcept
+            {
+                return durations;
+            }
+
+        private:
+            std::atomic<uint64_t> ticks{ 0 };
+            std::atomic<int64_t> total_time{ 0 };
+            LatencyHistogram durations{};
+    };
+
+    // The metrics of one or more tasks, added together. For several tasks, the last delay and run time are the
+    // highest of any of them.
+    struct MetricsSummary
+    {
+        void add(const TaskMetrics& metrics) noexcept;
+
+        size_t tasks = 0;
+        uint64_t runs = 0;
+        uint64_t skipped = 0;
+        uint64_t missed = 0;
+        uint64_t failed = 0;
+        std::chrono::microseconds last_delay{};
+        std::chrono::microseconds last_run_time{};
+        std::chrono::microseconds total_delay{};
+        std::chrono::microseconds total_run_time{};
+        LatencyCounts delays{};
+        LatencyCounts run_times{};
+    };
+}
@@ -1,115 +1,536 @@
 #pragma once
 
-#include <vector>
-#include <map>
-#include <unordered_map>
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include "Task.h"
+#include "TaskSlots.h"
 
 namespace libcron
-{           
+{
+    // The default task queue; a vector of references to the tasks, sorted on their next expiry.
+    // Removed tasks leave a marker in the vector that is skipped and cleaned up later, making removal by name or
+    // handle O(log n) instead of requiring the following entries to be moved.
     template<typename LockType>
     class TaskQueue
     {
         public:
-            const std::vector<Task>& get_tasks() const
-            {
-                return c;
-            }
-            
-            std::vector<Task>& get_tasks()
-            {
-                return c;
-            }
-            
             size_t size() const noexcept
             {
-                return c.size();
+                return slots.size();
             }
-            
+
+            // Whether there is no task to expire; paused tasks are included in size() only.
             bool empty() const noexcept
             {
-                return c.empty();
+                return slots.size() == paused;
             }
-            
+
             void push(Task& t)
             {
-                c.push_back(std::move(t));
+                push(std::move(t));
             }
-            
+
             void push(Task&& t)
             {
-                c.push_back(std::move(t));
+                auto s = slots.allocate(std::move(t));
+                insert(Entry{ slots.task(s).get_next_schedule(), s });
             }
-            
+
             void push(std::vector<Task>& tasks_to_insert)
             {
-                c.reserve(c.size() + tasks_to_insert.size());
-                c.insert(c.end(), std::make_move_iterator(tasks_to_insert.begin()), std::make_move_iterator(tasks_to_insert.end()));
+                entries.reserve(entries.size() + tasks_to_insert.size());
+
+                for (auto& t : tasks_to_insert)
+                {
+                    auto s = slots.allocate(std::move(t));
+                    entries.push_back(Entry{ slots.task(s).get_next_schedule(), s });
+                }
+
+                sort();
             }
-            
+
             const Task& top() const
             {
-                return c[0];
+                return slots.task(entries[first].slot);
             }
-            
-            Task& at(const size_t i)
+
+            // Calls f(task) for every task expired at 'now'. f returns false if the task is to be removed.
+            // Returns the number of expired tasks.
+            template<typename Function>
+            size_t expire(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for every task, f returns false if the task is to be removed.
+            template<typename Function>
+            void recalculate(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for the task with the given name or handle, after which the task is moved to its new
+            // place in the queue. f returns false if the task is to be removed. Returns false if there is no such
+            // task.
+            template<typename Function>
+            bool update(const std::string& name, Function&& f)
             {
-                return c[i];
+                return update_at(slots.find(name), f);
             }
-            
-            void sort()
+
+            template<typename Function>
+            bool update(TaskHandle handle, Function&& f)
             {
-                std::sort(c.begin(), c.end(), std::less<>());
+                return update_at(slots.find(handle), f);
             }
-            
+
+            // Takes the task out of the order of expiry until it is resumed. Returns false if there is no such
+            // task or it is already paused.
+            bool pause(TaskHandle handle);
+
+            // Calls f(task) for the paused task, after which it is put back in order of expiry. f returns false
+            // if the task is to be removed. Returns false if there is no such task or it is not paused.
+            template<typename Function>
+            bool resume(TaskHandle handle, Function&& f);
+
+            // As above, for each of the tasks, which are merged into the queue at once. Returns the number of tasks
+            // that were paused.
+            template<typename Function>
+            size_t resume(const std::vector<TaskHandle>& handles, Function&& f);
+
+            // Calls f(task) for every task, in order of expiry, followed by the paused tasks.
+            template<typename Function>
+            void for_each(Function&& f) const
+            {
+                for (auto i = first; i < entries.size(); ++i)
+                {
+                    if (entries[i].slot != TaskSlots<Empty>::NONE)
+                    {
+                        f(slots.task(entries[i].slot));
+                    }
+                }
+
+                if (paused > 0)
+                {
+                    slots.for_each_paused(f);
+                }
+            }
+
+            bool contains(const std::string& name) const
+            {
+                lock.lock();
+                auto res = slots.find(name) != TaskSlots<Empty>::NONE;
+                lock.unlock();
+
+                return res;
+            }
+
+            // Returns the task with the given handle, or nullptr. The queue must be locked while using it.
+            const Task* find(TaskHandle handle) const
+            {
+                auto s = slots.find(handle);
+                return s == TaskSlots<Empty>::NONE ? nullptr : &slots.task(s);
+            }
+
             void clear()
             {
                 lock.lock();
-                c.clear();
+                entries.clear();
+                first = 0;
+                removed = 0;
+                paused = 0;
+                slots.clear();
                 lock.unlock();
             }
-            
-            void remove(Task& to_remove)
+
+            // Returns the handle of the removed task, which is false if there was no such task.
+            TaskHandle remove(const std::string& to_remove)
             {
-                auto it = std::find_if(c.begin(), c.end(), [&to_remove] (const Task& to_compare) { 
-                                    return to_remove.get_name() == to_compare;
-                                    });
-                
-                if (it != c.end())
-                {
-                    c.erase(it);
-                }
+                lock.lock();
+                auto res = remove_at(slots.find(to_remove));
+                lock.unlock();
+
+                return res;
             }
 
-            void remove(std::string to_remove)
+            TaskHandle remove(TaskHandle to_remove)
             {
                 lock.lock();
-                auto it = std::find_if(c.begin(), c.end(), [&to_remove] (const Task& to_compare) { 
-                                    return to_remove == to_compare;
-                                    });
-                if (it != c.end())
-                {
-                    c.erase(it);
-                } 
-                
+                auto res = remove_at(slots.find(to_remove));
                 lock.unlock();
+
+                return res;
             }
-            
-            void lock_queue()
+
+            void lock_queue() const
             {
                 /* Do not allow to manipulate the Queue */
                 lock.lock();
             }
-            
-            void release_queue()
+
+            void release_queue() const
             {
                 /* Allow Access to the Queue Manipulating-Functions */
                 lock.unlock();
             }
-            
+
         private:
-            LockType lock;
-            std::vector<Task> c;
+            struct Empty
+            {
+            };
+
+            struct Entry
+            {
+                Entry(std::chrono::system_clock::time_point next, uint32_t slot)
+                        : next(next), slot(slot), key(slot)
+                {
+                }
+
+                std::chrono::system_clock::time_point next;
+                // TaskSlots<Empty>::NONE when the task has been removed
+                uint32_t slot;
+                // The slot the entry was made for, kept by removal markers so that entries stay ordered
+                uint32_t key;
+            };
+
+            // Orders entries with the same expiry by slot, so that erase() finds a task directly.
+            static bool earlier(const Entry& a, const Entry& b)
+            {
+                return a.next < b.next || (a.next == b.next && a.key < b.key);
+            }
+
+            void sort()
+            {
+                compact();
+                std::sort(entries.begin(), entries.end(), earlier);
+            }
+
+            void insert(Entry e)
+            {
+                entries.insert(std::upper_bound(entries.begin() + static_cast<std::ptrdiff_t>(first), entries.end(), e,
+                                                earlier), e);
+            }
+
+            void erase(uint32_t s);
+
+            TaskHandle remove_at(uint32_t s);
+
+            template<typename Function>
+            bool update_at(uint32_t s, Function& f);
+
+            void skip_removed()
+            {
+                while (first < entries.size() && entries[first].slot == TaskSlots<Empty>::NONE)
+                {
+                    ++first;
+                    --removed;
+                }
+            }
+
+            void compact();
+
+            void merge_front(size_t count);
+
+            void reorder_expired(size_t end, size_t kept);
+
+            mutable LockType lock;
+            std::vector<Entry> entries{};
+            // Reused by merge_front(), so that expiring tasks does not allocate.
+            std::vector<Entry> rescheduled{};
+            // The first entry that is not a removal marker
+            size_t first = 0;
+            // Number of removal markers after 'first'
+            size_t removed = 0;
+            // Number of paused tasks, which have no entry
+            size_t paused = 0;
+            TaskSlots<Empty> slots{};
     };
+
+    template<typename LockType>
+    template<typename Function>
+    size_t TaskQueue<LockType>::expire(std::chrono::system_clock::time_point now, Function&& f)
+    {
+        // The entries are sorted, so the expired tasks are at the front.
+        auto end = first;
+
+        while (end < entries.size()
+               && (entries[end].slot == TaskSlots<Empty>::NONE || slots.task(entries[end].slot).is_expired(now)))
+        {
+            ++end;
+        }
+
+        size_t res = 0;
+        auto kept = first;
+        auto i = first;
+
+        try
+        {
+            for (; i < end; ++i)
+            {
+                auto s = entries[i].slot;
+
+                if (s == TaskSlots<Empty>::NONE)
+                {
+                    --removed;
+                }
+                else
+                {
+                    ++res;
+
+                    if (f(slots.task(s)))
+                    {
+                        entries[kept++] = Entry{ slots.task(s).get_next_schedule(), s };
+                    }
+                    else
+                    {
+                        slots.release(s);
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            // The task that threw, and those after it, are left as they were.
+            reorder_expired(i, kept);
+            throw;
+        }
+
+        reorder_expired(end, kept);
+
+        return res;
+    }
+
+    // Puts the entries back in order once those from 'first' to 'end' have expired, of which those up to 'kept'
+    // have been rescheduled, by merging them with the ones after 'end'.
+    template<typename LockType>
+    void TaskQueue<LockType>::reorder_expired(size_t end, size_t kept)
+    {
+        if (end > first)
+        {
+            auto begin = entries.begin() + static_cast<std::ptrdiff_t>(first);
+            entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(kept),
+                          entries.begin() + static_cast<std::ptrdiff_t>(end));
+            entries.erase(entries.begin(), begin);
+            auto count = kept - first;
+            first = 0;
+
+            std::sort(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count), earlier);
+            merge_front(count);
+            skip_removed();
+        }
+    }
+
+    // Merges the first 'count' entries with the entries after them, both being sorted. Unlike std::inplace_merge,
+    // it does not allocate once 'rescheduled' has grown, and stops once the first entries are in place.
+    template<typename LockType>
+    void TaskQueue<LockType>::merge_front(size_t count)
+    {
+        rescheduled.assign(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count));
+
+        auto from = rescheduled.begin();
+        auto rest = entries.begin() + static_cast<std::ptrdiff_t>(count);
+        auto out = entries.begin();
+
+        while (from != rescheduled.end())
+        {
+            if (rest != entries.end() && earlier(*rest, *from))
+            {
+                *out++ = *rest++;
+            }
+            else
+            {
+                *out++ = *from++;
+            }
+        }
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    size_t TaskQueue<LockType>::resume(const std::vector<TaskHandle>& handles, Function&& f)
+    {
+        // Inserting the tasks one by one would move the following entries for each of them.
+        auto resumed = entries.size();
+        size_t res = 0;
+
+        for (auto handle : handles)
+        {
+            auto s = slots.find(handle);
+
+            if (s != TaskSlots<Empty>::NONE && slots.task(s).is_paused())
+            {
+                auto& t = slots.task(s);
+                t.set_paused(false);
+                --paused;
+                ++res;
+
+                if (f(t))
+                {
+                    entries.push_back(Entry{ t.get_next_schedule(), s });
+                }
+                else
+                {
+                    slots.release(s);
+                }
+            }
+        }
+
+        auto middle = entries.begin() + static_cast<std::ptrdiff_t>(resumed);
+        std::sort(middle, entries.end(), earlier);
+        std::inplace_merge(entries.begin() + static_cast<std::ptrdiff_t>(first), middle, entries.end(), earlier);
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    void TaskQueue<LockType>::recalculate(std::chrono::system_clock::time_point, Function&& f)
+    {
+        for (auto& e : entries)
+        {
+            if (e.slot != TaskSlots<Empty>::NONE)
+            {
+                if (f(slots.task(e.slot)))
+                {
+                    e.next = slots.task(e.slot).get_next_schedule();
+                }
+                else
+                {
+                    slots.release(e.slot);
+                    e.slot = TaskSlots<Empty>::NONE;
+                    ++removed;
+                }
+            }
+        }
+
+        sort();
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool TaskQueue<LockType>::update_at(uint32_t s, Function& f)
+    {
+        bool res = s != TaskSlots<Empty>::NONE;
+
+        if (res)
+        {
+            auto& t = slots.task(s);
+
+            if (!t.is_paused())
+            {
+                erase(s);
+            }
+
+            if (!f(t))
+            {
+                paused -= t.is_paused() ? 1 : 0;
+                slots.release(s);
+            }
+            else if (!t.is_paused())
+            {
+                insert(Entry{ t.get_next_schedule(), s });
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    TaskHandle TaskQueue<LockType>::remove_at(uint32_t s)
+    {
+        TaskHandle res{};
+
+        if (s != TaskSlots<Empty>::NONE)
+        {
+            auto& t = slots.task(s);
+            res = t.get_handle();
+
+            if (t.is_paused())
+            {
+                --paused;
+            }
+            else
+            {
+                erase(s);
+            }
+
+            slots.release(s);
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    bool TaskQueue<LockType>::pause(TaskHandle handle)
+    {
+        auto s = slots.find(handle);
+        bool res = s != TaskSlots<Empty>::NONE && !slots.task(s).is_paused();
+
+        if (res)
+        {
+            erase(s);
+            slots.task(s).set_paused(true);
+            ++paused;
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool TaskQueue<LockType>::resume(TaskHandle handle, Function&& f)
+    {
+        auto s = slots.find(handle);
+        bool res = s != TaskSlots<Empty>::NONE && slots.task(s).is_paused();
+
+        if (res)
+        {
+            auto& t = slots.task(s);
+            t.set_paused(false);
+            --paused;
+
+            if (f(t))
+            {
+                insert(Entry{ t.get_next_schedule(), s });
+            }
+            else
+            {
+                slots.release(s);
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    void TaskQueue<LockType>::erase(uint32_t s)
+    {
+        // Replaces the entry of the task with a removal marker. Only markers left by earlier tasks in the
+        // same slot and with the same expiry can precede it.
+        auto next = slots.task(s).get_next_schedule();
+        auto it = std::lower_bound(entries.begin() + static_cast<std::ptrdiff_t>(first), entries.end(),
+                                   Entry{ next, s }, earlier);
+
+        while (it->slot != s)
+        {
+            ++it;
+        }
+
+        it->slot = TaskSlots<Empty>::NONE;
+        ++removed;
+        skip_removed();
+
+        // Clean up once half of the entries are markers
+        if (removed > slots.size() || first > slots.size())
+        {
+            compact();
+        }
+    }
+
+    template<typename LockType>
+    void TaskQueue<LockType>::compact()
+    {
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [](const Entry& e)
+                                     {
+                                         return e.slot == TaskSlots<Empty>::NONE;
+                                     }),
+                      entries.end());
+        first = 0;
+        removed = 0;
+    }
 }
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Task.h"
+#include "TaskHandle.h"
+
+namespace libcron
+{
+    // Index of the tasks of a queue by name. Entries are not erased when their task is removed, as that would
+    // mean hashing the name when removing a task by its handle; instead they are skipped once their handle no
+    // longer refers to a task, and purged when adding a task once they outnumber the tasks.
+    class TaskNames
+    {
+        public:
+            static constexpr uint32_t NONE = ~uint32_t{0};
+
+            // Returns locate(handle) for a task with the given name for which it is not NONE, or NONE. locate
+            // returns where the task with the handle is stored, or NONE if it has been removed.
+            template<typename Locate>
+            uint32_t find(const std::string& name, Locate&& locate) const
+            {
+                uint32_t res = NONE;
+                auto range = names.equal_range(name);
+
+                for (auto it = range.first; res == NONE && it != range.second; ++it)
+                {
+                    res = locate(it->second);
+                }
+
+                return res;
+            }
+
+            template<typename Locate>
+            void add(const std::string& name, TaskHandle handle, size_t count, Locate&& locate)
+            {
+                if (stale > count)
+                {
+                    for (auto it = names.begin(); it != names.end();)
+                    {
+                        it = locate(it->second) == NONE ? names.erase(it) : std::next(it);
+                    }
+
+                    stale = 0;
+                }
+
+                // Reuses an entry left behind by a task with the same name, and drops any others, so that tasks
+                // repeatedly added and removed under one name do not make finding it slower.
+                auto range = names.equal_range(name);
+                auto reused = names.end();
+
+                for (auto it = range.first; it != range.second;)
+                {
+                    if (locate(it->second) != NONE)
+                    {
+                        ++it;
+                    }
+                    else if (reused == names.end())
+                    {
+                        reused = it++;
+                        --stale;
+                    }
+                    else
+                    {
+                        it = names.erase(it);
+                        --stale;
+                    }
+                }
+
+                if (reused == names.end())
+                {
+                    names.emplace(name, handle);
+                }
+                else
+                {
+                    reused->second = handle;
+                }
+            }
+
+            // Called when a task is removed, leaving its entry behind.
+            void released()
+            {
+                ++stale;
+            }
+
+            void clear()
+            {
+                names.clear();
+                stale = 0;
+            }
+
+        private:
+            std::unordered_multimap<std::string, TaskHandle> names{};
+            size_t stale = 0;
+    };
+
+    // Storage for the tasks of a queue. Each task is stored in the slot given by the index of its handle, so
+    // the queues can order small references to the tasks rather than moving the tasks themselves, and find
+    // a task by its handle in O(1). Alongside each task is a Data member for the queue's own bookkeeping.
+    template<typename Data>
+    class TaskSlots
+    {
+        public:
+            static constexpr uint32_t NONE = TaskNames::NONE;
+
+            size_t size() const noexcept
+            {
+                return count;
+            }
+
+            // The number of slots, used or not; valid slot numbers are below this.
+            uint32_t capacity() const noexcept
+            {
+                return static_cast<uint32_t>(slots.size());
+            }
+
+            bool used(uint32_t s) const
+            {
+                return slots[s].task.has_value();
+            }
+
+            Task& task(uint32_t s)
+            {
+                return *slots[s].task;
+            }
+
+            const Task& task(uint32_t s) const
+            {
+                return *slots[s].task;
+            }
+
+            Data& data(uint32_t s)
+            {
+                return slots[s].data;
+            }
+
+            const Data& data(uint32_t s) const
+            {
+                return slots[s].data;
+            }
+
+            // Returns the slot of the task with the given handle, or NONE if it has been removed.
+            uint32_t find(TaskHandle handle) const
+            {
+                auto s = handle.get_index();
+                return s < slots.size() && used(s) && task(s).get_handle() == handle ? s : NONE;
+            }
+
+            // Returns the slot of a task with the given name, or NONE. If several tasks share the name,
+            // any one of them is returned.
+            uint32_t find(const std::string& name) const
+            {
+                return names.find(name, [this](TaskHandle handle)
+                                        {
+                                            return find(handle);
+                                        });
+            }
+
+            // The slot of the handle of 't' must be free.
+            uint32_t allocate(Task&& t)
+            {
+                auto s = t.get_handle().get_index();
+
+                if (s >= slots.size())
+                {
+                    slots.resize(s + 1);
+                }
+
+                names.add(t.get_name(), t.get_handle(), count, [this](TaskHandle handle)
+                                                                {
+                                                                    return find(handle);
+                                                                });
+                slots[s].task.emplace(std::move(t));
+                slots[s].data = Data{};
+                ++count;
+
+                return s;
+            }
+
+            void release(uint32_t s)
+            {
+                slots[s].task.reset();
+                names.released();
+                --count;
+            }
+
+            // Calls f(task) for every paused task.
+            template<typename Function>
+            void for_each_paused(Function&& f) const
+            {
+                for (const auto& slot : slots)
+                {
+                    if (slot.task && slot.task->is_paused())
+                    {
+                        f(*slot.task);
+                    }
+                }
+            }
+
+            void clear()
+            {
+                slots.clear();
+                names.clear();
+                count = 0;
+            }
+
+        private:
+            struct Slot
+            {
+                std::optional<Task> task{};
+                Data data{};
+            };
+
+            std::vector<Slot> slots{};
+            TaskNames names{};
+            size_t count = 0;
+    };
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TaskHandle.h"
+
+namespace libcron
+{
+    // Groups of tasks by tag, so that all tasks with a tag can be paused or resumed at once. Not thread safe;
+    // Cron only uses it while the tasks are locked.
+    //
+    // Tasks are not taken out of their groups when they are removed, as that would mean searching the groups;
+    // instead their handles are dropped as soon as they are found to no longer refer to a task. Groups left
+    // without tasks, such as those of tags used by a single task, are dropped once the number of groups has
+    // doubled since they were last looked at.
+    class TaskTags
+    {
+        public:
+            // 'exists' returns whether a handle still refers to a task.
+            template<typename Exists>
+            void add(const std::string& tag, TaskHandle handle, Exists&& exists)
+            {
+                if (groups.size() >= sweep_at)
+                {
+                    drop_empty(exists);
+                    sweep_at = std::max(MIN_COMPACT_AT, groups.size() * 2);
+                }
+
+                auto& group = groups[tag];
+
+                if (group.handles.size() >= group.compact_at)
+                {
+                    drop_removed(group.handles, exists);
+                    group.compact_at = std::max(MIN_COMPACT_AT, group.handles.size() * 2);
+                }
+
+                group.handles.push_back(handle);
+            }
+
+            // The handles of the tasks with the given tag, or nullptr if there are none. Some of the handles may
+            // no longer refer to tasks.
+            template<typename Exists>
+            const std::vector<TaskHandle>* find(const std::string& tag, Exists&& exists)
+            {
+                const std::vector<TaskHandle>* res = nullptr;
+                auto it = groups.find(tag);
+
+                if (it != groups.end())
+                {
+                    drop_removed(it->second.handles, exists);
+
+                    if (it->second.handles.empty())
+                    {
+                        groups.erase(it);
+                    }
+                    else
+                    {
+                        res = &it->second.handles;
+                    }
+                }
+
+                return res;
+            }
+
+            void clear()
+            {
+                groups.clear();
+                sweep_at = MIN_COMPACT_AT;
+            }
+
+            // The number of tags, some of which may no longer have tasks.
+            size_t size() const
+            {
+                return groups.size();
+            }
+
+        private:
+            static constexpr size_t MIN_COMPACT_AT = 64;
+
+            struct Group
+            {
+                std::vector<TaskHandle> handles{};
+                // Handles of removed tasks are dropped when adding to a group of this size, so that the groups do
+                // not grow with the number of tasks ever added.
+                size_t compact_at = MIN_COMPACT_AT;
+            };
+
+            template<typename Exists>
+            static void drop_removed(std::vector<TaskHandle>& handles, Exists& exists)
+            {
+                handles.erase(std::remove_if(handles.begin(), handles.end(),
+                                             [&exists](TaskHandle h)
+                                             {
+                                                 return !exists(h);
+                                             }),
+                              handles.end());
+            }
+
+            template<typename Exists>
+            void drop_empty(Exists& exists)
+            {
+                for (auto it = groups.begin(); it != groups.end();)
+                {
+                    drop_removed(it->second.handles, exists);
+                    it = it->second.handles.empty() ? groups.erase(it) : std::next(it);
+                }
+            }
+
+            std::unordered_map<std::string, Group> groups{};
+            // Groups without tasks are dropped when adding to this many groups
+            size_t sweep_at = MIN_COMPACT_AT;
+    };
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace libcron
+{
+    // Drives a Cron instance from an event loop (epoll, io_uring, ...) using a Linux timerfd armed for
+    // the expiry of the next task:
+    //
+    //      libcron::Cron<> cron;
+    //      libcron::TimerFd<libcron::Cron<>> timer{ cron };
+    //      // register timer.get_fd() for reading; whenever it is readable:
+    //      timer.on_readable();
+    //
+    // The timer is armed on an absolute time of the realtime clock, and is re-armed after each tick. Changing
+    // schedules through the Cron instance makes the fd readable, to re-arm it from the thread handling it. Changes to the system clock also make
+    // the fd readable, after which the schedules are checked against the new time.
+    //
+    // As it sets the change listener of the Cron instance, create and destroy the TimerFd while no other thread
+    // uses that instance.
+    template<typename CronType>
+    class TimerFd
+    {
+        public:
+            explicit TimerFd(CronType& cron)
+                    : cron(cron),
+                      fd(timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC))
+            {
+                if (fd != -1)
+                {
+                    // Schedules may be changed on another thread, so rather than looking at them, let
+                    // the thread handling the fd tick, which applies any queued changes, and re-arm.
+                    cron.set_change_listener([this]()
+                                             {
+                                                 wake();
+                                             });
+                    rearm();
+                }
+            }
+
+            ~TimerFd()
+            {
+                if (fd != -1)
+                {
+                    cron.set_change_listener({});
+                    close(fd);
+                }
+            }
+
+            TimerFd(const TimerFd&) = delete;
+
+            TimerFd& operator=(const TimerFd&) = delete;
+
+            // The fd to wait on for reading, or -1 if the timerfd could not be created.
+            int get_fd() const
+            {
+                return fd;
+            }
+
+            // Ticks the Cron instance and re-arms the timer. Returns the number of expired tasks.
+            size_t on_readable()
+            {
+                using namespace std::chrono;
+
+                // Reading resets the fd; it fails with ECANCELED after a clock change, which only needs
+                // the timer to be armed again.
+                uint64_t expirations;
+                auto ignored = read(fd, &expirations, sizeof(expirations));
+                (void)ignored;
+
+                // As in Cron::run(), tick on the whole second to keep ticks at least a second apart.
+                auto res = cron.tick(floor<seconds>(cron.get_clock().now()));
+                rearm();
+
+                return res;
+            }
+
+            // Makes the fd readable right away. May be called from any thread.
+            void wake()
+            {
+                changed.store(true);
+                arm_now();
+            }
+
+            // Arms the timer for the next task, or disarms it when there are no tasks.
+            void rearm()
+            {
+                using namespace std::chrono;
+
+                // A wake() between reading the next wakeup and arming the timer would be overwritten by the
+                // older wakeup, so see whether one happened once the timer is armed.
+                changed.store(false);
+
+                itimerspec spec{};
+                auto wakeup = cron.get_next_wakeup();
+
+                if (wakeup != system_clock::time_point::max())
+                {
+                    auto since_epoch = wakeup.time_since_epoch();
+
+                    if (since_epoch <= since_epoch.zero())
+                    {
+                        // Long expired; a zero it_value would disarm the timer.
+                        spec.it_value.tv_nsec = 1;
+                    }
+                    else
+                    {
+                        auto secs = floor<seconds>(since_epoch);
+                        spec.it_value.tv_sec = static_cast<time_t>(secs.count());
+                        spec.it_value.tv_nsec = static_cast<long>(duration_cast<nanoseconds>(since_epoch - secs).count());
+                    }
+                }
+
+                timerfd_settime(fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr);
+
+                if (changed.load())
+                {
+                    arm_now();
+                }
+            }
+
+        private:
+            void arm_now()
+            {
+                itimerspec spec{};
+                spec.it_value.tv_nsec = 1;
+                timerfd_settime(fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr);
+            }
+
+            CronType& cron;
+            int fd;
+            // Set by wake(), cleared by rearm() before it looks at the schedules.
+            std::atomic<bool> changed{ false };
+    };
+}
+
+#endif
@@ -0,0 +1,767 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Task.h"
+#include "TaskSlots.h"
+#include "CronField.h"
+
+namespace libcron
+{
+    // A hierarchical timing wheel with a resolution of one second, usable as the queue of a Cron instance
+    // in place of the sorted TaskQueue:
+    //
+    //      Cron<LocalClock, NullLock, TimingWheelQueue> cron;
+    //
+    // The four levels hold the tasks expiring within the current minute (one slot per second), hour (one slot
+    // per minute), day (one slot per hour) and period of 64 days (one slot per day). Tasks further into the
+    // future are kept in an overflow list that is only examined once per period. As time passes, the tasks in
+    // a slot are moved down one or more levels, so each task is moved at most four times before it expires.
+    // Adding, removing, pausing and expiring a task are therefore O(1) amortized. As with TaskSlots, each task
+    // is stored at the index of its handle.
+    template<typename LockType>
+    class TimingWheelQueue
+    {
+        public:
+            TimingWheelQueue()
+            {
+                heads.fill(NONE);
+            }
+
+            size_t size() const noexcept
+            {
+                return count;
+            }
+
+            // Whether there is no task to expire; paused tasks are included in size() only.
+            bool empty() const noexcept
+            {
+                return count == paused;
+            }
+
+            void push(Task& t)
+            {
+                push(std::move(t));
+            }
+
+            void push(Task&& t)
+            {
+                prepare_for(expiry_of(t));
+                place(allocate(std::move(t)));
+            }
+
+            void push(std::vector<Task>& tasks_to_insert)
+            {
+                if (!tasks_to_insert.empty())
+                {
+                    auto earliest = expiry_of(tasks_to_insert.front());
+
+                    for (const auto& t : tasks_to_insert)
+                    {
+                        earliest = std::min(earliest, expiry_of(t));
+                    }
+
+                    prepare_for(earliest);
+
+                    for (auto& t : tasks_to_insert)
+                    {
+                        place(allocate(std::move(t)));
+                    }
+                }
+            }
+
+            // The task expiring first. Only the earliest non-empty slot needs to be searched.
+            const Task& top() const;
+
+            // Calls f(task) for every task expired at 'now', in order of expiry. f returns false if the task is
+            // to be removed, otherwise the task is put back into the wheel according to its next schedule.
+            // Returns the number of expired tasks.
+            template<typename Function>
+            size_t expire(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for every task and rebuilds the wheel around 'now'. f returns false if the task is
+            // to be removed.
+            template<typename Function>
+            void recalculate(std::chrono::system_clock::time_point now, Function&& f);
+
+            // Calls f(task) for the task with the given name or handle, after which the task is moved to the slot
+            // of its new expiry. f returns false if the task is to be removed. Returns false if there is no such
+            // task.
+            template<typename Function>
+            bool update(const std::string& name, Function&& f)
+            {
+                return update_at(find_node(name), f);
+            }
+
+            template<typename Function>
+            bool update(TaskHandle handle, Function&& f)
+            {
+                return update_at(find_node(handle), f);
+            }
+
+            // Takes the task out of the wheel until it is resumed. Returns false if there is no such task or it is
+            // already paused.
+            bool pause(TaskHandle handle);
+
+            // Calls f(task) for the paused task, after which it is put back into the wheel. f returns false if the
+            // task is to be removed. Returns false if there is no such task or it is not paused.
+            template<typename Function>
+            bool resume(TaskHandle handle, Function&& f);
+
+            // As above, for each of the tasks. Returns the number of tasks that were paused.
+            template<typename Function>
+            size_t resume(const std::vector<TaskHandle>& handles, Function&& f)
+            {
+                size_t res = 0;
+
+                for (auto handle : handles)
+                {
+                    res += resume(handle, f) ? 1 : 0;
+                }
+
+                return res;
+            }
+
+            template<typename Function>
+            void for_each(Function&& f) const
+            {
+                for (const auto& node : nodes)
+                {
+                    if (node.task)
+                    {
+                        f(*node.task);
+                    }
+                }
+            }
+
+            bool contains(const std::string& name) const
+            {
+                lock.lock();
+                auto res = find_node(name) != NONE;
+                lock.unlock();
+
+                return res;
+            }
+
+            // Returns the task with the given handle, or nullptr. The queue must be locked while using it.
+            const Task* find(TaskHandle handle) const
+            {
+                auto n = find_node(handle);
+                return n == NONE ? nullptr : &*nodes[n].task;
+            }
+
+            void clear()
+            {
+                lock.lock();
+                nodes.clear();
+                names.clear();
+                heads.fill(NONE);
+                masks.fill(0);
+                count = 0;
+                paused = 0;
+                lock.unlock();
+            }
+
+            // Returns the handle of the removed task, which is false if there was no such task.
+            TaskHandle remove(const std::string& to_remove)
+            {
+                lock.lock();
+                auto res = remove_node(find_node(to_remove));
+                lock.unlock();
+
+                return res;
+            }
+
+            TaskHandle remove(TaskHandle to_remove)
+            {
+                lock.lock();
+                auto res = remove_node(find_node(to_remove));
+                lock.unlock();
+
+                return res;
+            }
+
+            void lock_queue() const
+            {
+                /* Do not allow to manipulate the Queue */
+                lock.lock();
+            }
+
+            void release_queue() const
+            {
+                /* Allow Access to the Queue Manipulating-Functions */
+                lock.unlock();
+            }
+
+        private:
+            static constexpr uint32_t NONE = ~uint32_t{0};
+            static constexpr int LEVELS = 4;
+
+            // Number of slots, the time covered by each slot and the offset of the first slot in 'heads'.
+            static constexpr std::array<int64_t, LEVELS> slots{ 60, 60, 24, 64 };
+            static constexpr std::array<int64_t, LEVELS> unit{ 1, 60, 60 * 60, 24 * 60 * 60 };
+            static constexpr std::array<uint16_t, LEVELS> offset{ 0, 60, 120, 144 };
+
+            // Tasks beyond the last level, and tasks that have expired but not yet been executed.
+            static constexpr uint16_t OVERFLOW_LIST = 208;
+            static constexpr uint16_t DUE_LIST = 209;
+            static constexpr uint16_t LISTS = 210;
+
+            struct Node
+            {
+                std::optional<Task> task{};
+                int64_t expiry = 0;
+                uint32_t prev = NONE;
+                uint32_t next = NONE;
+                uint16_t list = 0;
+            };
+
+            static int64_t expiry_of(const Task& t)
+            {
+                return std::chrono::floor<std::chrono::seconds>(t.get_next_schedule().time_since_epoch()).count();
+            }
+
+            // Rounds towards negative infinity so that slots are calculated the same way before 1970.
+            static int64_t floor_div(int64_t value, int64_t divisor)
+            {
+                return value / divisor - (value % divisor < 0 ? 1 : 0);
+            }
+
+            // The time covered by an entire level
+            static int64_t span(int level)
+            {
+                return unit[static_cast<size_t>(level)] * slots[static_cast<size_t>(level)];
+            }
+
+            static int slot_of(int64_t time, int level)
+            {
+                return static_cast<int>(floor_div(time, unit[static_cast<size_t>(level)])
+                                        % slots[static_cast<size_t>(level)]);
+            }
+
+            static int level_of(uint16_t list)
+            {
+                int res = -1;
+
+                for (int l = 0; l < LEVELS; ++l)
+                {
+                    if (list >= offset[static_cast<size_t>(l)] && list < OVERFLOW_LIST)
+                    {
+                        res = l;
+                    }
+                }
+
+                return res;
+            }
+
+            uint32_t find_node(TaskHandle handle) const
+            {
+                auto n = handle.get_index();
+                return n < nodes.size() && nodes[n].task && nodes[n].task->get_handle() == handle ? n : NONE;
+            }
+
+            uint32_t find_node(const std::string& name) const
+            {
+                return names.find(name, [this](TaskHandle handle)
+                                        {
+                                            return find_node(handle);
+                                        });
+            }
+
+            TaskHandle remove_node(uint32_t n);
+
+            template<typename Function>
+            bool update_at(uint32_t n, Function& f);
+
+            void reinsert(uint32_t n);
+
+            void prepare_for(int64_t expiry);
+
+            void rebuild(int64_t new_cursor);
+
+            void advance(int64_t target);
+
+            void cascade(uint16_t list);
+
+            void place(uint32_t n);
+
+            void link(uint32_t n, uint16_t list);
+
+            void unlink(uint32_t n);
+
+            uint32_t take(uint16_t list);
+
+            uint32_t allocate(Task&& t);
+
+            void release(uint32_t n);
+
+            mutable LockType lock;
+            // Paused tasks are kept in their node without being linked into a list.
+            std::vector<Node> nodes{};
+            TaskNames names{};
+            std::array<uint32_t, LISTS> heads{};
+            std::array<uint64_t, LEVELS> masks{};
+            // All time up to and including the cursor has been processed.
+            int64_t cursor = 0;
+            size_t count = 0;
+            size_t paused = 0;
+    };
+
+    template<typename LockType>
+    const Task& TimingWheelQueue<LockType>::top() const
+    {
+        uint32_t res = NONE;
+
+        auto earliest_of = [this, &res](uint32_t n)
+                           {
+                               for (; n != NONE; n = nodes[n].next)
+                               {
+                                   if (res == NONE || nodes[n].expiry < nodes[res].expiry)
+                                   {
+                                       res = n;
+                                   }
+                               }
+                           };
+
+        earliest_of(heads[DUE_LIST]);
+
+        // The slots of a lower level expire before those of a higher level, and the lowest slot
+        // of a level before its other slots.
+        bool found = false;
+
+        for (int l = 0; !found && l < LEVELS; ++l)
+        {
+            auto mask = masks[static_cast<size_t>(l)];
+
+            if (mask != 0)
+            {
+                earliest_of(heads[static_cast<size_t>(offset[static_cast<size_t>(l)] + bits::lowest(mask))]);
+                found = true;
+            }
+        }
+
+        if (!found)
+        {
+            earliest_of(heads[OVERFLOW_LIST]);
+        }
+
+        return *nodes[res].task;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    size_t TimingWheelQueue<LockType>::expire(std::chrono::system_clock::time_point now, Function&& f)
+    {
+        size_t res = 0;
+
+        if (count > 0)
+        {
+            auto target = std::chrono::floor<std::chrono::seconds>(now.time_since_epoch()).count();
+
+            if (target > cursor)
+            {
+                advance(target);
+            }
+
+            // The due list is in reverse order of expiry; restore the order before executing.
+            uint32_t due = NONE;
+
+            for (auto n = take(DUE_LIST); n != NONE;)
+            {
+                auto next = nodes[n].next;
+                nodes[n].next = due;
+                due = n;
+                n = next;
+            }
+
+            auto n = NONE;
+
+            try
+            {
+                while (due != NONE)
+                {
+                    n = due;
+                    due = nodes[n].next;
+
+                    // When the clock has been moved backwards, tasks may be due in relation to the cursor
+                    // but not yet in relation to 'now'.
+                    if (nodes[n].expiry > target)
+                    {
+                        link(n, DUE_LIST);
+                    }
+                    else
+                    {
+                        ++res;
+
+                        if (f(*nodes[n].task))
+                        {
+                            nodes[n].expiry = expiry_of(*nodes[n].task);
+                            place(n);
+                        }
+                        else
+                        {
+                            release(n);
+                        }
+                    }
+                }
+            }
+            catch (...)
+            {
+                // The task that threw, and those after it, are put back in the due list, which is in reverse order.
+                link(n, DUE_LIST);
+
+                while (due != NONE)
+                {
+                    auto next = nodes[due].next;
+                    link(due, DUE_LIST);
+                    due = next;
+                }
+
+                throw;
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    void TimingWheelQueue<LockType>::recalculate(std::chrono::system_clock::time_point now, Function&& f)
+    {
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            if (nodes[n].task && !nodes[n].task->is_paused())
+            {
+                if (f(*nodes[n].task))
+                {
+                    nodes[n].expiry = expiry_of(*nodes[n].task);
+                }
+                else
+                {
+                    release(n);
+                }
+            }
+        }
+
+        rebuild(std::chrono::floor<std::chrono::seconds>(now.time_since_epoch()).count() - 1);
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool TimingWheelQueue<LockType>::update_at(uint32_t n, Function& f)
+    {
+        bool res = n != NONE;
+
+        if (res)
+        {
+            auto was_paused = nodes[n].task->is_paused();
+
+            if (!was_paused)
+            {
+                unlink(n);
+            }
+
+            if (!f(*nodes[n].task))
+            {
+                release(n);
+            }
+            else if (!was_paused)
+            {
+                reinsert(n);
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    TaskHandle TimingWheelQueue<LockType>::remove_node(uint32_t n)
+    {
+        TaskHandle res{};
+
+        if (n != NONE)
+        {
+            res = nodes[n].task->get_handle();
+
+            if (!nodes[n].task->is_paused())
+            {
+                unlink(n);
+            }
+
+            release(n);
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    bool TimingWheelQueue<LockType>::pause(TaskHandle handle)
+    {
+        auto n = find_node(handle);
+        bool res = n != NONE && !nodes[n].task->is_paused();
+
+        if (res)
+        {
+            unlink(n);
+            nodes[n].task->set_paused(true);
+            ++paused;
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    template<typename Function>
+    bool TimingWheelQueue<LockType>::resume(TaskHandle handle, Function&& f)
+    {
+        auto n = find_node(handle);
+        bool res = n != NONE && nodes[n].task->is_paused();
+
+        if (res)
+        {
+            nodes[n].task->set_paused(false);
+            --paused;
+
+            if (f(*nodes[n].task))
+            {
+                reinsert(n);
+            }
+            else
+            {
+                release(n);
+            }
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::reinsert(uint32_t n)
+    {
+        // Places a node that is in no list according to the next expiry of its task.
+        nodes[n].expiry = expiry_of(*nodes[n].task);
+
+        if (count - paused == 1)
+        {
+            // The wheel is otherwise empty, so the cursor may be moved back without rebuilding it.
+            cursor = std::min(cursor, nodes[n].expiry - 1);
+            place(n);
+        }
+        else if (nodes[n].expiry <= cursor)
+        {
+            // Rebuilding places all tasks, including this one.
+            rebuild(nodes[n].expiry - 1);
+        }
+        else
+        {
+            place(n);
+        }
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::prepare_for(int64_t expiry)
+    {
+        // The wheel cannot hold tasks expiring before the cursor, so move it back when needed.
+        if (count == paused)
+        {
+            cursor = expiry - 1;
+        }
+        else if (expiry <= cursor)
+        {
+            rebuild(expiry - 1);
+        }
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::rebuild(int64_t new_cursor)
+    {
+        cursor = new_cursor;
+        heads.fill(NONE);
+        masks.fill(0);
+
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            if (nodes[n].task && !nodes[n].task->is_paused())
+            {
+                place(n);
+            }
+        }
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::advance(int64_t target)
+    {
+        // Moves the cursor from one non-empty slot to the next, or to the start of the next period when
+        // all levels are empty, cascading the tasks of each slot as it is reached.
+        while (cursor < target)
+        {
+            int64_t next_event = 0;
+            uint16_t list = OVERFLOW_LIST;
+
+            for (int l = 0; list == OVERFLOW_LIST && l < LEVELS; ++l)
+            {
+                auto position = slot_of(cursor, l);
+                auto later = position + 1 >= 64 ? 0 : masks[static_cast<size_t>(l)] & (~uint64_t{0} << (position + 1));
+
+                if (later != 0)
+                {
+                    auto slot = bits::lowest(later);
+                    next_event = floor_div(cursor, span(l)) * span(l) + slot * unit[static_cast<size_t>(l)];
+                    list = static_cast<uint16_t>(offset[static_cast<size_t>(l)] + slot);
+                }
+            }
+
+            if (list == OVERFLOW_LIST)
+            {
+                next_event = (floor_div(cursor, span(LEVELS - 1)) + 1) * span(LEVELS - 1);
+            }
+
+            if (next_event > target)
+            {
+                cursor = target;
+            }
+            else
+            {
+                cursor = next_event;
+                cascade(list);
+            }
+        }
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::cascade(uint16_t list)
+    {
+        for (auto n = take(list); n != NONE;)
+        {
+            auto next = nodes[n].next;
+            place(n);
+            n = next;
+        }
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::place(uint32_t n)
+    {
+        // A task goes into the lowest level whose current span, as given by the cursor, includes its expiry.
+        auto expiry = nodes[n].expiry;
+        uint16_t list = DUE_LIST;
+
+        if (expiry > cursor)
+        {
+            list = OVERFLOW_LIST;
+
+            for (int l = 0; list == OVERFLOW_LIST && l < LEVELS; ++l)
+            {
+                if (floor_div(expiry, span(l)) == floor_div(cursor, span(l)))
+                {
+                    auto slot = slot_of(expiry, l);
+                    masks[static_cast<size_t>(l)] |= uint64_t{1} << slot;
+                    list = static_cast<uint16_t>(offset[static_cast<size_t>(l)] + slot);
+                }
+            }
+        }
+
+        link(n, list);
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::link(uint32_t n, uint16_t list)
+    {
+        auto& node = nodes[n];
+        node.list = list;
+        node.prev = NONE;
+        node.next = heads[list];
+
+        if (node.next != NONE)
+        {
+            nodes[node.next].prev = n;
+        }
+
+        heads[list] = n;
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::unlink(uint32_t n)
+    {
+        auto& node = nodes[n];
+
+        if (node.prev == NONE)
+        {
+            heads[node.list] = node.next;
+        }
+        else
+        {
+            nodes[node.prev].next = node.next;
+        }
+
+        if (node.next != NONE)
+        {
+            nodes[node.next].prev = node.prev;
+        }
+
+        auto level = level_of(node.list);
+
+        if (level != -1 && heads[node.list] == NONE)
+        {
+            masks[static_cast<size_t>(level)] &= ~(uint64_t{1} << (node.list - offset[static_cast<size_t>(level)]));
+        }
+    }
+
+    template<typename LockType>
+    uint32_t TimingWheelQueue<LockType>::take(uint16_t list)
+    {
+        // Detaches the entire list, returning its first node. The nodes keep their links to each other.
+        auto res = heads[list];
+        heads[list] = NONE;
+
+        auto level = level_of(list);
+
+        if (level != -1)
+        {
+            masks[static_cast<size_t>(level)] &= ~(uint64_t{1} << (list - offset[static_cast<size_t>(level)]));
+        }
+
+        return res;
+    }
+
+    template<typename LockType>
+    uint32_t TimingWheelQueue<LockType>::allocate(Task&& t)
+    {
+        // The node of the handle of 't' must be free.
+        auto n = t.get_handle().get_index();
+
+        if (n >= nodes.size())
+        {
+            nodes.resize(n + 1);
+        }
+
+        nodes[n].expiry = expiry_of(t);
+        names.add(t.get_name(), t.get_handle(), count, [this](TaskHandle handle)
+                                                        {
+                                                            return find_node(handle);
+                                                        });
+        nodes[n].task.emplace(std::move(t));
+        ++count;
+
+        return n;
+    }
+
+    template<typename LockType>
+    void TimingWheelQueue<LockType>::release(uint32_t n)
+    {
+        // The node must already be unlinked.
+        if (nodes[n].task->is_paused())
+        {
+            --paused;
+        }
+
+        nodes[n].task.reset();
+        names.released();
+        --count;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace libcron
+{
+    // Records what the scheduler does into a fixed-size ring buffer, to be written as Chrome trace event JSON
+    // that opens in Perfetto (ui.perfetto.dev) or chrome://tracing:
+    //
+    //      auto recorder = std::make_shared<TraceRecorder>();
+    //      cron.set_trace_recorder(recorder);
+    //      ...
+    //      std::string json;
+    //      recorder->write_json(json);
+    //
+    // Each expiry of a task is an instant event on the thread calling tick(), and each run a slice on the thread
+    // running it, both with the delay of the run. Runs skipped because the previous run had not finished are
+    // instant events too. Once the ring is full, each event overwrites the oldest one.
+    //
+    // Events may be recorded from any number of threads at once. Recording takes one atomic increment and a store
+    // per eight bytes of the event, of which the task name takes up to NAME_SIZE, and neither allocates nor
+    // waits. Writing the JSON does not stop recording either; events overwritten while being read are left out.
+    class TraceRecorder
+    {
+        public:
+            static constexpr size_t DEFAULT_CAPACITY = 65536;
+            // Longer names are cut short.
+            static constexpr size_t NAME_SIZE = 88;
+
+            // The capacity is rounded up to a power of two.
+            explicit TraceRecorder(size_t capacity = DEFAULT_CAPACITY);
+
+            TraceRecorder(const TraceRecorder&) = delete;
+
+            TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+            // The task expired, with the given delay from when it was scheduled.
+            void record_fire(std::string_view task, std::chrono::steady_clock::time_point at,
+                             std::chrono::nanoseconds delay) noexcept
+            {
+                record(Kind::Fire, task, at, std::chrono::nanoseconds{ 0 }, delay);
+            }
+
+            // The task expired, but did not run as its previous run had not finished.
+            void record_skip(std::string_view task, std::chrono::steady_clock::time_point at,
+                             std::chrono::nanoseconds delay) noexcept
+            {
+                record(Kind::Skip, task, at, std::chrono::nanoseconds{ 0 }, delay);
+            }
+
+            // A run of the task on the calling thread.
+            void record_run(std::string_view task, std::chrono::steady_clock::time_point started,
+                            std::chrono::nanoseconds run_time, std::chrono::nanoseconds delay) noexcept
+            {
+                record(Kind::Run, task, started, run_time, delay);
+            }
+
+            // Appends the events in the ring, oldest first, as a JSON object with a "traceEvents" array. Event
+            // times are relative to when the recorder was created.
+            void write_json(std::string& out) const;
+
+            size_t get_capacity() const noexcept
+            {
+                return mask + 1;
+            }
+
+            // The number of events recorded, including those since overwritten.
+            uint64_t get_recorded() const noexcept
+            {
+                return head.load(std::memory_order_relaxed);
+            }
+
+        private:
+            enum class Kind : uint8_t
+            {
+                Fire,
+                Skip,
+                Run
+            };
+
+            static constexpr size_t NAME_WORDS = NAME_SIZE / 8;
+
+            // The writer of event i sets 'sequence' to 2i + 1 before writing the fields, and to 2i + 2 after, so
+            // that readers can tell an event that was overwritten or is being written.
+            struct alignas(64) Slot
+            {
+                std::atomic<uint64_t> sequence{ 0 };
+                std::atomic<int64_t> time{ 0 };
+                std::atomic<int64_t> duration{ 0 };
+                std::atomic<int64_t> delay{ 0 };
+                // The kind, the name length and the thread
+                std::atomic<uint64_t> info{ 0 };
+                std::atomic<uint64_t> name[NAME_WORDS]{};
+            };
+
+            void record(Kind kind, std::string_view task, std::chrono::steady_clock::time_point at,
+                        std::chrono::nanoseconds duration, std::chrono::nanoseconds delay) noexcept;
+
+            std::unique_ptr<Slot[]> slots;
+            size_t mask;
+            std::chrono::steady_clock::time_point origin;
+            alignas(64) std::atomic<uint64_t> head{ 0 };
+    };
+}
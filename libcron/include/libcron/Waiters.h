@@ -0,0 +1,224 @@
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define LIBCRON_COROUTINES 1
+#endif
+#endif
+
+#if defined(LIBCRON_COROUTINES)
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "CronSchedule.h"
+
+namespace libcron
+{
+    // Resumes an awaiting coroutine on the thread calling Cron::tick.
+    struct InlineResumer
+    {
+        void operator()(std::coroutine_handle<> handle) const
+        {
+            handle.resume();
+        }
+    };
+
+    // A coroutine waiting for the next occurrence of a schedule. It is part of the awaiter and so lives in
+    // the coroutine frame, which is why waiting does not allocate.
+    struct Waiter
+    {
+        const CronSchedule* schedule = nullptr;
+        std::chrono::system_clock::time_point when{};
+        bool found = false;
+        std::coroutine_handle<> handle{};
+        void* resumer = nullptr;
+        void (* resume)(void* resumer, std::coroutine_handle<> handle) = nullptr;
+        // Links the waiters that are due
+        Waiter* next = nullptr;
+        // Whether the waiter is held by Waiters, rather than due or not waiting
+        bool waiting = false;
+    };
+
+    // The waiters of a Cron instance, as a min-heap on the time they are due.
+    class Waiters
+    {
+        public:
+            bool empty() const noexcept
+            {
+                return heap.empty();
+            }
+
+            std::chrono::system_clock::time_point earliest() const
+            {
+                return heap.front()->when;
+            }
+
+            void add(Waiter& w)
+            {
+                w.waiting = true;
+                heap.push_back(&w);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+
+            // Removes a waiter that is no longer waiting, such as that of a coroutine destroyed while suspended.
+            void remove(Waiter& w)
+            {
+                if (w.waiting)
+                {
+                    w.waiting = false;
+                    auto it = std::find(heap.begin(), heap.end(), &w);
+                    *it = heap.back();
+                    heap.pop_back();
+                    std::make_heap(heap.begin(), heap.end(), later);
+                }
+            }
+
+            // Destroys the coroutines of all waiters.
+            void destroy()
+            {
+                auto waiting = std::move(heap);
+                heap.clear();
+
+                for (auto w : waiting)
+                {
+                    w->waiting = false;
+                }
+
+                for (auto w : waiting)
+                {
+                    w->handle.destroy();
+                }
+            }
+
+            // Detaches the waiters due at 'now', returning the first of them; the others follow through Waiter::next.
+            Waiter* take_due(std::chrono::system_clock::time_point now)
+            {
+                Waiter* res = nullptr;
+                Waiter** last = &res;
+
+                while (!heap.empty() && heap.front()->when <= now)
+                {
+                    std::pop_heap(heap.begin(), heap.end(), later);
+                    auto w = heap.back();
+                    heap.pop_back();
+
+                    w->next = nullptr;
+                    w->waiting = false;
+                    *last = w;
+                    last = &w->next;
+                }
+
+                return res;
+            }
+
+            // Calculates again when each waiter is due, after the clock has changed. Waiters whose schedule no
+            // longer occurs are due immediately.
+            void recalculate(std::chrono::system_clock::time_point now)
+            {
+                for (auto w : heap)
+                {
+                    std::tie(w->found, w->when) = w->schedule->calculate_from(now);
+
+                    if (!w->found)
+                    {
+                        w->when = now;
+                    }
+                }
+
+                std::make_heap(heap.begin(), heap.end(), later);
+            }
+
+            // Resumes the waiters taken by take_due().
+            static void resume(Waiter* w)
+            {
+                while (w != nullptr)
+                {
+                    // Resuming may end the coroutine, and with it the waiter.
+                    auto next = w->next;
+                    w->resume(w->resumer, w->handle);
+                    w = next;
+                }
+            }
+
+        private:
+            static bool later(const Waiter* a, const Waiter* b)
+            {
+                return a->when > b->when;
+            }
+
+            std::vector<Waiter*> heap{};
+    };
+
+    // Awaitable suspending a coroutine until the next occurrence of a schedule after the current second,
+    // as returned by Cron::next(). The coroutine is resumed by the Resumer, which is called with its handle
+    // from within Cron::tick(). co_await yields a tuple of whether an occurrence was found and its time point.
+    //
+    // A coroutine destroyed while suspended on the awaiter stops waiting, but must not be destroyed while the
+    // Resumer is being called for it.
+    template<typename CronType, typename Resumer>
+    class NextOccurrence
+    {
+        public:
+            NextOccurrence(CronType& cron, const CronSchedule& schedule, Resumer resumer, bool valid = true)
+                    : cron(cron), schedule(schedule), resumer(std::move(resumer)), valid(valid)
+            {
+            }
+
+            ~NextOccurrence()
+            {
+                if (waiter.handle)
+                {
+                    cron.remove_waiter(waiter);
+                }
+            }
+
+            // The waiter is known to the Cron instance by its address.
+            NextOccurrence(const NextOccurrence&) = delete;
+
+            NextOccurrence& operator=(const NextOccurrence&) = delete;
+
+            bool await_ready()
+            {
+                using namespace std::chrono;
+
+                if (valid)
+                {
+                    auto from = floor<seconds>(cron.get_clock().now()) + seconds{ 1 };
+                    std::tie(waiter.found, waiter.when) = schedule.calculate_from(from);
+                }
+
+                return !waiter.found;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                waiter.schedule = &schedule;
+                waiter.handle = handle;
+                waiter.resumer = &resumer;
+                waiter.resume = [](void* r, std::coroutine_handle<> h)
+                                {
+                                    (*static_cast<Resumer*>(r))(h);
+                                };
+
+                cron.add_waiter(waiter);
+            }
+
+            std::tuple<bool, std::chrono::system_clock::time_point> await_resume() const
+            {
+                return { waiter.found, waiter.when };
+            }
+
+        private:
+            CronType& cron;
+            CronSchedule schedule;
+            Resumer resumer;
+            bool valid;
+            Waiter waiter{};
+    };
+}
+
+#endif
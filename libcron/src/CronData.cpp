@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <atomic>
 #include <date/date.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "libcron/CronData.h"
 
 using namespace date;
@@ -13,83 +18,320 @@ namespace libcron
                                                                                Months::October,
                                                                                Months::December };
 
-    const std::vector<std::string> CronData::month_names{ "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
-    const std::vector<std::string> CronData::day_names{ "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
-    std::unordered_map<std::string, CronData> CronData::cache{};
+    namespace
+    {
+        // A lock-striped cache: expressions are spread over a number of shards by hash, each shard having
+        // its own mutex. Within a shard, entries are evicted using the CLOCK approximation of LRU.
+        class Cache
+        {
+            public:
+                struct Shard
+                {
+                    struct Entry
+                    {
+                        CronData data;
+                        bool referenced = false;
+                    };
+
+                    using Entries = std::unordered_map<std::string, Entry>;
+
+                    bool find(const std::string& cron_expression, CronData& data)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        auto found = entries.find(cron_expression);
+                        bool res = found != entries.end();
+
+                        if (res)
+                        {
+                            found->second.referenced = true;
+                            data = found->second.data;
+                            ++hits;
+                        }
+                        else
+                        {
+                            ++misses;
+                        }
+
+                        return res;
+                    }
+
+                    void insert(const std::string& cron_expression, const CronData& data)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+
+                        if (capacity > 0 && entries.find(cron_expression) == entries.end())
+                        {
+                            if (clock.size() < capacity)
+                            {
+                                clock.push_back(entries.emplace(cron_expression, Entry{ data }).first);
+                            }
+                            else
+                            {
+                                // Give recently used entries a second chance, evict the first one that isn't.
+                                while (clock[hand]->second.referenced)
+                                {
+                                    clock[hand]->second.referenced = false;
+                                    hand = (hand + 1) % clock.size();
+                                }
+
+                                entries.erase(clock[hand]);
+                                ++evictions;
+
+                                clock[hand] = entries.emplace(cron_expression, Entry{ data }).first;
+                                hand = (hand + 1) % clock.size();
+                            }
+                        }
+                    }
+
+                    void reset(size_t new_capacity)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        capacity = new_capacity;
+                        clear_entries();
+                    }
+
+                    void clear()
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        clear_entries();
+                    }
+
+                    void clear_entries()
+                    {
+                        entries.clear();
+                        // Never rehashed from then on, which would invalidate the iterators in 'clock'.
+                        entries.reserve(capacity);
+                        clock.clear();
+                        clock.reserve(capacity);
+                        hand = 0;
+                    }
+
+                    void add_to(CronData::CacheStatistics& statistics)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        statistics.hits += hits;
+                        statistics.misses += misses;
+                        statistics.evictions += evictions;
+                        statistics.size += entries.size();
+                        statistics.capacity += capacity;
+                    }
+
+                    std::mutex lock{};
+                    Entries entries{};
+                    // The elements of 'entries', in clock order.
+                    std::vector<Entries::iterator> clock{};
+                    size_t hand = 0;
+                    size_t capacity = 0;
+                    uint64_t hits = 0;
+                    uint64_t misses = 0;
+                    uint64_t evictions = 0;
+                };
+
+                Cache()
+                {
+                    set_capacity(CronData::DEFAULT_CACHE_CAPACITY);
+                }
+
+                Shard& shard_for(const std::string& cron_expression)
+                {
+                    return shards[std::hash<std::string>{}(cron_expression) % shards_used.load(std::memory_order_relaxed)];
+                }
+
+                void set_capacity(size_t capacity)
+                {
+                    // Distribute the capacity so that the total never exceeds the requested value. A small capacity
+                    // uses fewer shards, so that each of them holds at least one entry.
+                    auto used = std::clamp<size_t>(capacity, 1, NUMBER_OF_SHARDS);
+                    shards_used.store(used, std::memory_order_relaxed);
+
+                    for (size_t i = 0; i < NUMBER_OF_SHARDS; ++i)
+                    {
+                        shards[i].reset(i < used ? capacity / used + (i < capacity % used ? 1 : 0) : 0);
+                    }
+                }
+
+                CronData::CacheStatistics statistics()
+                {
+                    CronData::CacheStatistics res{};
+
+                    for (auto& shard : shards)
+                    {
+                        shard.add_to(res);
+                    }
+
+                    return res;
+                }
+
+                void clear()
+                {
+                    for (auto& shard : shards)
+                    {
+                        shard.clear();
+                    }
+                }
+
+            private:
+                static constexpr size_t NUMBER_OF_SHARDS = 16;
+                std::array<Shard, NUMBER_OF_SHARDS> shards{};
+                std::atomic<size_t> shards_used{ NUMBER_OF_SHARDS };
+        };
+
+        Cache& cache()
+        {
+            static Cache c{};
+            return c;
+        }
+    }
 
     CronData CronData::create(const std::string& cron_expression)
     {
         CronData c;
-        auto found = cache.find(cron_expression);
+        auto& shard = cache().shard_for(cron_expression);
 
-        if (found == cache.end())
+        if (!shard.find(cron_expression, c))
         {
+            // Parse without holding the lock; should another thread do the same, the first insert wins.
             c.parse(cron_expression);
-            cache[cron_expression] = c;
-        }
-        else
-        {
-            c = found->second;
+            shard.insert(cron_expression, c);
         }
-        
+
         return c;
     }
 
-    void CronData::parse(const std::string& cron_expression)
+    void CronData::set_cache_capacity(size_t capacity)
+    {
+        cache().set_capacity(capacity);
+    }
+
+    CronData::CacheStatistics CronData::get_cache_statistics()
+    {
+        return cache().statistics();
+    }
+
+    void CronData::clear_cache()
+    {
+        cache().clear();
+    }
+
+    CronData CronData::create_uncached(std::string_view cron_expression)
+    {
+        CronData c;
+        c.parse(cron_expression);
+        return c;
+    }
+
+    void CronData::parse(std::string_view cron_expression)
     {
         // First, check for "convenience scheduling" using @yearly, @annually,
         // @monthly, @weekly, @daily or @hourly.
-        std::string tmp = std::regex_replace(cron_expression, std::regex("@yearly"), "0 0 1 1 *");
-        tmp = std::regex_replace(tmp, std::regex("@annually"), "0 0 1 1 *");
-        tmp = std::regex_replace(tmp, std::regex("@monthly"), "0 0 1 * *");
-        tmp = std::regex_replace(tmp, std::regex("@weekly"), "0 0 * * 0");
-        tmp = std::regex_replace(tmp, std::regex("@daily"), "0 0 * * *");
-        const std::string expression = std::regex_replace(tmp, std::regex("@hourly"), "0 * * * *");
+        std::string expanded{};
+        auto expression = cron_expression;
 
-        // Second, split on white-space. We expect six parts.
-        std::regex split{ R"#(^\s*(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s*$)#",
-                          std::regex_constants::ECMAScript };
+        if (cron_expression.find('@') != std::string_view::npos)
+        {
+            expanded = expand_macros(cron_expression);
+            expression = expanded;
+        }
 
-        std::smatch match;
+        // Second, split on white-space. We expect six parts.
+        std::array<std::string_view, NUMBER_OF_FIELDS> fields{};
 
-        if (std::regex_match(expression.begin(), expression.end(), match, split))
+        if (split_fields(expression, fields))
         {
-            valid = validate_numeric<Seconds>(match[1], seconds);
-            valid &= validate_numeric<Minutes>(match[2], minutes);
-            valid &= validate_numeric<Hours>(match[3], hours);
-            valid &= validate_numeric<DayOfMonth>(match[4], day_of_month);
-            valid &= validate_literal<Months>(match[5], months, month_names);
-            valid &= validate_literal<DayOfWeek>(match[6], day_of_week, day_names);
-            valid &= check_dom_vs_dow(match[4], match[6]);
+            valid = parse_field<Seconds>(fields[0], seconds);
+            valid &= parse_field<Minutes>(fields[1], minutes);
+            valid &= parse_field<Hours>(fields[2], hours);
+            valid &= parse_field<DayOfMonth>(fields[3], day_of_month);
+            valid &= parse_field<Months>(fields[4], months);
+            valid &= parse_field<DayOfWeek>(fields[5], day_of_week);
+            valid &= check_dom_vs_dow(fields[3], fields[5]);
             valid &= validate_date_vs_months();
         }
     }
 
-    std::vector<std::string> CronData::split(const std::string& s, char token)
+    std::string CronData::expand_macros(std::string_view cron_expression)
     {
-        std::vector<std::string> res;
+        // The macros are replaced wherever they appear, not only when they make up the entire expression.
+        static constexpr std::pair<std::string_view, std::string_view> macros[] = {
+                { "@yearly",   "0 0 1 1 *" },
+                { "@annually", "0 0 1 1 *" },
+                { "@monthly",  "0 0 1 * *" },
+                { "@weekly",   "0 0 * * 0" },
+                { "@daily",    "0 0 * * *" },
+                { "@hourly",   "0 * * * *" }
+        };
 
-        std::string r = "[";
-        r += token;
-        r += "]";
-        std::regex splitter{ r, std::regex_constants::ECMAScript };
+        std::string res;
+        res.reserve(cron_expression.size());
 
-        std::copy(std::sregex_token_iterator(s.begin(), s.end(), splitter, -1),
-                  std::sregex_token_iterator(),
-                  std::back_inserter(res));
+        while (!cron_expression.empty())
+        {
+            auto macro = std::find_if(std::begin(macros), std::end(macros),
+                                      [&cron_expression](const auto& m)
+                                      {
+                                          return cron_expression.substr(0, m.first.size()) == m.first;
+                                      });
+
+            if (macro == std::end(macros))
+            {
+                res += cron_expression.front();
+                cron_expression.remove_prefix(1);
+            }
+            else
+            {
+                res += macro->second;
+                cron_expression.remove_prefix(macro->first.size());
+            }
+        }
 
         return res;
     }
 
-    bool CronData::is_number(const std::string& s)
+    bool CronData::split_fields(std::string_view expression, std::array<std::string_view, NUMBER_OF_FIELDS>& fields)
+    {
+        size_t count = 0;
+        size_t pos = 0;
+
+        while (pos < expression.size())
+        {
+            if (is_space(expression[pos]))
+            {
+                ++pos;
+            }
+            else
+            {
+                auto start = pos;
+
+                while (pos < expression.size() && !is_space(expression[pos]))
+                {
+                    ++pos;
+                }
+
+                if (count < fields.size())
+                {
+                    fields[count] = expression.substr(start, pos - start);
+                }
+
+                ++count;
+            }
+        }
+
+        return count == fields.size();
+    }
+
+    bool CronData::is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    bool CronData::is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    char CronData::to_upper(char c)
     {
-        // Find any character that isn't a number.
-        return !s.empty()
-               && std::find_if(s.begin(), s.end(),
-                               [](char c)
-                               {
-                                   return !std::isdigit(c);
-                               }) == s.end();
+        return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
     }
 
     bool CronData::is_between(int32_t value, int32_t low_limit, int32_t high_limt)
@@ -102,7 +344,7 @@ namespace libcron
         bool res = true;
 
         // Verify that the available dates are possible based on the given months
-        if (months.size() == 1 && months.find(static_cast<Months>(2)) != months.end())
+        if (months.size() == 1 && months.contains(Months::February))
         {
             // Only february allowed, make sure that the allowed date(s) includes 29 and below.
             res = has_any_in_range(day_of_month, 1, 29);
@@ -111,13 +353,13 @@ namespace libcron
         if (res)
         {
             // Make sure that if the days contains only 31, at least one month allows that date.
-            if (day_of_month.size() == 1 && day_of_month.find(DayOfMonth::Last) != day_of_month.end())
+            if (day_of_month.size() == 1 && day_of_month.contains(DayOfMonth::Last))
             {
                 res = false;
 
                 for (size_t i = 0; !res && i < NUMBER_OF_LONG_MONTHS; ++i)
                 {
-                    res = months.find(months_with_31[i]) != months.end();
+                    res = months.contains(months_with_31[i]);
                 }
             }
         }
@@ -125,7 +367,7 @@ namespace libcron
         return res;
     }
 
-    bool CronData::check_dom_vs_dow(const std::string& dom, const std::string& dow) const
+    bool CronData::check_dom_vs_dow(std::string_view dom, std::string_view dow) const
     {
         // Day of month and day of week are mutually exclusive so one of them must at always be ignored using
         // the '?'-character unless one field already is something other than '*'.
@@ -134,7 +376,7 @@ namespace libcron
         // as ignored. To make it explicit to the user of the library, we do however require the use of
         // '?' as the ignore flag, although it is functionally equivalent to '*'.
 
-        auto check = [](const std::string& l, std::string r)
+        auto check = [](std::string_view l, std::string_view r)
                      {
                          return l == "*" && (r != "*" || r == "?");
                      };
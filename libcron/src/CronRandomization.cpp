@@ -78,7 +78,7 @@ namespace libcron
             auto month = get_random_in_range<Months>(all_sections[5].str(), selected_value);
             res &= month.first;
 
-            std::set<Months> month_range{};
+            CronField<Months> month_range{};
 
             if (selected_value == -1)
             {
@@ -108,7 +108,7 @@ namespace libcron
         return { res, final_cron_schedule };
     }
 
-    std::pair<int, int> CronRandomization::day_limiter(const std::set<Months>& months)
+    std::pair<int, int> CronRandomization::day_limiter(const CronField<Months>& months)
     {
         int max = CronData::value_of(DayOfMonth::Last);
 
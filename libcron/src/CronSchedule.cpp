@@ -1,4 +1,5 @@
 #include "libcron/CronSchedule.h"
+#include <algorithm>
 #include <tuple>
 
 using namespace std::chrono;
@@ -10,87 +11,237 @@ namespace libcron
     std::tuple<bool, std::chrono::system_clock::time_point>
     CronSchedule::calculate_from(const std::chrono::system_clock::time_point& from) const
     {
-        auto curr = from;
+        // Discard fraction seconds in the calculated schedule time
+        //  that may leftover from the argument `from`, which in turn comes from `now()`.
+        // Fraction seconds will potentially make the task be triggered more than 1 second late
+        //  if the `tick()` within the same second is earlier than schedule time,
+        //  in that the task will not trigger until the next `tick()` next second.
+        // By discarding fraction seconds in the scheduled time,
+        //  the `tick()` within the same second will never be earlier than schedule time,
+        //  and the task will trigger in that `tick()`.
+        auto dt = to_calendar_time(date::floor<seconds>(from));
+
+        bool found = find_next(dt);
+
+        return std::make_tuple(found, found ? to_time_point(dt) : from);
+    }
+
+    std::tuple<bool, std::chrono::system_clock::time_point>
+    CronSchedule::calculate_previous(const std::chrono::system_clock::time_point& to) const
+    {
+        auto dt = to_calendar_time(date::floor<seconds>(to));
+
+        bool found = find_previous(dt);
 
-        bool done = false;
-        auto max_iterations = std::numeric_limits<uint16_t>::max();
+        return std::make_tuple(found, found ? to_time_point(dt) : to);
+    }
+
+    bool CronSchedule::find_next(DateTime& dt) const
+    {
+        // Each pass either finds all fields of 'dt' to be allowed, or moves the first field that isn't to its
+        // next allowed value, resetting the less significant fields. When the date has no allowed value left,
+        // the more significant field is incremented instead and the next pass takes care of any overflow.
+        // The time of day is resolved within a single pass, as is an overflow of dt.sec (see OccurrenceIterator).
+        // Since the less significant fields always have an allowed value after being reset, the number of
+        // passes is bounded by the number of months searched.
+        const auto last_year = dt.year + MAX_YEARS_TO_SEARCH;
+        bool found = false;
 
-        while (!done && --max_iterations > 0)
+        while (!found && dt.year <= last_year)
         {
-            bool date_changed = false;
-            year_month_day ymd = date::floor<days>(curr);
+            auto month = data.get_months().next(static_cast<int>(dt.month));
 
-            // Add months until one of the allowed days are found, or stay at the current one.
-            if (data.get_months().find(static_cast<Months>(unsigned(ymd.month()))) == data.get_months().end())
+            if (month == -1)
             {
-                auto next_month = ymd + months{1};
-                sys_days s = next_month.year() / next_month.month() / 1;
-                curr = s;
-                date_changed = true;
+                dt = DateTime{ dt.year + 1, 1, 1, 0, 0, 0 };
             }
-                // If all days are allowed (or the field is ignored via '?'), then the 'day of week' takes precedence.
-            else if (data.get_day_of_month().size() != CronData::value_of(DayOfMonth::Last))
+            else if (static_cast<unsigned>(month) != dt.month)
             {
-                // Add days until one of the allowed days are found, or stay at the current one.
-                if (data.get_day_of_month().find(static_cast<DayOfMonth>(unsigned(ymd.day()))) ==
-                    data.get_day_of_month().end())
-                {
-                    sys_days s = ymd;
-                    curr = s;
-                    curr += days{1};
-                    date_changed = true;
-                }
+                dt = DateTime{ dt.year, static_cast<unsigned>(month), 1, 0, 0, 0 };
             }
             else
             {
-                //Add days until the current weekday is one of the allowed weekdays
-                year_month_weekday ymw = date::floor<days>(curr);
+                auto day = next_allowed_day(dt);
 
-                if (data.get_day_of_week().find(static_cast<DayOfWeek>(ymw.weekday().c_encoding())) ==
-                    data.get_day_of_week().end())
+                if (day == -1)
                 {
-                    sys_days s = ymd;
-                    curr = s;
-                    curr += days{1};
-                    date_changed = true;
+                    dt = dt.month == 12 ? DateTime{ dt.year + 1, 1, 1, 0, 0, 0 }
+                                        : DateTime{ dt.year, dt.month + 1, 1, 0, 0, 0 };
+                }
+                else if (static_cast<unsigned>(day) != dt.day)
+                {
+                    dt = DateTime{ dt.year, dt.month, static_cast<unsigned>(day), 0, 0, 0 };
+                }
+                else
+                {
+                    auto hour = data.get_hours().next(dt.hour);
+                    auto minute = hour == dt.hour ? data.get_minutes().next(dt.min) : data.get_minutes().first();
+                    auto second = hour == dt.hour && minute == dt.min
+                                  ? data.get_seconds().next(dt.sec)
+                                  : data.get_seconds().first();
+
+                    if (second == -1)
+                    {
+                        // No later second within the current minute
+                        minute = data.get_minutes().next(dt.min + 1);
+                        second = data.get_seconds().first();
+                    }
+
+                    if (minute == -1)
+                    {
+                        // No later minute within the current hour
+                        hour = data.get_hours().next(dt.hour + 1);
+                        minute = data.get_minutes().first();
+                        second = data.get_seconds().first();
+                    }
+
+                    if (hour == -1)
+                    {
+                        dt = DateTime{ dt.year, dt.month, dt.day + 1, 0, 0, 0 };
+                    }
+                    else
+                    {
+                        dt.hour = static_cast<uint8_t>(hour);
+                        dt.min = static_cast<uint8_t>(minute);
+                        dt.sec = static_cast<uint8_t>(second);
+                        found = true;
+                    }
                 }
             }
+        }
+
+        return found;
+    }
+
+    int CronSchedule::next_allowed_day(const DateTime& dt) const
+    {
+        // Returns the first allowed day on or after dt.day within the month of 'dt', or -1 if there is none.
+        const auto ym = date::year{ dt.year } / date::month{ dt.month };
+        const auto last_day = static_cast<int>(unsigned((ym / last).day()));
+        auto res = static_cast<int>(dt.day);
+
+        if (res > last_day)
+        {
+            res = -1;
+        }
+        // If all days are allowed (or the field is ignored via '?'), then the 'day of week' takes precedence.
+        else if (data.get_day_of_month().size() != CronData::value_of(DayOfMonth::Last))
+        {
+            res = data.get_day_of_month().next(res);
+        }
+        else
+        {
+            // Rotate the weekday mask so that bit 0 is the weekday of 'dt', then find the first allowed one.
+            auto weekdays = static_cast<uint32_t>(data.get_day_of_week().get_mask());
+            auto current = weekday{ sys_days{ ym / date::day{ dt.day } } }.c_encoding();
+            auto rotated = ((weekdays | weekdays << 7) >> current) & 0x7Fu;
 
-            if (!date_changed)
+            res = rotated == 0 ? -1 : res + bits::lowest(rotated);
+        }
+
+        return res > last_day ? -1 : res;
+    }
+
+    bool CronSchedule::find_previous(DateTime& dt) const
+    {
+        // The mirror image of find_next; each pass moves the first field that isn't allowed to its previous
+        // allowed value and sets the less significant fields to their last possible value. Days are clamped
+        // to the length of the month by previous_allowed_day, so moving to a new month starts at day 31.
+        const auto first_year = dt.year - MAX_YEARS_TO_SEARCH;
+        bool found = false;
+
+        while (!found && dt.year >= first_year)
+        {
+            auto month = data.get_months().previous(static_cast<int>(dt.month));
+
+            if (month == -1)
             {
-                auto date_time = to_calendar_time(curr);
-                if (data.get_hours().find(static_cast<Hours>(date_time.hour)) == data.get_hours().end())
-                {
-                    curr += hours{1};
-                    curr -= minutes{date_time.min};
-                    curr -= seconds{date_time.sec};
-                }
-                else if (data.get_minutes().find(static_cast<Minutes >(date_time.min)) == data.get_minutes().end())
+                dt = DateTime{ dt.year - 1, 12, 31, 23, 59, 59 };
+            }
+            else if (static_cast<unsigned>(month) != dt.month)
+            {
+                dt = DateTime{ dt.year, static_cast<unsigned>(month), 31, 23, 59, 59 };
+            }
+            else
+            {
+                auto day = previous_allowed_day(dt);
+
+                if (day == -1)
                 {
-                    curr += minutes{1};
-                    curr -= seconds{date_time.sec};
+                    dt = dt.month == 1 ? DateTime{ dt.year - 1, 12, 31, 23, 59, 59 }
+                                       : DateTime{ dt.year, dt.month - 1, 31, 23, 59, 59 };
                 }
-                else if (data.get_seconds().find(static_cast<Seconds>(date_time.sec)) == data.get_seconds().end())
+                else if (static_cast<unsigned>(day) != dt.day)
                 {
-                    curr += seconds{1};
+                    dt = DateTime{ dt.year, dt.month, static_cast<unsigned>(day), 23, 59, 59 };
                 }
                 else
                 {
-                    done = true;
+                    auto hour = data.get_hours().previous(dt.hour);
+                    auto minute = hour == dt.hour ? data.get_minutes().previous(dt.min) : data.get_minutes().last();
+                    auto second = hour == dt.hour && minute == dt.min
+                                  ? data.get_seconds().previous(dt.sec)
+                                  : data.get_seconds().last();
+
+                    if (second == -1)
+                    {
+                        // No earlier second within the current minute
+                        minute = data.get_minutes().previous(dt.min - 1);
+                        second = data.get_seconds().last();
+                    }
+
+                    if (minute == -1)
+                    {
+                        // No earlier minute within the current hour
+                        hour = data.get_hours().previous(dt.hour - 1);
+                        minute = data.get_minutes().last();
+                        second = data.get_seconds().last();
+                    }
+
+                    if (hour == -1)
+                    {
+                        dt = DateTime{ dt.year, dt.month, dt.day - 1, 23, 59, 59 };
+                    }
+                    else
+                    {
+                        dt.hour = static_cast<uint8_t>(hour);
+                        dt.min = static_cast<uint8_t>(minute);
+                        dt.sec = static_cast<uint8_t>(second);
+                        found = true;
+                    }
                 }
             }
         }
 
-        // Discard fraction seconds in the calculated schedule time
-        //  that may leftover from the argument `from`, which in turn comes from `now()`.
-        // Fraction seconds will potentially make the task be triggered more than 1 second late
-        //  if the `tick()` within the same second is earlier than schedule time,
-        //  in that the task will not trigger until the next `tick()` next second.
-        // By discarding fraction seconds in the scheduled time,
-        //  the `tick()` within the same second will never be earlier than schedule time,
-        //  and the task will trigger in that `tick()`.
-        curr -= curr.time_since_epoch() % seconds{1};
+        return found;
+    }
+
+    int CronSchedule::previous_allowed_day(const DateTime& dt) const
+    {
+        // Returns the last allowed day on or before dt.day within the month of 'dt', or -1 if there is none.
+        // A dt.day past the end of the month is treated as the last day of the month.
+        const auto ym = date::year{ dt.year } / date::month{ dt.month };
+        const auto last_day = static_cast<int>(unsigned((ym / last).day()));
+        auto res = std::min(static_cast<int>(dt.day), last_day);
+
+        if (res < 1)
+        {
+            res = -1;
+        }
+        else if (data.get_day_of_month().size() != CronData::value_of(DayOfMonth::Last))
+        {
+            res = data.get_day_of_month().previous(res);
+        }
+        else
+        {
+            // Bit j of the window is the weekday 6 - j days before the weekday of 'res'.
+            auto weekdays = static_cast<uint32_t>(data.get_day_of_week().get_mask());
+            auto current = weekday{ sys_days{ ym / date::day{ static_cast<unsigned>(res) } } }.c_encoding();
+            auto window = ((weekdays | weekdays << 7) >> (current + 1)) & 0x7Fu;
+
+            res = window == 0 ? -1 : res - (6 - bits::highest(window));
+        }
 
-        return std::make_tuple(max_iterations > 0, curr);
+        return res < 1 ? -1 : res;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,217 @@
+#include "libcron/Executor.h"
+
+using namespace std::chrono;
+
+namespace libcron
+{
+
+    ThreadPoolExecutor::ThreadPoolExecutor(size_t thread_count)
+    {
+        start(thread_count);
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor()
+    {
+        stop();
+    }
+
+    void ThreadPoolExecutor::execute(Task& t, std::chrono::system_clock::time_point now)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        auto& runs = t.get_runs();
+
+        if ((runs && runs->running > 0 && runs->overlap == Overlap::Skip) || pending >= max_pending)
+        {
+            // The task is left as it was, other than counting the skipped run.
+            ++skipped;
+            t.record_skip();
+            totals.record_skip();
+
+            if (trace)
+            {
+                trace->record_skip(t.get_name(), steady_clock::now(), now - t.get_next_schedule());
+            }
+
+            return;
+        }
+
+        t.start(now);
+
+        if (!runs)
+        {
+            // The task only ever runs here from now on, so its work need not be copied.
+            runs = std::make_shared<TaskRuns>(t.get_name(), t.get_id(), t.take_work(), t.get_overlap(),
+                                              t.get_metrics());
+        }
+
+        TaskRun run{ t.get_next_schedule(), now, t.get_fire_count(), steady_clock::now() };
+
+        if (trace)
+        {
+            trace->record_fire(runs->name, run.dispatched, now - run.scheduled);
+        }
+
+        if (runs->running > 0 && runs->overlap == Overlap::Queue)
+        {
+            runs->waiting.push_back(std::move(run));
+            ++pending;
+        }
+        else
+        {
+            ++runs->running;
+            jobs.push_back(Job{ runs, std::move(run) });
+            ++pending;
+            work_available.notify_one();
+        }
+    }
+
+    void ThreadPoolExecutor::wait_until_idle()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        idle.wait(lock, [this]()
+                        {
+                            return pending == 0;
+                        });
+    }
+
+    void ThreadPoolExecutor::set_thread_count(size_t count)
+    {
+        stop();
+        start(count);
+    }
+
+    size_t ThreadPoolExecutor::get_thread_count() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return workers.size();
+    }
+
+    void ThreadPoolExecutor::set_max_pending(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        max_pending = count;
+    }
+
+    size_t ThreadPoolExecutor::get_skipped() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return skipped;
+    }
+
+    void ThreadPoolExecutor::set_trace_recorder(std::shared_ptr<TraceRecorder> recorder)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        trace = std::move(recorder);
+    }
+
+    size_t ThreadPoolExecutor::default_thread_count()
+    {
+        auto count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    void ThreadPoolExecutor::start(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = false;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            workers.emplace_back([this]()
+                                 {
+                                     work();
+                                 });
+        }
+    }
+
+    void ThreadPoolExecutor::stop()
+    {
+        // Taken out under the lock, as get_thread_count() may look at them meanwhile.
+        std::vector<std::thread> stopped;
+
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+            stopped.swap(workers);
+        }
+
+        work_available.notify_all();
+
+        for (auto& w : stopped)
+        {
+            w.join();
+        }
+    }
+
+    void ThreadPoolExecutor::work()
+    {
+        std::unique_lock<std::mutex> lock(m);
+
+        // Workers only stop once there is nothing left to do.
+        while (!stopping || !jobs.empty())
+        {
+            work_available.wait(lock, [this]()
+                                      {
+                                          return stopping || !jobs.empty();
+                                      });
+
+            if (!jobs.empty())
+            {
+                auto job = std::move(jobs.front());
+                jobs.pop_front();
+                // Kept for the runs below, should the recorder be replaced meanwhile
+                auto recorder = trace;
+                bool more = true;
+
+                // Runs waiting for this one are run on the same thread, one after the other.
+                while (more)
+                {
+                    lock.unlock();
+
+                    auto started = steady_clock::now();
+                    auto waited = duration_cast<system_clock::duration>(started - job.run.dispatched);
+                    TaskInformation info{ job.runs->name, job.runs->id, job.run.scheduled, job.run.expired + waited,
+                                          job.run.fire_count };
+
+                    try
+                    {
+                        job.runs->work(info);
+                    }
+                    catch (...)
+                    {
+                        job.runs->metrics->record_failure();
+                        totals.record_failure();
+                    }
+
+                    auto run_time = steady_clock::now() - started;
+                    job.runs->metrics->record_run(info.get_delay(), run_time);
+                    totals.record_run(info.get_delay(), run_time);
+
+                    if (recorder)
+                    {
+                        recorder->record_run(job.runs->name, started, run_time, info.get_delay());
+                    }
+
+                    lock.lock();
+                    --pending;
+
+                    if (job.runs->waiting.empty())
+                    {
+                        --job.runs->running;
+                        more = false;
+                    }
+                    else
+                    {
+                        job.run = std::move(job.runs->waiting.front());
+                        job.runs->waiting.pop_front();
+                    }
+                }
+
+                if (pending == 0)
+                {
+                    idle.notify_all();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,408 @@
+#include "libcron/OpenMetrics.h"
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include "libcron/CronData.h"
+
+using namespace std::chrono;
+
+namespace libcron
+{
+    namespace
+    {
+        // The upper bounds of the exported histogram buckets, and their labels. A value is counted in the
+        // first bucket whose bound is at or above the highest value of its LatencyBuckets bucket, so it may be
+        // counted a bucket higher than it would be exactly.
+        struct Bound
+        {
+            microseconds bound;
+            std::string_view label;
+        };
+
+        constexpr Bound BOUNDS[] = {
+                { microseconds{ 100 },       "0.0001" },
+                { microseconds{ 1000 },      "0.001" },
+                { microseconds{ 10000 },     "0.01" },
+                { microseconds{ 100000 },    "0.1" },
+                { microseconds{ 250000 },    "0.25" },
+                { microseconds{ 500000 },    "0.5" },
+                { seconds{ 1 },              "1.0" },
+                { microseconds{ 2500000 },   "2.5" },
+                { seconds{ 5 },              "5.0" },
+                { seconds{ 10 },             "10.0" },
+                { seconds{ 30 },             "30.0" },
+                { seconds{ 60 },             "60.0" },
+                { seconds{ 300 },            "300.0" }
+        };
+
+        void append(std::string& out, uint64_t value)
+        {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, res.ptr);
+        }
+
+        // A number with six decimals, given in millionths
+        void append_millionths(std::string& out, int64_t value)
+        {
+            if (value < 0)
+            {
+                out += '-';
+                value = -value;
+            }
+
+            append(out, static_cast<uint64_t>(value / 1000000));
+            out += '.';
+
+            char fraction[6];
+            auto rest = value % 1000000;
+
+            for (auto i = 6; i-- > 0;)
+            {
+                fraction[i] = static_cast<char>('0' + rest % 10);
+                rest /= 10;
+            }
+
+            out.append(fraction, sizeof(fraction));
+        }
+
+        void append(std::string& out, microseconds value)
+        {
+            append_millionths(out, value.count());
+        }
+
+        void append_escaped(std::string& out, std::string_view value)
+        {
+            for (auto c : value)
+            {
+                switch (c)
+                {
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    default:
+                        out += c;
+                        break;
+                }
+            }
+        }
+
+        void family(std::string& out, std::string_view name, std::string_view type, std::string_view help,
+                    bool in_seconds = false)
+        {
+            out += "# TYPE ";
+            out += name;
+            out += ' ';
+            out += type;
+            out += '\n';
+
+            if (in_seconds)
+            {
+                out += "# UNIT ";
+                out += name;
+                out += " seconds\n";
+            }
+
+            out += "# HELP ";
+            out += name;
+            out += ' ';
+            out += help;
+            out += '\n';
+        }
+
+        // A sample of 'name' with the label task="task_name", or no labels if 'task_name' is null.
+        void sample_name(std::string& out, std::string_view name, std::string_view suffix, const std::string* task_name)
+        {
+            out += name;
+            out += suffix;
+
+            if (task_name)
+            {
+                out += "{task=\"";
+                append_escaped(out, *task_name);
+                out += "\"}";
+            }
+
+            out += ' ';
+        }
+
+        void counter(std::string& out, std::string_view name, uint64_t value, const std::string* task_name = nullptr)
+        {
+            sample_name(out, name, "_total", task_name);
+            append(out, value);
+            out += '\n';
+        }
+
+        void bucket(std::string& out, std::string_view name, std::string_view bound, uint64_t count,
+                    const std::string* task_name)
+        {
+            out += name;
+            out += "_bucket{";
+
+            if (task_name)
+            {
+                out += "task=\"";
+                append_escaped(out, *task_name);
+                out += "\",";
+            }
+
+            out += "le=\"";
+            out += bound;
+            out += "\"} ";
+            append(out, count);
+            out += '\n';
+        }
+
+        // Histogram is a LatencyHistogram or LatencyCounts.
+        template<typename Histogram>
+        void histogram(std::string& out, std::string_view name, const Histogram& histogram, microseconds sum,
+                       const std::string* task_name = nullptr)
+        {
+            uint64_t count = 0;
+            size_t i = 0;
+
+            for (const auto& b : BOUNDS)
+            {
+                for (; i < LatencyBuckets::COUNT && LatencyBuckets::highest(i) <= b.bound; ++i)
+                {
+                    count += histogram.count(i);
+                }
+
+                bucket(out, name, b.label, count, task_name);
+            }
+
+            for (; i < LatencyBuckets::COUNT; ++i)
+            {
+                count += histogram.count(i);
+            }
+
+            bucket(out, name, "+Inf", count, task_name);
+
+            sample_name(out, name, "_count", task_name);
+            append(out, count);
+            out += '\n';
+
+            sample_name(out, name, "_sum", task_name);
+            append(out, sum);
+            out += '\n';
+        }
+    }
+
+    void OpenMetricsExporter::choose(const Task& t, const TaskMetrics& metrics)
+    {
+        auto total_delay = metrics.get_total_delay();
+        // The least delayed chosen task is first.
+        auto more_delayed = [](const Entry& a, const Entry& b)
+        {
+            return a.total_delay > b.total_delay;
+        };
+
+        bool keep = chosen < max_tasks;
+
+        if (keep)
+        {
+            if (chosen == entries.size())
+            {
+                entries.emplace_back();
+            }
+
+            ++chosen;
+        }
+        else if (max_tasks > 0 && entries[0].total_delay < total_delay)
+        {
+            std::pop_heap(entries.begin(), entries.begin() + static_cast<ptrdiff_t>(chosen), more_delayed);
+            keep = true;
+            ++dropped;
+        }
+        else
+        {
+            ++dropped;
+        }
+
+        if (keep)
+        {
+            auto& e = entries[chosen - 1];
+            e.total_delay = total_delay;
+            e.name = t.get_name();
+            e.metrics = t.get_metrics();
+            std::push_heap(entries.begin(), entries.begin() + static_cast<ptrdiff_t>(chosen), more_delayed);
+        }
+    }
+
+    void OpenMetricsExporter::merge_names()
+    {
+        auto end = entries.begin() + static_cast<ptrdiff_t>(chosen);
+        auto series = entries.begin();
+        size_t merged = 0;
+
+        for (auto it = entries.begin(); it != end;)
+        {
+            auto last = std::find_if(std::next(it), end, [&it](const Entry& e)
+                                                         {
+                                                             return e.name != it->name;
+                                                         });
+
+            // The entries before 'it' have been merged into those before 'series', so may be overwritten.
+            if (series != it)
+            {
+                std::swap(*series, *it);
+            }
+
+            series->runs = series->metrics->get_runs();
+            series->skipped = series->metrics->get_skipped();
+            series->missed = series->metrics->get_missed();
+            series->failed = series->metrics->get_failed();
+            series->merged = NOT_MERGED;
+
+            if (std::next(it) != last)
+            {
+                if (merged == merged_delays.size())
+                {
+                    merged_delays.emplace_back();
+                }
+
+                auto& delays = merged_delays[merged];
+                delays = LatencyCounts{};
+                delays.add(series->metrics->get_delays());
+
+                for (auto other = std::next(it); other != last; ++other)
+                {
+                    series->total_delay += other->total_delay;
+                    series->runs += other->metrics->get_runs();
+                    series->skipped += other->metrics->get_skipped();
+                    series->missed += other->metrics->get_missed();
+                    series->failed += other->metrics->get_failed();
+                    delays.add(other->metrics->get_delays());
+                }
+
+                series->merged = merged++;
+            }
+
+            ++series;
+            it = last;
+        }
+
+        chosen = static_cast<size_t>(series - entries.begin());
+    }
+
+    void OpenMetricsExporter::render(size_t tasks, bool has_next, std::chrono::system_clock::duration until_next,
+                                     const TickMetrics& ticks, const TaskMetrics& totals, std::string& out)
+    {
+        auto end = entries.begin() + static_cast<ptrdiff_t>(chosen);
+
+        // Ordered by name, so that the output is stable and tasks sharing a name are next to each other.
+        std::sort(entries.begin(), end, [](const Entry& a, const Entry& b)
+                                        {
+                                            return a.name < b.name;
+                                        });
+
+        merge_names();
+        end = entries.begin() + static_cast<ptrdiff_t>(chosen);
+
+        family(out, "libcron_tasks", "gauge", "Tasks, including paused ones.");
+        out += "libcron_tasks ";
+        append(out, static_cast<uint64_t>(tasks));
+        out += '\n';
+
+        if (has_next)
+        {
+            family(out, "libcron_next_fire_seconds", "gauge", "Time until the next task expires.", true);
+            out += "libcron_next_fire_seconds ";
+            append(out, duration_cast<microseconds>(until_next));
+            out += '\n';
+        }
+
+        family(out, "libcron_tick_duration_seconds", "histogram", "Time taken by ticks.", true);
+        histogram(out, "libcron_tick_duration_seconds", ticks.get_durations(), ticks.get_total_time());
+
+        family(out, "libcron_runs", "counter", "Runs of all tasks, including removed ones.");
+        counter(out, "libcron_runs", totals.get_runs());
+        family(out, "libcron_skipped_runs", "counter", "Runs skipped as the previous run had not finished.");
+        counter(out, "libcron_skipped_runs", totals.get_skipped());
+        family(out, "libcron_missed_runs", "counter", "Runs so late that later occurrences passed.");
+        counter(out, "libcron_missed_runs", totals.get_missed());
+        family(out, "libcron_failed_runs", "counter", "Runs that ended by throwing an exception.");
+        counter(out, "libcron_failed_runs", totals.get_failed());
+
+        family(out, "libcron_delay_seconds", "histogram", "Time from when runs were scheduled until they started.", true);
+        histogram(out, "libcron_delay_seconds", totals.get_delays(), totals.get_total_delay());
+        family(out, "libcron_run_time_seconds", "histogram", "Time taken by runs.", true);
+        histogram(out, "libcron_run_time_seconds", totals.get_run_times(), totals.get_total_run_time());
+
+        family(out, "libcron_task_runs", "counter", "Runs of the task.");
+        for (auto it = entries.begin(); it != end; ++it)
+        {
+            counter(out, "libcron_task_runs", it->runs, &it->name);
+        }
+
+        family(out, "libcron_task_skipped_runs", "counter", "Runs of the task skipped as the previous run had not finished.");
+        for (auto it = entries.begin(); it != end; ++it)
+        {
+            counter(out, "libcron_task_skipped_runs", it->skipped, &it->name);
+        }
+
+        family(out, "libcron_task_missed_runs", "counter", "Runs of the task so late that later occurrences passed.");
+        for (auto it = entries.begin(); it != end; ++it)
+        {
+            counter(out, "libcron_task_missed_runs", it->missed, &it->name);
+        }
+
+        family(out, "libcron_task_failed_runs", "counter", "Runs of the task that ended by throwing an exception.");
+        for (auto it = entries.begin(); it != end; ++it)
+        {
+            counter(out, "libcron_task_failed_runs", it->failed, &it->name);
+        }
+
+        family(out, "libcron_task_delay_seconds", "histogram",
+               "Time from when runs of the task were scheduled until they started.", true);
+        for (auto it = entries.begin(); it != end; ++it)
+        {
+            if (it->merged == NOT_MERGED)
+            {
+                histogram(out, "libcron_task_delay_seconds", it->metrics->get_delays(), it->total_delay, &it->name);
+            }
+            else
+            {
+                histogram(out, "libcron_task_delay_seconds", merged_delays[it->merged], it->total_delay, &it->name);
+            }
+        }
+
+        family(out, "libcron_tasks_not_exported", "gauge", "Tasks that have run, but have no series of their own.");
+        out += "libcron_tasks_not_exported ";
+        append(out, static_cast<uint64_t>(dropped));
+        out += '\n';
+
+        auto cache = CronData::get_cache_statistics();
+        auto lookups = cache.hits + cache.misses;
+
+        family(out, "libcron_expression_cache_hits", "counter", "Expressions found in the cache of CronData::create.");
+        counter(out, "libcron_expression_cache_hits", cache.hits);
+        family(out, "libcron_expression_cache_misses", "counter", "Expressions parsed by CronData::create.");
+        counter(out, "libcron_expression_cache_misses", cache.misses);
+        family(out, "libcron_expression_cache_evictions", "counter", "Expressions evicted from the cache.");
+        counter(out, "libcron_expression_cache_evictions", cache.evictions);
+        family(out, "libcron_expression_cache_size", "gauge", "Expressions in the cache.");
+        out += "libcron_expression_cache_size ";
+        append(out, static_cast<uint64_t>(cache.size));
+        out += '\n';
+        family(out, "libcron_expression_cache_hit_ratio", "gauge", "Fraction of lookups found in the cache.");
+        out += "libcron_expression_cache_hit_ratio ";
+        append_millionths(out, lookups == 0 ? 0 : static_cast<int64_t>(static_cast<double>(cache.hits) * 1e6
+                                                                       / static_cast<double>(lookups)));
+        out += '\n';
+
+        out += "# EOF\n";
+
+        // Does not keep the metrics of removed tasks alive until the next call.
+        for (auto& e : entries)
+        {
+            e.metrics.reset();
+        }
+    }
+}
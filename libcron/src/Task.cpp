@@ -7,7 +7,7 @@ namespace libcron
 
     bool Task::calculate_next(std::chrono::system_clock::time_point from)
     {
-        auto result = schedule.calculate_from(from);
+        auto result = schedule->calculate_from(from);
 
         // In case the calculation fails, the task will no longer expire.
         valid = std::get<0>(result);
@@ -16,15 +16,36 @@ namespace libcron
             next_schedule = std::get<1>(result);
 
             // Make sure that the task is allowed to run.
-            last_run = next_schedule - 1s;
+            allowed_from = next_schedule - 1s;
         }
 
         return valid;
     }
 
+    bool Task::check_missed(std::chrono::system_clock::time_point scheduled, std::chrono::system_clock::time_point now)
+    {
+        bool res = false;
+
+        // Occurrences are on whole seconds, so only a task expiring a second or more late can have missed any.
+        if (now - scheduled >= 1s && metrics)
+        {
+            // Bypasses the memo of the shared schedule, which holds the next occurrence from 'now' for the other
+            // tasks expiring with this one.
+            auto result = schedule->get_schedule().calculate_from(scheduled + 1s);
+            res = std::get<0>(result) && std::get<1>(result) <= now;
+
+            if (res)
+            {
+                metrics->record_miss();
+            }
+        }
+
+        return res;
+    }
+
     bool Task::is_expired(std::chrono::system_clock::time_point now) const
     {
-        return valid && now >= last_run && time_until_expiry(now) == 0s;
+        return valid && now >= allowed_from && time_until_expiry(now) == 0s;
     }
 
     std::chrono::system_clock::duration Task::time_until_expiry(std::chrono::system_clock::time_point now) const
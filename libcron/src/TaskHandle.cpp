@@ -0,0 +1,94 @@
+#include "libcron/TaskHandle.h"
+
+namespace libcron
+{
+    namespace
+    {
+        // The chunk holding 'index', chunk c holding the FIRST_CHUNK << c indexes from FIRST_CHUNK * (2^c - 1).
+        size_t chunk_of(uint32_t index, uint32_t first_chunk) noexcept
+        {
+            auto n = uint64_t{ index } / first_chunk + 1;
+            size_t res = 0;
+
+            while (n > 1)
+            {
+                n >>= 1;
+                ++res;
+            }
+
+            return res;
+        }
+    }
+
+    TaskHandles::~TaskHandles()
+    {
+        for (auto& c : chunks)
+        {
+            delete[] c.load(std::memory_order_relaxed);
+        }
+    }
+
+    TaskHandle TaskHandles::allocate()
+    {
+        auto head = free_head.load(std::memory_order_acquire);
+
+        while (static_cast<uint32_t>(head) != 0)
+        {
+            auto index = static_cast<uint32_t>(head) - 1;
+            auto next = entry(index).next.load(std::memory_order_relaxed);
+            auto tag = (head >> 32) + 1;
+
+            // Should another thread have taken the index meanwhile, the tag has changed and 'next' is not used.
+            if (free_head.compare_exchange_weak(head, tag << 32 | next, std::memory_order_acquire,
+                                                std::memory_order_acquire))
+            {
+                return TaskHandle{ index, entry(index).generation.load(std::memory_order_relaxed) };
+            }
+        }
+
+        auto index = used.fetch_add(1, std::memory_order_relaxed);
+        return TaskHandle{ index, entry(index).generation.load(std::memory_order_relaxed) };
+    }
+
+    void TaskHandles::release(TaskHandle handle)
+    {
+        auto index = handle.get_index();
+        auto& e = entry(index);
+        auto generation = e.generation.load(std::memory_order_relaxed) + 1;
+
+        // Generation 0 is that of the default constructed handle.
+        e.generation.store(generation == 0 ? 1 : generation, std::memory_order_relaxed);
+
+        auto head = free_head.load(std::memory_order_relaxed);
+
+        do
+        {
+            e.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        }
+        while (!free_head.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | (index + 1),
+                                                std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    TaskHandles::Entry& TaskHandles::entry(uint32_t index)
+    {
+        auto c = chunk_of(index, FIRST_CHUNK);
+        auto chunk = chunks[c].load(std::memory_order_acquire);
+
+        if (chunk == nullptr)
+        {
+            // Threads allocating into the same new chunk race to install it; the others discard theirs.
+            auto created = new Entry[size_t{ FIRST_CHUNK } << c];
+
+            if (chunks[c].compare_exchange_strong(chunk, created, std::memory_order_acq_rel))
+            {
+                chunk = created;
+            }
+            else
+            {
+                delete[] created;
+            }
+        }
+
+        return chunk[index - FIRST_CHUNK * ((uint32_t{ 1 } << c) - 1)];
+    }
+}
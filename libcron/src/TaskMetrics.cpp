@@ -0,0 +1,110 @@
+#include "libcron/TaskMetrics.h"
+#include <cmath>
+
+using namespace std::chrono;
+
+namespace libcron
+{
+
+    microseconds LatencyBuckets::highest(size_t index) noexcept
+    {
+        uint64_t res = index;
+
+        if (index >= SUB_BUCKETS)
+        {
+            auto power = index / SUB_BUCKETS + 1;
+            auto width = uint64_t{ 1 } << (power - 2);
+            res = (SUB_BUCKETS + index % SUB_BUCKETS) * width + width - 1;
+        }
+
+        return microseconds{ res };
+    }
+
+    void LatencyCounts::add(const LatencyHistogram& histogram) noexcept
+    {
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            counts[i] += histogram.count(i);
+        }
+    }
+
+    void LatencyCounts::add(const LatencyCounts& other) noexcept
+    {
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+    }
+
+    uint64_t LatencyCounts::total() const noexcept
+    {
+        uint64_t res = 0;
+
+        for (auto c : counts)
+        {
+            res += c;
+        }
+
+        return res;
+    }
+
+    microseconds LatencyCounts::value_at_quantile(double quantile) const noexcept
+    {
+        auto t = total();
+        microseconds res{};
+
+        if (t > 0)
+        {
+            // The rank of the value, from 1 to the total
+            auto rank = static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(t)));
+            rank = std::clamp<uint64_t>(rank, 1, t);
+            uint64_t seen = 0;
+            size_t i = 0;
+
+            while (seen + counts[i] < rank)
+            {
+                seen += counts[i++];
+            }
+
+            res = LatencyBuckets::highest(i);
+        }
+
+        return res;
+    }
+
+    void RunSamples::record(TaskMetrics& totals) noexcept
+    {
+        // How many runs ahead the metrics are fetched, enough to keep several fetches underway at once.
+        constexpr size_t AHEAD = 8;
+
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            if (i + AHEAD < samples.size())
+            {
+                const auto& ahead = samples[i + AHEAD];
+                ahead.metrics->prefetch(ahead.delay, ahead.run_time);
+            }
+
+            const auto& s = samples[i];
+            s.metrics->record_run(s.delay, s.run_time);
+            totals.record_run(s.delay, s.run_time);
+        }
+
+        samples.clear();
+    }
+
+    void MetricsSummary::add(const TaskMetrics& metrics) noexcept
+    {
+        ++tasks;
+        runs += metrics.get_runs();
+        skipped += metrics.get_skipped();
+        missed += metrics.get_missed();
+        failed += metrics.get_failed();
+        last_delay = std::max(last_delay, metrics.get_last_delay());
+        last_run_time = std::max(last_run_time, metrics.get_last_run_time());
+        total_delay += metrics.get_total_delay();
+        total_run_time += metrics.get_total_run_time();
+        delays.add(metrics.get_delays());
+        run_times.add(metrics.get_run_times());
+    }
+}
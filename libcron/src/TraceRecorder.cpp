@@ -0,0 +1,205 @@
+#include "libcron/TraceRecorder.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace libcron
+{
+    namespace
+    {
+        // Small numbers for the threads recording events, as trace viewers show them.
+        uint32_t thread_number() noexcept
+        {
+            static std::atomic<uint32_t> next{ 1 };
+            thread_local uint32_t number = next.fetch_add(1, std::memory_order_relaxed);
+            return number;
+        }
+
+        // The length of 'name' cut to at most 'size' bytes, without splitting a UTF-8 sequence.
+        size_t cut_length(std::string_view name, size_t size) noexcept
+        {
+            if (name.size() <= size)
+            {
+                return name.size();
+            }
+
+            auto res = size;
+
+            // Back up to the first byte of the sequence that does not fit.
+            while (res > 0 && (static_cast<unsigned char>(name[res]) & 0xC0) == 0x80)
+            {
+                --res;
+            }
+
+            return res;
+        }
+
+        void append(std::string& out, uint64_t value)
+        {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, res.ptr);
+        }
+
+        // Microseconds with three decimals, given in nanoseconds
+        void append_microseconds(std::string& out, int64_t ns)
+        {
+            if (ns < 0)
+            {
+                out += '-';
+                ns = -ns;
+            }
+
+            append(out, static_cast<uint64_t>(ns / 1000));
+            out += '.';
+            auto rest = ns % 1000;
+            out += static_cast<char>('0' + rest / 100);
+            out += static_cast<char>('0' + rest / 10 % 10);
+            out += static_cast<char>('0' + rest % 10);
+        }
+
+        void append_escaped(std::string& out, std::string_view value)
+        {
+            for (auto c : value)
+            {
+                switch (c)
+                {
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    case '\t':
+                        out += "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            const char* hex = "0123456789abcdef";
+                            out += "\\u00";
+                            out += hex[(c >> 4) & 0xF];
+                            out += hex[c & 0xF];
+                        }
+                        else
+                        {
+                            out += c;
+                        }
+                        break;
+                }
+            }
+        }
+    }
+
+    TraceRecorder::TraceRecorder(size_t capacity)
+            : origin(steady_clock::now())
+    {
+        size_t size = 1;
+
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+
+        slots = std::make_unique<Slot[]>(size);
+        mask = size - 1;
+    }
+
+    void TraceRecorder::record(Kind kind, std::string_view task, steady_clock::time_point at, nanoseconds duration,
+                               nanoseconds delay) noexcept
+    {
+        auto index = head.fetch_add(1, std::memory_order_relaxed);
+        auto& slot = slots[index & mask];
+        auto length = cut_length(task, NAME_SIZE);
+
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.time.store(duration_cast<nanoseconds>(at - origin).count(), std::memory_order_relaxed);
+        slot.duration.store(duration.count(), std::memory_order_relaxed);
+        slot.delay.store(delay.count(), std::memory_order_relaxed);
+        slot.info.store(static_cast<uint64_t>(kind) | length << 8 | uint64_t{ thread_number() } << 32,
+                        std::memory_order_relaxed);
+
+        for (size_t i = 0; i * 8 < length; ++i)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, task.data() + i * 8, std::min<size_t>(8, length - i * 8));
+            slot.name[i].store(word, std::memory_order_relaxed);
+        }
+
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    void TraceRecorder::write_json(std::string& out) const
+    {
+        auto end = head.load(std::memory_order_acquire);
+        auto begin = end > mask ? end - mask - 1 : 0;
+        char name[NAME_SIZE];
+
+        out += "{\"traceEvents\":[\n"
+               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"libcron\"}}";
+
+        for (auto index = begin; index < end; ++index)
+        {
+            const auto& slot = slots[index & mask];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+
+            if (sequence != 2 * index + 2)
+            {
+                // Being written, or overwritten since
+                continue;
+            }
+
+            auto time = slot.time.load(std::memory_order_relaxed);
+            auto duration = slot.duration.load(std::memory_order_relaxed);
+            auto delay = slot.delay.load(std::memory_order_relaxed);
+            auto info = slot.info.load(std::memory_order_relaxed);
+            auto length = static_cast<size_t>(info >> 8 & 0xFF);
+
+            for (size_t i = 0; i * 8 < length; ++i)
+            {
+                auto word = slot.name[i].load(std::memory_order_relaxed);
+                std::memcpy(name + i * 8, &word, std::min<size_t>(8, length - i * 8));
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            {
+                continue;
+            }
+
+            auto kind = static_cast<Kind>(info & 0xFF);
+
+            out += ",\n{\"name\":\"";
+            append_escaped(out, std::string_view{ name, length });
+
+            if (kind == Kind::Run)
+            {
+                out += "\",\"cat\":\"run\",\"ph\":\"X\",\"dur\":";
+                append_microseconds(out, duration);
+            }
+            else
+            {
+                out += kind == Kind::Fire ? "\",\"cat\":\"fire\"" : "\",\"cat\":\"skip\"";
+                out += ",\"ph\":\"i\",\"s\":\"t\"";
+            }
+
+            out += ",\"ts\":";
+            append_microseconds(out, time);
+            out += ",\"pid\":1,\"tid\":";
+            append(out, info >> 32);
+            out += ",\"args\":{\"delay_ms\":";
+            append_microseconds(out, delay / 1000);
+            out += "}}";
+        }
+
+        out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+}
@@ -0,0 +1,128 @@
+#include <catch.hpp>
+#include <libcron/include/libcron/Cron.h>
+#include <libcron/externals/date/include/date/date.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace libcron;
+using namespace std::chrono;
+using namespace date;
+
+namespace
+{
+    std::atomic<uint64_t> allocations{0};
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+// Inlining the replacement operators makes GCC mistake free() for a mismatch with new.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Counts the allocations of the whole test executable.
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    class SteppingClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return seconds{0};
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = sys_days{2021_y / 1 / 1};
+    };
+
+    // Ticks once a second, with some tasks expiring on each tick, and returns the number of allocations made
+    // by the ticks after warming up.
+    template<template<typename> class QueueType>
+    uint64_t allocations_while_ticking(uint64_t& runs)
+    {
+        Cron<SteppingClock, NullLock, QueueType> c;
+
+        auto work = [&runs](auto& i)
+                    {
+                        if (i.get_name() == "Task 1" || i.get_delay() >= seconds{0})
+                        {
+                            ++runs;
+                        }
+                    };
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            auto expression = i % 2 == 0 ? "* * * * * ?" : std::to_string(i % 60) + " * * * * ?";
+            c.add_schedule("Task " + std::to_string(i), expression, work);
+        }
+
+        for (auto i = 0; i < 120; ++i)
+        {
+            c.get_clock().add(seconds{1});
+            c.tick();
+        }
+
+        auto before = allocations.load();
+
+        for (auto i = 0; i < 600; ++i)
+        {
+            c.get_clock().add(seconds{1});
+            c.tick();
+        }
+
+        return allocations.load() - before;
+    }
+}
+
+SCENARIO("Ticking does not allocate")
+{
+    GIVEN("Cron instances with tasks expiring every second or minute")
+    {
+        THEN("Once warmed up, ticking does not allocate with any queue")
+        {
+            uint64_t runs = 0;
+
+            auto sorted = allocations_while_ticking<TaskQueue>(runs);
+            auto heap = allocations_while_ticking<HeapTaskQueue>(runs);
+            auto wheel = allocations_while_ticking<TimingWheelQueue>(runs);
+
+            REQUIRE(runs > 0);
+            REQUIRE(sorted == 0);
+            REQUIRE(heap == 0);
+            REQUIRE(wheel == 0);
+        }
+    }
+}
@@ -0,0 +1,256 @@
+#include <catch.hpp>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <libcron/include/libcron/CronData.h>
+#include "LegacyCronData.h"
+
+using namespace libcron;
+
+namespace
+{
+    bool same_as_legacy(const std::string& expression)
+    {
+        LegacyCronData legacy;
+        auto legacy_valid = legacy.parse(expression);
+        auto c = CronData::create_uncached(expression);
+
+        bool res = legacy_valid == c.is_valid();
+
+        if (res && legacy_valid)
+        {
+            res = LegacyCronData::mask_of(legacy.seconds) == c.get_seconds().get_mask()
+                  && LegacyCronData::mask_of(legacy.minutes) == c.get_minutes().get_mask()
+                  && LegacyCronData::mask_of(legacy.hours) == c.get_hours().get_mask()
+                  && LegacyCronData::mask_of(legacy.day_of_month) == c.get_day_of_month().get_mask()
+                  && LegacyCronData::mask_of(legacy.months) == c.get_months().get_mask()
+                  && LegacyCronData::mask_of(legacy.day_of_week) == c.get_day_of_week().get_mask();
+        }
+
+        if (!res)
+        {
+            std::cout << "Parsers disagree on '" << expression << "'\n";
+        }
+
+        return res;
+    }
+
+    class ExpressionGenerator
+    {
+        public:
+            std::string expression()
+            {
+                std::string res = pick({ "", "", "", " ", "\t" });
+                auto fields = pick_number(0, 20) == 0 ? pick_number(4, 7) : 6;
+
+                for (auto i = 0; i < fields; ++i)
+                {
+                    if (i > 0)
+                    {
+                        res += pick({ " ", " ", " ", "  ", "\t", " \n " });
+                    }
+
+                    res += field(i % 6);
+                }
+
+                res += pick({ "", "", "", " ", "\n" });
+
+                return res;
+            }
+
+        private:
+            std::string field(int index)
+            {
+                std::string res;
+
+                if (index == 5 && pick_number(0, 1) == 0)
+                {
+                    // Day of month and day of week are mutually exclusive, so ignore one of them most of the time.
+                    res = "?";
+                }
+                else if (pick_number(0, 10) == 0)
+                {
+                    res = pick({ "*", "?" });
+                }
+                else
+                {
+                    auto parts = pick_number(1, 3);
+
+                    for (auto i = 0; i < parts; ++i)
+                    {
+                        if (i > 0)
+                        {
+                            res += ",";
+                        }
+
+                        res += part(index);
+                    }
+
+                    if (pick_number(0, 20) == 0)
+                    {
+                        res += pick({ ",", ",,", "x", "-" });
+                    }
+                }
+
+                return res;
+            }
+
+            std::string part(int index)
+            {
+                std::string res;
+
+                switch (pick_number(0, 6))
+                {
+                    case 0:
+                        res = pick({ "*", "?", "", "-", "/2", "1-", "*/", "**", "1/2/3", "1-2-3", "+1", "x" });
+                        break;
+                    case 1:
+                        res = "*/" + number(index);
+                        break;
+                    case 2:
+                        res = value(index) + "/" + number(index);
+                        break;
+                    case 3:
+                    case 4:
+                        res = value(index) + "-" + value(index);
+                        break;
+                    default:
+                        res = value(index);
+                        break;
+                }
+
+                return res;
+            }
+
+            std::string value(int index)
+            {
+                std::string res;
+
+                if (index == 4 && pick_number(0, 1) == 0)
+                {
+                    res = name({ "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" });
+                }
+                else if (index == 5 && pick_number(0, 1) == 0)
+                {
+                    res = name({ "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" });
+                }
+                else
+                {
+                    res = number(index);
+                }
+
+                return res;
+            }
+
+            std::string number(int index)
+            {
+                // Keep within the limits of the fields, with some margin for out-of-range values.
+                // Steps above 196 are excluded since the legacy parser overflows its uint8_t accumulator on those.
+                const int limits[] = { 62, 62, 26, 33, 14, 8 };
+                auto n = std::to_string(pick_number(0, limits[index]));
+
+                return pick_number(0, 15) == 0 ? "0" + n : n;
+            }
+
+            std::string name(const std::vector<std::string>& names)
+            {
+                auto res = names[static_cast<size_t>(pick_number(0, static_cast<int>(names.size()) - 1))];
+
+                if (pick_number(0, 3) == 0)
+                {
+                    for (auto& c : res)
+                    {
+                        c = static_cast<char>(std::tolower(c));
+                    }
+                }
+
+                if (pick_number(0, 30) == 0)
+                {
+                    // Names are replaced wherever they are found, so concatenations form numbers.
+                    res += names[0];
+                }
+
+                return res;
+            }
+
+            std::string pick(const std::vector<std::string>& options)
+            {
+                return options[static_cast<size_t>(pick_number(0, static_cast<int>(options.size()) - 1))];
+            }
+
+            int pick_number(int low, int high)
+            {
+                return std::uniform_int_distribution<>(low, high)(twister);
+            }
+
+            std::mt19937 twister{ 4711 };
+    };
+}
+
+SCENARIO("Hand written parser agrees with the legacy regex parser")
+{
+    GIVEN("Hand picked expressions")
+    {
+        const std::vector<std::string> expressions{
+                "* * * * * ?", "0 0 12 * * MON-FRI", "0 0 12 1/2 * ?", "0 0 */12 ? * *", "0 0 10 ? FEB 6",
+                "* * 20-5 * * ?", "* * * ? APR-JAN *", "* * * ? * sat-tue,wed", "* * * * JAN/2 ?",
+                "0,3,40-50 * * * * ?", "0, 3, 40-50 * * * * ?", "0 0 * 30 FEB *", "0 0 * 31 APR *",
+                "0 0 * 31 APR,MAY ?", "0 0 * 29 FEB ?", "0 0 * 30,31 FEB,APR ?", "0 0 * 31 APR,JUN ?",
+                "", "-", "* ", "     ", "      ", "* * * * *", "* * * * * * *", "0 0 0 ? * ", "0  0 0 ? *",
+                "\t0 0 0 ? * *\n", "0 0\n0 ? * *", "0 0 0 ? * \n", "0 0 0 ? * MON\r", "\v0\f0\r0 ? * *",
+                "0,,1 0 0 ? * *", ",0 0 0 ? * *", "0, 0 0 ? * *", "0 0 0 ? * 1,", "0 0 0 ? * 1,,", "0 0 0 ? * ,",
+                "@hourly", "@hourly ?", "@daily ?", "@weekly ?", "@monthly ?", "@yearly ?", "@annually ?",
+                "0 @hourly", "@HOURLY ?", "@@hourly ?", "1@hourly ?", "0 0 0 ? JAN-FEBx *", "0 0 0 ? jan *",
+                "0 0 0 ? JANUARY *", "0 0 0 ? * MONTUE", "0 0 0 ? * SUNMON", "0 0 0 ? * 0/0", "0 0 0 ? * 00001",
+                "0 0 0 ? * +1", "0 0 0 ? * 1-", "0 0 0 ? * */1", "0 0 0 ? * 256", "0 0 0 ? OCT-DEC *",
+                "0 0 0 ? 1OCT *", "0 0 0 ? oCt/2 *", "0 0 0 ? * SAT-SUN", "0 0 0 ? * SATUE", "? ? ? ? ? ?",
+                "*/5 */5 */5 */5 */5 ?", "59/1 59-0 23-0 31-1 12-1 ?", "0-0 0-0 0-0 ? 1-1 *", "*/60 * * * * ?",
+                "*-5 * * * * ?", "?/2 * * * * ?", "5/* * * * * ?", "1-2/3 * * * * ?", "0 0 0 ? * JAN",
+                "0 0 0 ? MON *", "JAN * * * * ?", "0 0 0 ? * 0x1", "0 0 0 ? * 1e1"
+        };
+
+        THEN("Both parsers yield the same result")
+        {
+            for (const auto& e : expressions)
+            {
+                REQUIRE(same_as_legacy(e));
+            }
+        }
+    }
+    AND_GIVEN("Generated expressions")
+    {
+        ExpressionGenerator generator;
+        auto valid = 0;
+
+        THEN("Both parsers yield the same result")
+        {
+            for (auto i = 0; i < 5000; ++i)
+            {
+                auto e = generator.expression();
+                REQUIRE(same_as_legacy(e));
+                valid += CronData::create_uncached(e).is_valid() ? 1 : 0;
+            }
+
+            // Make sure the generated corpus exercises both outcomes.
+            INFO("Valid expressions: " << valid);
+            REQUIRE(valid > 250);
+            REQUIRE(valid < 4750);
+        }
+    }
+}
+
+SCENARIO("Numbers too large for an int")
+{
+    THEN("Values are invalid instead of throwing")
+    {
+        REQUIRE_FALSE(CronData::create_uncached("0 0 0 ? * 99999999999").is_valid());
+        REQUIRE_FALSE(CronData::create_uncached("0 0 0 ? * 1-99999999999").is_valid());
+    }
+    AND_THEN("A step larger than the range only yields the start value")
+    {
+        auto c = CronData::create_uncached("0 0 0 ? * */99999999999999999999");
+        REQUIRE(c.is_valid());
+        REQUIRE(c.get_day_of_week().size() == 1);
+    }
+}
@@ -1,6 +1,8 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 
 #include <catch.hpp>
+#include <atomic>
+#include <thread>
 #include <date/date.h>
 #include <libcron/include/libcron/Cron.h>
 #include <libcron/include/libcron/CronData.h>
@@ -10,7 +12,7 @@ using namespace date;
 using namespace std::chrono;
 
 template<typename T>
-bool has_value_range(const std::set<T>& set, uint8_t low, uint8_t high)
+bool has_value_range(const CronField<T>& set, uint8_t low, uint8_t high)
 {
     bool found = true;
     for (auto i = low; found && i <= high; ++i)
@@ -237,4 +239,176 @@ SCENARIO("Replacing text with numbers")
         std::string s = "JAN-DEC";
         REQUIRE(CronData::replace_string_name_with_numeric<libcron::Months>(s) == "1-12");
     }
-}
\ No newline at end of file
+}
+
+SCENARIO("Fields are stored as bitmasks")
+{
+    GIVEN("A schedule with sparse fields")
+    {
+        auto c = CronData::create("5,30,59 0-2,58 23 ? FEB,DEC SUN,SAT");
+        REQUIRE(c.is_valid());
+
+        THEN("Membership and next allowed value are answered from the mask")
+        {
+            REQUIRE(c.get_seconds().get_mask() == ((uint64_t{1} << 5) | (uint64_t{1} << 30) | (uint64_t{1} << 59)));
+            REQUIRE(c.get_seconds().next(0) == 5);
+            REQUIRE(c.get_seconds().next(6) == 30);
+            REQUIRE(c.get_seconds().next(59) == 59);
+            REQUIRE(c.get_seconds().next(60) == -1);
+            REQUIRE(c.get_minutes().next(3) == 58);
+            REQUIRE(c.get_hours().first() == 23);
+            REQUIRE(c.get_hours().last() == 23);
+            REQUIRE(c.get_months().next(3) == 12);
+            REQUIRE(c.get_day_of_week().next(1) == 6);
+            REQUIRE(c.get_day_of_month().size() == 31);
+        }
+        AND_THEN("Iteration visits the values in ascending order")
+        {
+            std::vector<int> seconds;
+            for (auto s : c.get_seconds())
+            {
+                seconds.push_back(CronData::value_of(s));
+            }
+
+            REQUIRE(seconds == std::vector<int>{5, 30, 59});
+        }
+        AND_THEN("The representation is compact")
+        {
+            REQUIRE(sizeof(CronData) <= 32);
+        }
+    }
+}
+
+namespace
+{
+    std::string expression_number(int i)
+    {
+        return std::to_string(i % 60) + " " + std::to_string((i / 60) % 60) + " " + std::to_string(i / 3600) + " ? * *";
+    }
+
+    bool same_fields(const CronData& a, const CronData& b)
+    {
+        return a.is_valid() == b.is_valid()
+               && a.get_seconds() == b.get_seconds()
+               && a.get_minutes() == b.get_minutes()
+               && a.get_hours() == b.get_hours()
+               && a.get_day_of_month() == b.get_day_of_month()
+               && a.get_months() == b.get_months()
+               && a.get_day_of_week() == b.get_day_of_week();
+    }
+}
+
+SCENARIO("Cache of parsed expressions")
+{
+    GIVEN("A cache with a small capacity")
+    {
+        CronData::set_cache_capacity(16);
+        auto before = CronData::get_cache_statistics();
+        REQUIRE(before.size == 0);
+        REQUIRE(before.capacity == 16);
+
+        WHEN("Creating the same expression twice")
+        {
+            auto first = CronData::create("0 0 12 * * MON-FRI");
+            auto second = CronData::create("0 0 12 * * MON-FRI");
+            auto after = CronData::get_cache_statistics();
+
+            THEN("The second one is served from the cache")
+            {
+                REQUIRE(same_fields(first, second));
+                REQUIRE(after.misses == before.misses + 1);
+                REQUIRE(after.hits == before.hits + 1);
+                REQUIRE(after.size == 1);
+            }
+        }
+        AND_WHEN("Creating more expressions than fit")
+        {
+            for (auto i = 0; i < 100; ++i)
+            {
+                REQUIRE(CronData::create(expression_number(i)).is_valid());
+            }
+
+            auto after = CronData::get_cache_statistics();
+
+            THEN("The cache stays within its capacity")
+            {
+                REQUIRE(after.size <= 16);
+                REQUIRE(after.evictions == before.evictions + 100 - after.size);
+            }
+        }
+        AND_WHEN("Creating expressions from several threads")
+        {
+            std::atomic<int> mismatches{ 0 };
+            std::vector<std::thread> threads;
+
+            for (auto t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&mismatches, t]()
+                                     {
+                                         for (auto i = 0; i < 2000; ++i)
+                                         {
+                                             auto e = expression_number((i * (t + 1)) % 64);
+
+                                             if (!same_fields(CronData::create(e), CronData::create_uncached(e)))
+                                             {
+                                                 ++mismatches;
+                                             }
+                                         }
+                                     });
+            }
+
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+
+            auto after = CronData::get_cache_statistics();
+
+            THEN("All results are correct and accounted for")
+            {
+                REQUIRE(mismatches == 0);
+                REQUIRE(after.hits + after.misses == before.hits + before.misses + 8000);
+                REQUIRE(after.size <= 16);
+            }
+        }
+
+        CronData::set_cache_capacity(CronData::DEFAULT_CACHE_CAPACITY);
+    }
+    AND_GIVEN("A cache with a capacity below the number of shards")
+    {
+        CronData::set_cache_capacity(4);
+        auto before = CronData::get_cache_statistics();
+        REQUIRE(before.capacity == 4);
+
+        WHEN("Creating each of many expressions twice in a row")
+        {
+            for (auto i = 0; i < 40; ++i)
+            {
+                REQUIRE(CronData::create(expression_number(i)).is_valid());
+                REQUIRE(CronData::create(expression_number(i)).is_valid());
+            }
+
+            auto after = CronData::get_cache_statistics();
+
+            THEN("Every expression is cached, whatever its hash")
+            {
+                REQUIRE(after.hits == before.hits + 40);
+                REQUIRE(after.size <= 4);
+            }
+        }
+
+        CronData::set_cache_capacity(CronData::DEFAULT_CACHE_CAPACITY);
+    }
+    AND_GIVEN("A disabled cache")
+    {
+        CronData::set_cache_capacity(0);
+
+        THEN("Nothing is cached")
+        {
+            REQUIRE(CronData::create("0 0 12 * * MON-FRI").is_valid());
+            REQUIRE(CronData::get_cache_statistics().size == 0);
+        }
+
+        CronData::set_cache_capacity(CronData::DEFAULT_CACHE_CAPACITY);
+    }
+}
@@ -3,6 +3,8 @@
 #include <date/date.h>
 #include <libcron/include/libcron/Cron.h>
 #include <iostream>
+#include <random>
+#include "LegacyCronSchedule.h"
 
 using namespace libcron;
 using namespace date;
@@ -222,3 +224,274 @@ SCENARIO("Unable to calculate time point")
 {
     REQUIRE_FALSE(test( "0 0 * 31 FEB *", DT(2021_y / 1 / 1), DT(2022_y / 1 / 1)));
 }
+
+SCENARIO("Sparse expressions")
+{
+    THEN("Gaps of several years are found")
+    {
+        REQUIRE(test("0 0 0 29 2 ?", DT(2097_y / 3 / 1), DT(2104_y / 2 / 29)));
+        REQUIRE(test("59 59 23 31 12 ?", DT(2020_y / 12 / 31, hours{23}, minutes{59}, seconds{59}) + seconds{1},
+                     DT(2021_y / 12 / 31, hours{23}, minutes{59}, seconds{59})));
+        REQUIRE(test("59 59 23 ? 2 SAT", DT(2021_y / 3 / 1), DT(2022_y / 2 / 5, hours{23}, minutes{59}, seconds{59})));
+    }
+    AND_THEN("Fractions of seconds are discarded")
+    {
+        REQUIRE(test("* * * * * ?", DT(2021_y / 1 / 1) + milliseconds{999}, DT(2021_y / 1 / 1)));
+    }
+}
+
+namespace
+{
+    std::string random_field(std::mt19937& twister, int first, int last)
+    {
+        auto number = [&twister](int low, int high)
+                      {
+                          return std::uniform_int_distribution<>(low, high)(twister);
+                      };
+
+        std::string res;
+
+        switch (number(0, 4))
+        {
+            case 0:
+                res = "*";
+                break;
+            case 1:
+                res = std::to_string(number(first, last));
+                break;
+            case 2:
+                res = std::to_string(number(first, last)) + "-" + std::to_string(number(first, last));
+                break;
+            case 3:
+                res = std::to_string(number(first, last)) + "/" + std::to_string(number(1, last));
+                break;
+            default:
+                res = std::to_string(number(first, last)) + "," + std::to_string(number(first, last));
+                break;
+        }
+
+        return res;
+    }
+}
+
+SCENARIO("Closed-form search agrees with the iterative search")
+{
+    std::mt19937 twister{ 4711 };
+    auto compared = 0;
+
+    for (auto i = 0; i < 3000; ++i)
+    {
+        auto use_dow = twister() % 2 == 0;
+        auto expression = random_field(twister, 0, 59) + " "
+                          + random_field(twister, 0, 59) + " "
+                          + random_field(twister, 0, 23) + " "
+                          + (use_dow ? "?" : random_field(twister, 1, 31)) + " "
+                          + random_field(twister, 1, 12) + " "
+                          + (use_dow ? random_field(twister, 0, 6) : "?");
+
+        auto c = CronData::create_uncached(expression);
+
+        if (c.is_valid())
+        {
+            // Random points in time between 1970 and 2100, with fractions of seconds.
+            auto from = system_clock::time_point{
+                    milliseconds{ std::uniform_int_distribution<int64_t>(0, 4102444800000)(twister) } };
+
+            auto legacy = LegacyCronSchedule(c).calculate_from(from);
+            auto closed_form = CronSchedule(c).calculate_from(from);
+
+            // The iterative search gives up after a limited number of steps; only compare the results it finds.
+            if (std::get<0>(legacy))
+            {
+                INFO(expression << " from " << duration_cast<milliseconds>(from.time_since_epoch()).count() << " ms");
+                REQUIRE(std::get<0>(closed_form));
+                REQUIRE((std::get<1>(closed_form) == std::get<1>(legacy)));
+                ++compared;
+            }
+        }
+    }
+
+    INFO("Compared: " << compared);
+    REQUIRE(compared > 1000);
+}
+
+bool test_previous(const std::string& schedule, system_clock::time_point to, system_clock::time_point expected)
+{
+    auto c = CronData::create(schedule);
+    bool res = c.is_valid();
+
+    if (res)
+    {
+        CronSchedule sched(c);
+        auto result = sched.calculate_previous(to);
+        auto calculated = std::get<1>(result);
+        res = std::get<0>(result) && calculated == expected;
+
+        if (!res)
+        {
+            std::cout
+                    << "To:         " << to << "\n"
+                    << "Expected:   " << expected << "\n"
+                    << "Calculated: " << calculated;
+        }
+    }
+
+    return res;
+}
+
+SCENARIO("Calculating previous runtime")
+{
+    REQUIRE(test_previous("0 0 * * * ?", DT(2010_y / 1 / 1, hours{5}), DT(2010_y / 1 / 1, hours{5})));
+    REQUIRE(test_previous("0 0 * * * ?", DT(2010_y / 1 / 1, hours{5}) - seconds{1}, DT(2010_y / 1 / 1, hours{4})));
+    REQUIRE(test_previous("0 0 * * * ?", DT(2010_y / 1 / 1, hours{0}, minutes{30}), DT(2010_y / 1 / 1)));
+    REQUIRE(test_previous("0 0 * * * ?", DT(2010_y / 1 / 1) - milliseconds{1}, DT(2009_y / 12 / 31, hours{23})));
+    REQUIRE(test_previous("0 0 10 * * ?", DT(2018_y / 1 / 1, hours{9}), DT(2017_y / 12 / 31, hours{10})));
+    REQUIRE(test_previous("0 0/15 0/2 * * ?", DT(2018_y / 1 / 1, hours{15}, minutes{14}, seconds{59}),
+                          DT(2018_y / 1 / 1, hours{14}, minutes{45})));
+    REQUIRE(test_previous("0 0 12 * * MON-FRI", DT(2018_y / 3 / 12, hours{11}), DT(2018_y / 3 / 9, hours{12})));
+    REQUIRE(test_previous("0 0 * 31 APR,MAY ?", DT(2018_y / 5 / 30), DT(2017_y / 5 / 31, hours{23})));
+    REQUIRE(test_previous("* * * * * ?", DT(2021_y / 1 / 1) + milliseconds{999}, DT(2021_y / 1 / 1)));
+
+    THEN("Sparse expressions are found")
+    {
+        REQUIRE(test_previous("0 0 0 29 2 ?", DT(2104_y / 2 / 28), DT(2096_y / 2 / 29)));
+        REQUIRE(test_previous("59 59 23 31 12 ?", DT(2021_y / 12 / 31, hours{23}, minutes{59}, seconds{58}),
+                              DT(2020_y / 12 / 31, hours{23}, minutes{59}, seconds{59})));
+        REQUIRE(test_previous("0 0 0 ? 2 SAT", DT(2022_y / 2 / 4), DT(2021_y / 2 / 27)));
+    }
+}
+
+SCENARIO("Previous and next runtimes are consistent")
+{
+    std::mt19937 twister{ 1701 };
+    auto compared = 0;
+
+    for (auto i = 0; i < 3000; ++i)
+    {
+        auto use_dow = twister() % 2 == 0;
+        auto expression = random_field(twister, 0, 59) + " "
+                          + random_field(twister, 0, 59) + " "
+                          + random_field(twister, 0, 23) + " "
+                          + (use_dow ? "?" : random_field(twister, 1, 31)) + " "
+                          + random_field(twister, 1, 12) + " "
+                          + (use_dow ? random_field(twister, 0, 6) : "?");
+
+        auto c = CronData::create_uncached(expression);
+
+        if (c.is_valid())
+        {
+            auto to = system_clock::time_point{
+                    milliseconds{ std::uniform_int_distribution<int64_t>(0, 4102444800000)(twister) } };
+
+            CronSchedule sched(c);
+            auto previous = sched.calculate_previous(to);
+
+            if (std::get<0>(previous))
+            {
+                INFO(expression << " to " << duration_cast<milliseconds>(to.time_since_epoch()).count() << " ms");
+
+                // The previous runtime is a runtime, and there is none between it and 'to'.
+                auto at_previous = sched.calculate_from(std::get<1>(previous));
+                auto after_previous = sched.calculate_from(std::get<1>(previous) + seconds{1});
+                REQUIRE((std::get<1>(previous) <= to));
+                REQUIRE((std::get<1>(at_previous) == std::get<1>(previous)));
+                REQUIRE((std::get<1>(after_previous) > to));
+                ++compared;
+            }
+        }
+    }
+
+    INFO("Compared: " << compared);
+    REQUIRE(compared > 1000);
+}
+
+SCENARIO("Iterating occurrences")
+{
+    GIVEN("A schedule")
+    {
+        auto expression = GENERATE(as<std::string>{}, "* * * * * ?", "0 0/15 0/2 * * ?", "0 0 12 * * MON-FRI",
+                                   "59 59 23 ? 2 SAT", "0 0 0 29 2 ?");
+        auto c = CronData::create(expression);
+        CronSchedule sched(c);
+        auto from = DT(2018_y / 1 / 1, hours{13}, minutes{14}, seconds{59}) + milliseconds{500};
+
+        THEN("The occurrences are the same as repeated calculations")
+        {
+            INFO(expression);
+            auto expected = from;
+            auto count = 0;
+
+            for (auto t : sched.occurrences(from))
+            {
+                auto result = sched.calculate_from(expected);
+                REQUIRE(std::get<0>(result));
+                REQUIRE((t == std::get<1>(result)));
+                expected = t + seconds{1};
+
+                // Stay well within the range of system_clock::time_point, which ends in 2262 on some platforms
+                if (++count == 50)
+                {
+                    break;
+                }
+            }
+
+            REQUIRE(count == 50);
+        }
+#if defined(__cpp_lib_ranges)
+        AND_THEN("The occurrences compose with ranges")
+        {
+            auto first = sched.calculate_from(from);
+            auto taken = sched.occurrences(from) | std::views::take(3);
+            auto it = std::ranges::begin(taken);
+            REQUIRE((*it == std::get<1>(first)));
+            REQUIRE(std::ranges::distance(taken) == 3);
+        }
+#endif
+    }
+}
+
+SCENARIO("Sharing schedules")
+{
+    GIVEN("Shared schedules")
+    {
+        auto schedule = [](const std::string& expression)
+                        {
+                            auto data = CronData::create(expression);
+                            return CronSchedule{ data };
+                        };
+
+        SharedSchedules shared;
+        auto every_minute = shared.get(schedule("@hourly ?"));
+
+        THEN("Expressions allowing the same time points share a schedule")
+        {
+            REQUIRE(shared.get(schedule("0 * * * * ?")) == every_minute);
+            REQUIRE(shared.get(schedule("0 0-59 * * * ?")) == every_minute);
+            REQUIRE(shared.get(schedule("0 */2 * * * ?")) != every_minute);
+            REQUIRE(shared.size() == 2);
+        }
+        AND_THEN("Calculating from the same time point gives the same result as the schedule")
+        {
+            auto from = DT(2021_y / 1 / 1, hours{10}, minutes{30});
+            auto expected = every_minute->get_schedule().calculate_from(from);
+
+            REQUIRE((every_minute->calculate_from(from) == expected));
+            REQUIRE((every_minute->calculate_from(from) == expected));
+            REQUIRE((std::get<1>(every_minute->calculate_from(from + minutes{1})) == std::get<1>(expected) + minutes{1}));
+        }
+        AND_THEN("Schedules no longer used are dropped")
+        {
+            every_minute.reset();
+
+            for (auto s = 0; s < 60; ++s)
+            {
+                for (auto m = 0; m < 2; ++m)
+                {
+                    shared.get(schedule(std::to_string(s) + " " + std::to_string(m) + " * * * ?"));
+                }
+            }
+
+            REQUIRE(shared.size() < 120);
+        }
+    }
+}
@@ -1,8 +1,20 @@
 #include <catch.hpp>
 #include <libcron/include/libcron/Cron.h>
+#include <libcron/include/libcron/TimerFd.h>
 #include <libcron/externals/date/include/date/date.h>
+#include <atomic>
+#include <condition_variable>
 #include <thread>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
 
 using namespace libcron;
 using namespace std::chrono;
@@ -444,7 +456,1931 @@ SCENARIO("Tasks can be added and removed from the scheduler")
             {
                 c.remove_schedule("Task-5");
                 REQUIRE(c.count() == 4);
+                REQUIRE(c.has_schedule("Task-4"));
+                REQUIRE_FALSE(c.has_schedule("Task-5"));
+            }
+        }
+    }
+}
+
+SCENARIO("Updating the schedule of a task")
+{
+    GIVEN("A Cron instance with a task running at the start of each hour")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10} + minutes{15} + seconds{30});
+        int runs = 0;
+
+        REQUIRE(c.add_schedule("Task", "0 0 * * * ?", [&runs](auto&)
+        {
+            runs++;
+        }));
+        REQUIRE(c.has_schedule("Task"));
+        REQUIRE(c.time_until_next() == minutes{44} + seconds{30});
+
+        WHEN("Updating it to run every minute")
+        {
+            REQUIRE(c.update_schedule("Task", "0 * * * * ?"));
+
+            THEN("It keeps its work and runs at the new schedule")
+            {
+                REQUIRE(c.count() == 1);
+                REQUIRE(c.time_until_next() == seconds{30});
+                c.tick();
+                c.get_clock().add(seconds{30});
+                REQUIRE(c.tick() == 1);
+                REQUIRE(runs == 1);
+            }
+        }
+        AND_WHEN("Updating it with an invalid schedule")
+        {
+            REQUIRE_FALSE(c.update_schedule("Task", "not a schedule"));
+
+            THEN("The old schedule is kept")
+            {
+                REQUIRE(c.time_until_next() == minutes{44} + seconds{30});
+            }
+        }
+        AND_WHEN("Updating a task that does not exist")
+        {
+            REQUIRE_FALSE(c.update_schedule("Other", "0 * * * * ?"));
+
+            THEN("No task is added")
+            {
+                REQUIRE(c.count() == 1);
+                REQUIRE_FALSE(c.has_schedule("Other"));
+            }
+        }
+    }
+}
+
+template<template<typename> class QueueType>
+void behaves_like_the_sorted_queue()
+{
+    GIVEN("Two Cron instances with the same tasks, one of them using the sorted queue")
+    {
+        Cron<TestClock> sorted{};
+        Cron<TestClock, NullLock, QueueType> other{};
+
+        auto start = sys_days{2018_y / 12 / 31} + hours{22};
+        sorted.get_clock().set(start);
+        other.get_clock().set(start);
+
+        std::vector<std::string> expressions{ "* * * * * ?", "*/7 * * * * ?", "0 * * * * ?", "30 */5 * * * ?",
+                                              "0 0 * * * ?", "15 30 */2 * * ?", "0 0 0 * * ?", "0 0 12 ? * MON-FRI",
+                                              "0 0 0 1 * ?", "0 0 0 1 1 ?", "0 0 0 29 2 ?", "59 59 23 31 12 ?" };
+
+        std::map<std::string, int> sorted_runs;
+        std::map<std::string, int> other_runs;
+        // The handles of the last task added with each name
+        std::map<std::string, std::pair<TaskHandle, TaskHandle>> handles;
+
+        auto add = [&](const std::string& name, const std::string& expression)
+                   {
+                       auto& h = handles[name];
+                       h.first = sorted.add_schedule_handle(name, expression, [&sorted_runs](auto& i)
+                       {
+                           sorted_runs[std::string{ i.get_name() }]++;
+                       });
+                       h.second = other.add_schedule_handle(name, expression, [&other_runs](auto& i)
+                       {
+                           other_runs[std::string{ i.get_name() }]++;
+                       });
+                       REQUIRE(h.first);
+                       REQUIRE(h.second);
+
+                       auto tag = name.back() % 2 == 0 ? "even" : "odd";
+                       REQUIRE(sorted.tag_schedule(h.first, tag));
+                       REQUIRE(other.tag_schedule(h.second, tag));
+                   };
+
+        for (size_t i = 0; i < expressions.size() * 3; ++i)
+        {
+            add(std::to_string(i), expressions[i % expressions.size()]);
+        }
+
+        WHEN("Time passes, with clock changes and tasks being removed, added and updated")
+        {
+            std::mt19937 twister{ 4711 };
+
+            for (auto i = 0; i < 20000; ++i)
+            {
+                system_clock::duration step = seconds{1};
+
+                switch (twister() % 200)
+                {
+                    case 0:
+                        step = minutes{ twister() % 120 };
+                        break;
+                    case 1:
+                        step = -minutes{ twister() % 120 };
+                        break;
+                    case 2:
+                        step = hours{ 3 + twister() % 24 * 20 };
+                        break;
+                    case 3:
+                        step = -hours{ 3 + twister() % 24 };
+                        break;
+                    case 4:
+                    {
+                        auto name = std::to_string(twister() % (expressions.size() * 4));
+                        sorted.remove_schedule(name);
+                        other.remove_schedule(name);
+                        break;
+                    }
+                    case 5:
+                    {
+                        auto n = twister() % (expressions.size() * 4);
+                        add(std::to_string(n), expressions[n % expressions.size()]);
+                        break;
+                    }
+                    case 6:
+                    {
+                        auto name = std::to_string(twister() % (expressions.size() * 4));
+                        const auto& expression = expressions[twister() % expressions.size()];
+                        REQUIRE(sorted.has_schedule(name) == other.has_schedule(name));
+                        REQUIRE(sorted.update_schedule(name, expression) == other.update_schedule(name, expression));
+                        break;
+                    }
+                    case 7:
+                    case 8:
+                    case 9:
+                    {
+                        auto& h = handles[std::to_string(twister() % (expressions.size() * 4))];
+                        auto kind = twister() % 3;
+
+                        if (kind == 0)
+                        {
+                            REQUIRE(sorted.pause_schedule(h.first) == other.pause_schedule(h.second));
+                        }
+                        else if (kind == 1)
+                        {
+                            REQUIRE(sorted.resume_schedule(h.first) == other.resume_schedule(h.second));
+                        }
+                        else
+                        {
+                            REQUIRE(sorted.remove_schedule(h.first) == other.remove_schedule(h.second));
+                        }
+                        break;
+                    }
+                    case 10:
+                    {
+                        auto tag = twister() % 2 == 0 ? "even" : "odd";
+                        REQUIRE(sorted.pause_tagged(tag) == other.pause_tagged(tag));
+                        break;
+                    }
+                    case 11:
+                    {
+                        auto tag = twister() % 2 == 0 ? "even" : "odd";
+                        REQUIRE(sorted.resume_tagged(tag) == other.resume_tagged(tag));
+                        break;
+                    }
+                    default:
+                        step = milliseconds{ 500 + twister() % 1000 };
+                        break;
+                }
+
+                sorted.get_clock().add(step);
+                other.get_clock().add(step);
+
+                INFO("Iteration " << i);
+                REQUIRE(sorted.tick() == other.tick());
+                REQUIRE(sorted.count() == other.count());
+                REQUIRE(sorted.time_until_next() == other.time_until_next());
+            }
+
+            THEN("The same tasks have been run")
+            {
+                REQUIRE(sorted_runs == other_runs);
+            }
+        }
+    }
+}
+
+SCENARIO("Heap queue behaves like the sorted queue")
+{
+    behaves_like_the_sorted_queue<HeapTaskQueue>();
+}
+
+SCENARIO("Timing wheel queue behaves like the sorted queue")
+{
+    behaves_like_the_sorted_queue<TimingWheelQueue>();
+}
+
+template<template<typename> class QueueType>
+void handles_refer_to_tasks()
+{
+    GIVEN("A Cron instance with two tasks with the same name, running every second")
+    {
+        Cron<TestClock, NullLock, QueueType> c;
+        auto start = sys_days{2021_y / 1 / 1} + hours{10};
+        c.get_clock().set(start);
+        int first_runs = 0;
+        int second_runs = 0;
+
+        auto first = c.add_schedule_handle("Task", "* * * * * ?", [&first_runs](auto&)
+        {
+            first_runs++;
+        });
+        auto second = c.add_schedule_handle("Task", "* * * * * ?", [&second_runs](auto&)
+        {
+            second_runs++;
+        });
+
+        REQUIRE(first);
+        REQUIRE(second);
+        REQUIRE(first != second);
+        REQUIRE_FALSE(c.add_schedule("Invalid", "not a schedule", [](auto&)
+        {
+        }));
+        REQUIRE_FALSE(c.has_schedule(TaskHandle{}));
+
+        // Both run on each tick, starting with the first.
+        REQUIRE(c.tick() == 2);
+        c.get_clock().add(seconds{1});
+        REQUIRE(c.tick() == 2);
+
+        THEN("The status of each task is available through its handle")
+        {
+            auto status = c.get_status(first);
+            REQUIRE(status.has_value());
+            REQUIRE_FALSE(status->paused);
+            REQUIRE(status->fire_count == 2);
+            REQUIRE((status->last_run == start + seconds{1}));
+            REQUIRE((status->next == start + seconds{2}));
+        }
+        AND_WHEN("Removing one of them through its handle")
+        {
+            REQUIRE(c.remove_schedule(first));
+
+            THEN("Only that task is removed, and its handle no longer refers to a task")
+            {
+                REQUIRE(c.count() == 1);
+                REQUIRE_FALSE(c.has_schedule(first));
+                REQUIRE(c.has_schedule(second));
+                REQUIRE_FALSE(c.get_status(first).has_value());
+                REQUIRE_FALSE(c.remove_schedule(first));
+                REQUIRE_FALSE(c.pause_schedule(first));
+                REQUIRE_FALSE(c.update_schedule(first, "0 * * * * ?"));
+
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 1);
+                REQUIRE(first_runs == 2);
+                REQUIRE(second_runs == 3);
+            }
+            AND_THEN("A task reusing its place gets a different handle")
+            {
+                auto third = c.add_schedule_handle("Task", "* * * * * ?", [](auto&)
+                {
+                });
+
+                REQUIRE(third.get_index() == first.get_index());
+                REQUIRE(third != first);
+                REQUIRE(c.has_schedule(third));
+                REQUIRE_FALSE(c.has_schedule(first));
+                REQUIRE_FALSE(c.remove_schedule(first));
+                REQUIRE(c.count() == 2);
+            }
+        }
+        AND_WHEN("Pausing one of them")
+        {
+            REQUIRE(c.pause_schedule(first));
+            REQUIRE_FALSE(c.pause_schedule(first));
+
+            for (auto i = 0; i < 10; ++i)
+            {
+                c.get_clock().add(seconds{1});
+                c.tick();
+            }
+
+            THEN("It is kept, but does not run until resumed")
+            {
+                REQUIRE(c.count() == 2);
+                REQUIRE(c.get_status(first)->paused);
+                REQUIRE(first_runs == 2);
+                REQUIRE(second_runs == 12);
+
+                REQUIRE(c.resume_schedule(first));
+                REQUIRE_FALSE(c.resume_schedule(first));
+                REQUIRE_FALSE(c.get_status(first)->paused);
+                REQUIRE((c.get_status(first)->next == c.get_clock().now()));
+
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 2);
+                REQUIRE(first_runs == 3);
+            }
+            AND_THEN("Only the other task determines when to tick next")
+            {
+                REQUIRE(c.remove_schedule(second));
+                REQUIRE(c.count() == 1);
+                REQUIRE(c.time_until_next() == std::numeric_limits<std::chrono::minutes>::max());
+            }
+        }
+        AND_WHEN("Updating the schedule of one of them through its handle")
+        {
+            REQUIRE(c.update_schedule(second, "0 * * * * ?"));
+
+            THEN("Only that task is rescheduled")
+            {
+                REQUIRE((c.get_status(first)->next == start + seconds{2}));
+                REQUIRE((c.get_status(second)->next == start + minutes{1}));
+            }
+        }
+        AND_WHEN("Clearing the schedules")
+        {
+            c.clear_schedules();
+
+            THEN("The handles no longer refer to tasks")
+            {
+                REQUIRE_FALSE(c.has_schedule(first));
+                REQUIRE_FALSE(c.has_schedule(second));
+            }
+        }
+    }
+}
+
+SCENARIO("Task handles")
+{
+    handles_refer_to_tasks<TaskQueue>();
+}
+
+SCENARIO("Task handles with the heap queue")
+{
+    handles_refer_to_tasks<HeapTaskQueue>();
+}
+
+SCENARIO("Task handles with the timing wheel queue")
+{
+    handles_refer_to_tasks<TimingWheelQueue>();
+}
+
+SCENARIO("Handing out task handles")
+{
+    GIVEN("The handles of a Cron instance")
+    {
+        TaskHandles handles;
+
+        WHEN("Releasing a handle")
+        {
+            auto first = handles.allocate();
+            auto second = handles.allocate();
+            handles.release(first);
+            auto third = handles.allocate();
+
+            THEN("Its index is reused with a new generation")
+            {
+                REQUIRE(first);
+                REQUIRE(first.get_index() != second.get_index());
+                REQUIRE(third.get_index() == first.get_index());
+                REQUIRE(third != first);
+            }
+        }
+
+        AND_WHEN("Allocating and releasing handles from several threads")
+        {
+            constexpr uint32_t most = 4 * 16;
+            std::vector<std::atomic<bool>> owned(most);
+            std::atomic<bool> failed{ false };
+            std::vector<std::thread> threads;
+
+            for (auto i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([&handles, &owned, &failed, i]()
+                                     {
+                                         std::mt19937 twister(static_cast<uint32_t>(i));
+                                         std::vector<TaskHandle> held;
+
+                                         for (auto n = 0; n < 20000; ++n)
+                                         {
+                                             if (held.size() < 16 && (held.empty() || twister() % 2 == 0))
+                                             {
+                                                 auto h = handles.allocate();
+
+                                                 // No other thread holds the index.
+                                                 if (h.get_index() >= most || owned[h.get_index()].exchange(true))
+                                                 {
+                                                     failed = true;
+                                                     return;
+                                                 }
+
+                                                 held.push_back(h);
+                                             }
+                                             else
+                                             {
+                                                 auto pos = twister() % held.size();
+                                                 owned[held[pos].get_index()] = false;
+                                                 handles.release(held[pos]);
+                                                 held.erase(held.begin() + static_cast<std::ptrdiff_t>(pos));
+                                             }
+                                         }
+                                     });
+            }
+
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+
+            THEN("No index is handed out twice, and released ones are reused")
+            {
+                REQUIRE_FALSE(failed);
+            }
+        }
+    }
+}
+
+template<template<typename> class QueueType>
+void pauses_tasks_by_tag()
+{
+    GIVEN("A Cron instance with tasks running every second, some of them tagged")
+    {
+        Cron<TestClock, NullLock, QueueType> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+        std::map<std::string, int> runs;
+        std::vector<TaskHandle> tagged;
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            auto name = std::to_string(i);
+            // Different schedules all expiring each second, so that resumed tasks are merged with the others.
+            auto handle = c.add_schedule_handle(name, i % 2 == 0 ? "* * * * * ?" : "*/1 * * * * ?", [&runs](auto& info)
+            {
+                runs[std::string{ info.get_name() }]++;
+            });
+
+            if (i % 3 == 0)
+            {
+                REQUIRE(c.tag_schedule(handle, "maintenance"));
+                tagged.push_back(handle);
+            }
+        }
+
+        REQUIRE_FALSE(c.tag_schedule(TaskHandle{}, "maintenance"));
+        REQUIRE(c.tick() == 100);
+
+        WHEN("Pausing the tagged tasks")
+        {
+            REQUIRE(c.pause_tagged("maintenance") == 34);
+            REQUIRE(c.pause_tagged("maintenance") == 0);
+            REQUIRE(c.pause_tagged("unknown") == 0);
+
+            for (auto i = 0; i < 5; ++i)
+            {
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 66);
+            }
+
+            THEN("They are kept, but do not run until resumed")
+            {
+                REQUIRE(c.count() == 100);
+                REQUIRE(runs["0"] == 1);
+                REQUIRE(runs["1"] == 6);
+                REQUIRE(c.get_status(tagged.front())->paused);
+
+                REQUIRE(c.resume_tagged("maintenance") == 34);
+                REQUIRE(c.resume_tagged("maintenance") == 0);
+
+                for (auto i = 0; i < 5; ++i)
+                {
+                    c.get_clock().add(seconds{1});
+                    REQUIRE(c.tick() == 100);
+                }
+
+                REQUIRE(runs["0"] == 6);
+                REQUIRE(runs["1"] == 11);
+            }
+            AND_THEN("Removed tasks are no longer paused or resumed with the tag")
+            {
+                REQUIRE(c.remove_schedule(tagged[0]));
+                c.remove_schedule("3");
+                REQUIRE(c.resume_tagged("maintenance") == 32);
+                REQUIRE(c.count() == 98);
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 98);
+            }
+        }
+    }
+}
+
+SCENARIO("Pausing tasks by tag")
+{
+    pauses_tasks_by_tag<TaskQueue>();
+}
+
+SCENARIO("Pausing tasks by tag with the heap queue")
+{
+    pauses_tasks_by_tag<HeapTaskQueue>();
+}
+
+SCENARIO("Pausing tasks by tag with the timing wheel queue")
+{
+    pauses_tasks_by_tag<TimingWheelQueue>();
+}
+
+SCENARIO("Tags of removed tasks")
+{
+    GIVEN("Tags each used by a single task, which is removed before the next one is tagged")
+    {
+        TaskTags tags;
+        TaskHandle live{};
+        auto exists = [&live](TaskHandle h)
+                      {
+                          return h == live;
+                      };
+
+        WHEN("Adding ten thousand of them")
+        {
+            for (uint32_t i = 1; i <= 10000; ++i)
+            {
+                live = TaskHandle{ i, 1 };
+                tags.add("tenant-" + std::to_string(i), live, exists);
+            }
+
+            THEN("The tags of removed tasks are dropped")
+            {
+                REQUIRE(tags.size() <= 64);
+                REQUIRE(tags.find("tenant-10000", exists) != nullptr);
+                REQUIRE(tags.find("tenant-1", exists) == nullptr);
+            }
+        }
+    }
+}
+
+template<template<typename> class QueueType>
+void recovers_from_throwing_tasks()
+{
+    GIVEN("A Cron instance with a task that throws among other tasks")
+    {
+        Cron<TestClock, NullLock, QueueType> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+        std::map<std::string, int> runs;
+        auto throwing = true;
+
+        for (auto i = 0; i < 20; ++i)
+        {
+            if (i == 10)
+            {
+                // Added in between, so that there are tasks to expire both before and after it.
+                REQUIRE(c.add_schedule("Throwing", "* * * * * ?", [&runs, &throwing](auto& info)
+                {
+                    runs[std::string{ info.get_name() }]++;
+
+                    if (throwing)
+                    {
+                        throw std::runtime_error("Failed");
+                    }
+                }));
+            }
+
+            // Those running each minute are rescheduled past the others.
+            REQUIRE(c.add_schedule(std::to_string(i), i % 2 == 0 ? "* * * * * ?" : "0 * * * * ?", [&runs](auto& info)
+            {
+                runs[std::string{ info.get_name() }]++;
+            }));
+        }
+
+        WHEN("The task throws")
+        {
+            REQUIRE_THROWS_AS(c.tick(), std::runtime_error);
+            REQUIRE(runs["Throwing"] == 1);
+            throwing = false;
+
+            THEN("The tasks that did not run expire on the next tick")
+            {
+                c.get_clock().add(seconds{1});
+                c.tick();
+                REQUIRE(runs["Throwing"] == 2);
+
+                for (auto i = 0; i < 20; ++i)
+                {
+                    INFO("Task " << i);
+                    REQUIRE(runs[std::to_string(i)] >= 1);
+                    REQUIRE(runs[std::to_string(i)] <= (i % 2 == 0 ? 2 : 1));
+                }
+
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 11);
+                REQUIRE(c.time_until_next() == seconds{1});
+            }
+            AND_THEN("The tasks can be changed right away")
+            {
+                REQUIRE(c.add_schedule("New", "* * * * * ?", [](auto&)
+                {
+                }));
+                REQUIRE(c.count() == 22);
+                c.remove_schedule("2");
+                REQUIRE(c.count() == 21);
+                REQUIRE(c.update_schedule("4", "0 0 11 * * ?"));
+
+                c.get_clock().add(seconds{1});
+                c.tick();
+
+                for (auto i = 0; i < 3; ++i)
+                {
+                    c.get_clock().add(seconds{1});
+                    REQUIRE(c.tick() == 10);
+                }
+
+                REQUIRE(runs["Throwing"] == 5);
             }
         }
     }
 }
+
+SCENARIO("Tasks that throw")
+{
+    recovers_from_throwing_tasks<TaskQueue>();
+}
+
+SCENARIO("Tasks that throw with the heap queue")
+{
+    recovers_from_throwing_tasks<HeapTaskQueue>();
+}
+
+SCENARIO("Tasks that throw with the timing wheel queue")
+{
+    recovers_from_throwing_tasks<TimingWheelQueue>();
+}
+
+SCENARIO("Task metrics")
+{
+    GIVEN("A Cron instance with a task running every second and one running every minute")
+    {
+        Cron<TestClock, NullLock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10} + seconds{1});
+        auto every_second = c.add_schedule_handle("Every second", "* * * * * ?", [](auto&)
+        {
+        });
+        auto every_minute = c.add_schedule_handle("Every minute", "0 * * * * ?", [](auto&)
+        {
+        });
+
+        THEN("Tasks that have not run have empty metrics")
+        {
+            REQUIRE(c.get_metrics(every_minute)->tasks == 1);
+            REQUIRE(c.get_metrics(every_minute)->runs == 0);
+            REQUIRE_FALSE(c.get_metrics(TaskHandle{}));
+        }
+
+        WHEN("Ticking a quarter of a second late, then only after several seconds")
+        {
+            c.get_clock().add(milliseconds{250});
+            REQUIRE(c.tick() == 1);
+            c.get_clock().add(seconds{5});
+            REQUIRE(c.tick() == 1);
+
+            THEN("The runs, their delays and the missed occurrences are counted")
+            {
+                auto m = c.get_metrics(every_second);
+                REQUIRE(m->tasks == 1);
+                REQUIRE(m->runs == 2);
+                REQUIRE(m->skipped == 0);
+                REQUIRE(m->missed == 1);
+                REQUIRE(m->last_delay == milliseconds{4250});
+                REQUIRE(m->delays.total() == 2);
+                REQUIRE(m->delays.value_at_quantile(0.5) >= milliseconds{250});
+                REQUIRE(m->delays.value_at_quantile(0.5) < milliseconds{320});
+                REQUIRE(m->delays.value_at_quantile(1.0) >= milliseconds{4250});
+                REQUIRE(m->run_times.total() == 2);
+
+                auto all = c.get_metrics();
+                REQUIRE(all.tasks == 2);
+                REQUIRE(all.runs == 2);
+                REQUIRE(all.missed == 1);
+                REQUIRE(all.last_delay == milliseconds{4250});
+            }
+            AND_THEN("Tasks that are often late can be found")
+            {
+                std::vector<std::string> late;
+
+                c.for_each_metrics([&late](const Task& t, const TaskMetrics& m)
+                                   {
+                                       LatencyCounts delays;
+                                       delays.add(m.get_delays());
+
+                                       if (delays.value_at_quantile(0.99) > seconds{1})
+                                       {
+                                           late.push_back(t.get_name());
+                                       }
+                                   });
+
+                REQUIRE(late == std::vector<std::string>{ "Every second" });
+            }
+        }
+        AND_WHEN("Ticking on time")
+        {
+            REQUIRE(c.tick() == 1);
+
+            for (auto i = 0; i < 2; ++i)
+            {
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 1);
+            }
+
+            THEN("No occurrences are missed")
+            {
+                REQUIRE(c.get_metrics(every_second)->runs == 3);
+                REQUIRE(c.get_metrics(every_second)->missed == 0);
+                REQUIRE(c.get_metrics(every_second)->last_delay == microseconds{0});
+            }
+        }
+    }
+}
+
+namespace
+{
+    // Blocks the work of a task until opened.
+    class Gate
+    {
+        public:
+            void open()
+            {
+                std::lock_guard<std::mutex> lock(m);
+                is_open = true;
+                cv.notify_all();
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this]()
+                              {
+                                  return is_open;
+                              });
+            }
+
+        private:
+            std::mutex m{};
+            std::condition_variable cv{};
+            bool is_open = false;
+    };
+}
+
+SCENARIO("Running tasks on a thread pool")
+{
+    GIVEN("A Cron instance using a thread pool with two threads and a task running every second that blocks")
+    {
+        using PoolCron = Cron<TestClock, Locker, TaskQueue, ThreadPoolExecutor>;
+
+        auto overlap = GENERATE(Overlap::Skip, Overlap::Queue, Overlap::Concurrent);
+
+        PoolCron c;
+        c.get_executor().set_thread_count(2);
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + milliseconds{500});
+
+        Gate gate;
+        std::atomic<int> started{0};
+        std::atomic<int> running{0};
+        std::atomic<int> most_running{0};
+
+        auto handle = c.add_schedule_handle("Blocking", "* * * * * ?", [&](auto&)
+        {
+            started++;
+            auto now_running = ++running;
+            auto most = most_running.load();
+            while (now_running > most && !most_running.compare_exchange_weak(most, now_running))
+            {
+            }
+
+            gate.wait();
+            running--;
+        }, overlap);
+        REQUIRE(handle);
+
+        WHEN("The task expires again while its first run is blocked")
+        {
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == 1);
+
+            while (started == 0)
+            {
+                std::this_thread::yield();
+            }
+
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == 1);
+
+            if (overlap == Overlap::Concurrent)
+            {
+                while (started < 2)
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            gate.open();
+            c.get_executor().wait_until_idle();
+
+            THEN("The second run is handled according to the overlap policy")
+            {
+                switch (overlap)
+                {
+                    case Overlap::Skip:
+                        REQUIRE(started == 1);
+                        REQUIRE(c.get_executor().get_skipped() == 1);
+                        REQUIRE(c.get_metrics().skipped == 1);
+                        REQUIRE(c.get_metrics().runs == 1);
+                        // The skipped run is not counted as a run of the task.
+                        REQUIRE(c.get_status(handle)->fire_count == 1);
+                        REQUIRE(c.get_status(handle)->last_run == sys_days{2021_y / 1 / 1} + milliseconds{1500});
+                        break;
+                    case Overlap::Queue:
+                        REQUIRE(started == 2);
+                        REQUIRE(most_running == 1);
+                        REQUIRE(c.get_metrics().runs == 2);
+                        break;
+                    case Overlap::Concurrent:
+                        REQUIRE(started == 2);
+                        REQUIRE(most_running == 2);
+                        REQUIRE(c.get_metrics().runs == 2);
+                        break;
+                }
+            }
+        }
+    }
+
+    GIVEN("A thread pool whose number of threads is read on another thread")
+    {
+        ThreadPoolExecutor pool{ 1 };
+        std::atomic<bool> done{ false };
+        std::thread reader([&]()
+                           {
+                               while (!done)
+                               {
+                                   auto count = pool.get_thread_count();
+                                   (void)count;
+                               }
+                           });
+
+        WHEN("Changing the number of threads")
+        {
+            for (size_t i = 0; i < 100; ++i)
+            {
+                pool.set_thread_count(1 + i % 4);
+            }
+
+            done = true;
+            reader.join();
+
+            THEN("The last number is used")
+            {
+                REQUIRE(pool.get_thread_count() == 4);
+            }
+        }
+    }
+}
+
+SCENARIO("Delay of tasks running on a thread pool")
+{
+    GIVEN("A Cron instance using a thread pool with one thread")
+    {
+        Cron<TestClock, Locker, TaskQueue, ThreadPoolExecutor> c;
+        c.get_executor().set_thread_count(1);
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + milliseconds{500});
+
+        Gate gate;
+        std::atomic<bool> blocking_started{false};
+        system_clock::duration delay{};
+
+        REQUIRE(c.add_schedule("Blocking", "0 * * * * ?", [&](auto&)
+        {
+            blocking_started = true;
+            gate.wait();
+        }));
+        REQUIRE(c.add_schedule("Waiting", "0 * * * * ?", [&delay](auto& i)
+        {
+            delay = i.get_delay();
+        }));
+
+        WHEN("The tasks are dispatched half a second late and one has to wait for the other")
+        {
+            c.get_clock().add(minutes{1});
+            REQUIRE(c.tick() == 2);
+
+            while (!blocking_started)
+            {
+                std::this_thread::yield();
+            }
+
+            std::this_thread::sleep_for(milliseconds{200});
+            gate.open();
+            c.get_executor().wait_until_idle();
+
+            THEN("The delay includes both the lateness of the tick and the time spent waiting")
+            {
+                INFO(duration_cast<milliseconds>(delay).count());
+                REQUIRE(delay >= milliseconds{500} + milliseconds{200});
+                REQUIRE(c.get_metrics().delays.value_at_quantile(1.0) >= milliseconds{500} + milliseconds{200});
+                REQUIRE(c.get_metrics().run_times.value_at_quantile(1.0) >= milliseconds{200});
+            }
+        }
+    }
+}
+
+SCENARIO("Failing runs")
+{
+    GIVEN("A Cron instance with a task that throws, running on the ticking thread")
+    {
+        Cron<TestClock> c;
+        REQUIRE(c.add_schedule("Throwing", "* * * * * ?", [](auto&)
+        {
+            throw std::runtime_error("Failed");
+        }));
+
+        WHEN("The task runs")
+        {
+            REQUIRE_THROWS_AS(c.tick(), std::runtime_error);
+
+            THEN("The run is counted as failed")
+            {
+                REQUIRE(c.get_metrics().runs == 1);
+                REQUIRE(c.get_metrics().failed == 1);
+                REQUIRE(c.get_executor().get_totals().get_failed() == 1);
+            }
+        }
+    }
+
+    GIVEN("A Cron instance with a task that throws, running on a thread pool")
+    {
+        Cron<TestClock, Locker, TaskQueue, ThreadPoolExecutor> c;
+        c.get_executor().set_thread_count(1);
+        REQUIRE(c.add_schedule("Throwing", "* * * * * ?", [](auto&)
+        {
+            throw std::runtime_error("Failed");
+        }));
+
+        WHEN("The task runs twice")
+        {
+            REQUIRE(c.tick() == 1);
+            c.get_executor().wait_until_idle();
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == 1);
+            c.get_executor().wait_until_idle();
+
+            THEN("The exceptions are caught, and the runs counted as failed")
+            {
+                REQUIRE(c.get_metrics().runs == 2);
+                REQUIRE(c.get_metrics().failed == 2);
+                REQUIRE(c.get_executor().get_totals().get_failed() == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Limiting the runs pending on a thread pool")
+{
+    GIVEN("A thread pool allowing a single pending run and a task running concurrently with itself")
+    {
+        Cron<TestClock, Locker, TaskQueue, ThreadPoolExecutor> c;
+        c.get_executor().set_thread_count(1);
+        c.get_executor().set_max_pending(1);
+
+        Gate gate;
+        std::atomic<int> started{0};
+
+        REQUIRE(c.add_schedule("Blocking", "* * * * * ?", [&](auto&)
+        {
+            started++;
+            gate.wait();
+        }, Overlap::Concurrent));
+
+        WHEN("The task expires while its first run is blocked")
+        {
+            REQUIRE(c.tick() == 1);
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == 1);
+
+            gate.open();
+            c.get_executor().wait_until_idle();
+
+            THEN("The second run is skipped")
+            {
+                REQUIRE(started == 1);
+                REQUIRE(c.get_executor().get_skipped() == 1);
+                REQUIRE(c.get_metrics().skipped == 1);
+            }
+            AND_THEN("Runs are dispatched again once the first one has finished")
+            {
+                c.get_clock().add(seconds{1});
+                REQUIRE(c.tick() == 1);
+                c.get_executor().wait_until_idle();
+                REQUIRE(started == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Running until a point in time")
+{
+    GIVEN("A Cron instance with a task running every second")
+    {
+        Cron<UTCClock> c;
+        std::vector<system_clock::time_point> runs;
+
+        REQUIRE(c.add_schedule("Every second", "* * * * * ?", [&runs](auto&)
+        {
+            runs.push_back(system_clock::now());
+        }));
+
+        WHEN("Running for two and a half seconds")
+        {
+            auto start = system_clock::now();
+            c.run_until(start + milliseconds{2500});
+            auto elapsed = system_clock::now() - start;
+
+            THEN("After its first run within the current second, the task runs right after each second")
+            {
+                INFO(duration_cast<milliseconds>(elapsed).count());
+                REQUIRE(elapsed >= milliseconds{2500});
+                REQUIRE(elapsed < milliseconds{2700});
+                REQUIRE(runs.size() >= 3);
+
+                for (size_t i = 1; i < runs.size(); ++i)
+                {
+                    auto into_second = runs[i] - floor<seconds>(runs[i]);
+                    INFO(duration_cast<microseconds>(into_second).count());
+                    REQUIRE(into_second < milliseconds{100});
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Running on another thread")
+{
+    GIVEN("A Cron instance without tasks, running on another thread")
+    {
+        Cron<UTCClock, Locker> c;
+        std::atomic<int> runs{0};
+
+        std::thread runner([&c]()
+                           {
+                               c.run();
+                           });
+
+        WHEN("Adding a task while it sleeps")
+        {
+            std::this_thread::sleep_for(milliseconds{100});
+            REQUIRE(c.add_schedule("Every second", "* * * * * ?", [&runs](auto&)
+            {
+                runs++;
+            }));
+
+            THEN("The loop wakes up to run it, and returns when stopped")
+            {
+                auto start = steady_clock::now();
+
+                while (runs == 0 && steady_clock::now() - start < seconds{3})
+                {
+                    std::this_thread::sleep_for(milliseconds{10});
+                }
+
+                c.stop();
+                runner.join();
+                REQUIRE(runs > 0);
+            }
+        }
+    }
+}
+
+#if defined(__linux__)
+
+SCENARIO("Driving Cron from a timerfd")
+{
+    GIVEN("A Cron instance with a task running every second, driven by a timerfd")
+    {
+        using UTCCron = Cron<UTCClock>;
+
+        UTCCron c;
+        std::vector<system_clock::time_point> runs;
+
+        REQUIRE(c.add_schedule("Every second", "* * * * * ?", [&runs](auto&)
+        {
+            runs.push_back(system_clock::now());
+        }));
+
+        TimerFd<UTCCron> timer{ c };
+        REQUIRE(timer.get_fd() != -1);
+
+        auto wait_readable = [&timer](int timeout_ms)
+                             {
+                                 pollfd p{ timer.get_fd(), POLLIN, 0 };
+                                 return poll(&p, 1, timeout_ms) == 1;
+                             };
+
+        WHEN("Handling the fd each time it is readable")
+        {
+            // The task first runs within the current second.
+            REQUIRE(wait_readable(100));
+            REQUIRE(timer.on_readable() == 1);
+
+            for (auto i = 0; i < 2; ++i)
+            {
+                REQUIRE(wait_readable(1100));
+                REQUIRE(timer.on_readable() == 1);
+            }
+
+            THEN("The task runs right after each second")
+            {
+                REQUIRE(runs.size() == 3);
+
+                for (size_t i = 1; i < runs.size(); ++i)
+                {
+                    auto into_second = runs[i] - floor<seconds>(runs[i]);
+                    INFO(duration_cast<microseconds>(into_second).count());
+                    REQUIRE(into_second < milliseconds{100});
+                }
+            }
+        }
+        AND_WHEN("Removing the task")
+        {
+            REQUIRE(wait_readable(100));
+            timer.on_readable();
+            c.remove_schedule("Every second");
+
+            THEN("The fd is readable to re-arm the timer, after which it is disarmed")
+            {
+                REQUIRE(wait_readable(100));
+                REQUIRE(timer.on_readable() == 0);
+                REQUIRE_FALSE(wait_readable(1200));
+            }
+        }
+    }
+}
+
+#endif
+
+#if defined(LIBCRON_COROUTINES)
+
+namespace
+{
+    // A coroutine that starts immediately and is not awaited by anyone.
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object()
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void()
+            {
+            }
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    template<typename CronType>
+    Detached wait_for_minutes(CronType& c, int count, std::vector<system_clock::time_point>& fired)
+    {
+        for (auto i = 0; i < count; ++i)
+        {
+            auto [found, when] = co_await c.next("0 * * * * ?");
+            REQUIRE(found);
+            fired.push_back(when);
+        }
+    }
+
+    // Keeps the handles of coroutines to resume, as an event loop would.
+    struct DeferredResumer
+    {
+        std::vector<std::coroutine_handle<>>* pending;
+
+        void operator()(std::coroutine_handle<> handle) const
+        {
+            pending->push_back(handle);
+        }
+    };
+
+    template<typename CronType>
+    Detached wait_deferred(CronType& c, const CronSchedule& schedule, DeferredResumer resumer, int& resumed)
+    {
+        co_await c.next(schedule, resumer);
+        resumed++;
+    }
+
+    template<typename CronType>
+    Detached wait_for_invalid(CronType& c, bool& found)
+    {
+        std::tie(found, std::ignore) = co_await c.next("not a schedule");
+    }
+
+    // A coroutine whose frame is destroyed along with it, even while suspended.
+    struct Owned
+    {
+        struct promise_type
+        {
+            Owned get_return_object()
+            {
+                return Owned{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_always final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void()
+            {
+            }
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+
+        explicit Owned(std::coroutine_handle<promise_type> handle)
+                : handle(handle)
+        {
+        }
+
+        Owned(Owned&& other) noexcept
+                : handle(std::exchange(other.handle, {}))
+        {
+        }
+
+        ~Owned()
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template<typename CronType>
+    Owned wait_owned(CronType& c, int& resumed)
+    {
+        co_await c.next("* * * * * ?");
+        resumed++;
+    }
+
+    // Tells whether the frame of the coroutine holding it has been destroyed.
+    struct FrameSentinel
+    {
+        bool& destroyed;
+
+        ~FrameSentinel()
+        {
+            destroyed = true;
+        }
+    };
+
+    template<typename CronType>
+    Detached wait_with_sentinel(CronType& c, bool& destroyed)
+    {
+        FrameSentinel sentinel{ destroyed };
+        co_await c.next("* * * * * ?");
+    }
+}
+
+SCENARIO("Awaiting the next occurrence of a schedule")
+{
+    GIVEN("A Cron instance and a coroutine awaiting the start of the next three minutes")
+    {
+        Cron<TestClock> c;
+        auto start = sys_days{2021_y / 1 / 1} + hours{10} + seconds{30};
+        c.get_clock().set(start);
+        std::vector<system_clock::time_point> fired;
+
+        wait_for_minutes(c, 3, fired);
+
+        THEN("It is not resumed before the minute starts")
+        {
+            c.tick();
+            c.get_clock().add(seconds{29});
+            c.tick();
+            REQUIRE(fired.empty());
+            REQUIRE(c.time_until_next() == seconds{1});
+        }
+        AND_WHEN("Ticking through the next three minutes")
+        {
+            for (auto i = 0; i < 3 * 60; ++i)
+            {
+                c.tick();
+                c.get_clock().add(seconds{1});
+            }
+
+            THEN("It is resumed at the start of each minute")
+            {
+                REQUIRE(fired.size() == 3);
+
+                for (size_t i = 0; i < fired.size(); ++i)
+                {
+                    REQUIRE((fired[i] == start + seconds{30} + minutes{i}));
+                }
+            }
+        }
+    }
+
+    GIVEN("A thousand coroutines awaiting a schedule, resumed through a caller-supplied resumer")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+
+        auto data = CronData::create("*/5 * * * * ?");
+        CronSchedule schedule{ data };
+        std::vector<std::coroutine_handle<>> pending;
+        int resumed = 0;
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            wait_deferred(c, schedule, DeferredResumer{ &pending }, resumed);
+        }
+
+        WHEN("The schedule occurs")
+        {
+            c.tick();
+            c.get_clock().add(seconds{5});
+            c.tick();
+
+            THEN("Resuming is left to the resumer")
+            {
+                REQUIRE(pending.size() == 1000);
+                REQUIRE(resumed == 0);
+
+                for (auto h : pending)
+                {
+                    h.resume();
+                }
+
+                REQUIRE(resumed == 1000);
+            }
+        }
+    }
+
+    GIVEN("A coroutine awaiting an invalid schedule")
+    {
+        Cron<TestClock> c;
+        bool found = true;
+
+        wait_for_invalid(c, found);
+
+        THEN("It is resumed immediately, without an occurrence")
+        {
+            REQUIRE_FALSE(found);
+        }
+    }
+
+    GIVEN("Two coroutines awaiting a schedule, one of which is destroyed while suspended")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+        int resumed = 0;
+
+        {
+            auto destroyed = wait_owned(c, resumed);
+        }
+
+        auto kept = wait_owned(c, resumed);
+
+        WHEN("The schedule occurs")
+        {
+            c.get_clock().add(seconds{1});
+            c.tick();
+
+            THEN("Only the remaining one is resumed")
+            {
+                REQUIRE(resumed == 1);
+                REQUIRE(kept.handle.done());
+            }
+        }
+    }
+
+    GIVEN("A coroutine awaiting a schedule")
+    {
+        bool destroyed = false;
+        auto c = std::make_unique<Cron<TestClock>>();
+        wait_with_sentinel(*c, destroyed);
+        REQUIRE_FALSE(destroyed);
+
+        WHEN("The Cron instance is destroyed")
+        {
+            c.reset();
+
+            THEN("The coroutine is destroyed along with it")
+            {
+                REQUIRE(destroyed);
+            }
+        }
+    }
+}
+
+#endif
+
+SCENARIO("Tasks changing the schedules while they run")
+{
+    GIVEN("A Cron instance with a task that removes itself and adds another task")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+        std::map<std::string, int> runs;
+
+        auto count_runs = [&runs](auto& i)
+                          {
+                              runs[std::string{ i.get_name() }]++;
+                          };
+
+        REQUIRE(c.add_schedule("Other", "* * * * * ?", count_runs));
+        REQUIRE(c.add_schedule("Once", "* * * * * ?", [&c, &runs, &count_runs](auto& i)
+        {
+            runs[std::string{ i.get_name() }]++;
+            c.remove_schedule(std::string{ i.get_name() });
+            c.add_schedule("Added", "* * * * * ?", count_runs);
+        }));
+        REQUIRE(c.add_schedule("Last", "* * * * * ?", count_runs));
+
+        WHEN("Ticking twice")
+        {
+            REQUIRE(c.tick() == 3);
+
+            THEN("The changes are applied once the tasks have run")
+            {
+                REQUIRE(c.count() == 3);
+                REQUIRE_FALSE(c.has_schedule("Once"));
+                REQUIRE(c.has_schedule("Added"));
+            }
+
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == 3);
+
+            THEN("The removed task did not run again")
+            {
+                REQUIRE(runs["Once"] == 1);
+                REQUIRE(runs["Other"] == 2);
+                REQUIRE(runs["Last"] == 2);
+                REQUIRE(runs["Added"] == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Deferring changes to the schedules")
+{
+    GIVEN("A Cron instance deferring changes")
+    {
+        Cron<UTCClock, DeferredChanges> c;
+
+        WHEN("Adding a task")
+        {
+            REQUIRE(c.add_schedule("Task", "0 0 0 1 1 ?", [](auto&)
+            {
+            }));
+
+            THEN("It is only added by the next tick")
+            {
+                REQUIRE(c.count() == 0);
+                c.tick();
+                REQUIRE(c.count() == 1);
+            }
+        }
+        AND_WHEN("Adding a task and changing it through its handle before the next tick")
+        {
+            auto handle = c.add_schedule_handle("Task", "0 0 0 1 1 ?", [](auto&)
+            {
+            });
+
+            REQUIRE(c.pause_schedule(handle));
+            REQUIRE(c.update_schedule(handle, "0 0 12 1 1 ?"));
+
+            THEN("The changes are applied in order by the next tick")
+            {
+                REQUIRE_FALSE(c.has_schedule(handle));
+                c.tick();
+                REQUIRE(c.get_status(handle)->paused);
+                REQUIRE(c.remove_schedule(handle));
+                c.tick();
+                REQUIRE(c.count() == 0);
+            }
+        }
+        AND_WHEN("Several threads add and remove tasks while another thread ticks")
+        {
+            constexpr int threads = 4;
+            constexpr int tasks_per_thread = 500;
+            std::atomic<int> done{0};
+            std::vector<std::thread> producers;
+
+            for (auto t = 0; t < threads; ++t)
+            {
+                producers.emplace_back([&c, &done, t]()
+                                       {
+                                           for (auto i = 0; i < tasks_per_thread; ++i)
+                                           {
+                                               auto name = std::to_string(t) + "-" + std::to_string(i);
+                                               c.add_schedule(name, "0 0 0 1 1 ?", [](auto&)
+                                               {
+                                               });
+
+                                               if (i % 2 == 0)
+                                               {
+                                                   c.remove_schedule(name);
+                                               }
+                                           }
+
+                                           done++;
+                                       });
+            }
+
+            while (done < threads)
+            {
+                c.tick();
+            }
+
+            for (auto& p : producers)
+            {
+                p.join();
+            }
+
+            c.tick();
+
+            THEN("All changes have been applied in order")
+            {
+                REQUIRE(c.count() == threads * tasks_per_thread / 2);
+                REQUIRE(c.has_schedule("0-1"));
+                REQUIRE_FALSE(c.has_schedule("0-0"));
+            }
+        }
+    }
+}
+
+SCENARIO("Taking snapshots of the tasks")
+{
+    GIVEN("A Cron instance with two tasks")
+    {
+        Cron<TestClock> c;
+        auto start = sys_days{2021_y / 1 / 1} + hours{10} + seconds{30};
+        c.get_clock().set(start);
+
+        REQUIRE(c.add_schedule("Every second", "* * * * * ?", [](auto&)
+        {
+        }));
+        REQUIRE(c.add_schedule("Every minute", "0 * * * * ?", [](auto&)
+        {
+        }));
+
+        WHEN("Asking for a snapshot before ticking")
+        {
+            THEN("It is empty")
+            {
+                REQUIRE(c.get_snapshot()->tasks.empty());
+            }
+        }
+        AND_WHEN("Ticking after asking for a snapshot")
+        {
+            c.get_snapshot();
+            REQUIRE(c.tick() == 1);
+            auto first = c.get_snapshot();
+
+            THEN("The snapshot holds the state of the tasks after the tick")
+            {
+                REQUIRE((first->taken == start));
+                REQUIRE(first->tasks.size() == 2);
+                REQUIRE(first->tasks[0].name == "Every second");
+                REQUIRE((first->tasks[0].next == start + seconds{1}));
+                REQUIRE((first->tasks[0].last_run == start));
+                REQUIRE(first->tasks[0].delay == 0s);
+                REQUIRE(first->tasks[1].name == "Every minute");
+                REQUIRE((first->tasks[1].next == start + seconds{30}));
+                REQUIRE((first->tasks[1].last_run == system_clock::time_point::min()));
+            }
+            AND_THEN("Ticks that change nothing keep the snapshot")
+            {
+                c.tick();
+                REQUIRE(c.get_snapshot() == first);
+            }
+            AND_THEN("Held snapshots are not changed by later ticks")
+            {
+                c.remove_schedule("Every minute");
+                c.get_clock().add(seconds{2});
+                c.tick();
+                auto second = c.get_snapshot();
+
+                REQUIRE(second != first);
+                REQUIRE(second->tasks.size() == 1);
+                REQUIRE(second->tasks[0].delay == 1s);
+                REQUIRE(first->tasks.size() == 2);
+                REQUIRE((first->tasks[0].last_run == start));
+            }
+        }
+    }
+    GIVEN("A Cron instance with tasks expiring at different times")
+    {
+        Cron<TestClock, NullLock, HeapTaskQueue> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+        std::map<std::string, TaskHandle> handles;
+        const std::vector<std::string> expressions{ "* * * * * ?", "*/2 * * * * ?", "*/3 * * * * ?", "0 * * * * ?" };
+
+        for (auto i = 0; i < 40; ++i)
+        {
+            auto name = std::to_string(i);
+            handles[name] = c.add_schedule_handle(name, expressions[i % expressions.size()], [](auto&)
+            {
+            });
+        }
+
+        c.get_snapshot();
+
+        WHEN("Ticking, sometimes changing the tasks or holding on to snapshots")
+        {
+            std::vector<std::shared_ptr<const Snapshot>> held;
+            auto mismatches = 0;
+
+            for (auto i = 0; i < 120; ++i)
+            {
+                if (i % 17 == 0)
+                {
+                    auto name = "Added " + std::to_string(i);
+                    handles[name] = c.add_schedule_handle(name, "*/5 * * * * ?", [](auto&)
+                    {
+                    });
+                }
+                else if (i % 23 == 0)
+                {
+                    auto name = std::to_string(i / 23);
+                    c.remove_schedule(handles[name]);
+                    handles.erase(name);
+                }
+
+                c.get_clock().add(seconds{1});
+                c.tick();
+                auto snapshot = c.get_snapshot();
+
+                if (i % 7 == 0)
+                {
+                    held.push_back(snapshot);
+                }
+                else if (i % 11 == 0)
+                {
+                    held.clear();
+                }
+
+                if (snapshot->tasks.size() != handles.size())
+                {
+                    ++mismatches;
+                }
+
+                for (const auto& t : snapshot->tasks)
+                {
+                    auto status = c.get_status(handles[t.name]);
+
+                    if (!status || status->next != t.next || status->last_run != t.last_run)
+                    {
+                        ++mismatches;
+                    }
+                }
+            }
+
+            THEN("Each snapshot holds the current state of all tasks")
+            {
+                REQUIRE(mismatches == 0);
+            }
+        }
+    }
+    GIVEN("A locking Cron instance ticking on one thread while others read snapshots")
+    {
+        Cron<TestClock, Locker> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1});
+        constexpr int task_count = 100;
+
+        for (auto i = 0; i < task_count; ++i)
+        {
+            c.add_schedule(std::to_string(i), "* * * * * ?", [](auto&)
+            {
+            });
+        }
+
+        c.get_snapshot();
+        std::atomic<bool> done{false};
+        std::atomic<int> inconsistent{0};
+        std::vector<std::thread> readers;
+
+        for (auto r = 0; r < 2; ++r)
+        {
+            readers.emplace_back([&c, &done, &inconsistent]()
+                                 {
+                                     while (!done)
+                                     {
+                                         auto s = c.get_snapshot();
+
+                                         // All tasks ran on the same ticks.
+                                         for (const auto& t : s->tasks)
+                                         {
+                                             if (t.last_run != s->taken || t.next != s->taken + seconds{1})
+                                             {
+                                                 inconsistent++;
+                                             }
+                                         }
+                                     }
+                                 });
+        }
+
+        for (auto i = 0; i < 200; ++i)
+        {
+            c.get_clock().add(seconds{1});
+            REQUIRE(c.tick() == task_count);
+        }
+
+        done = true;
+
+        for (auto& r : readers)
+        {
+            r.join();
+        }
+
+        THEN("Each snapshot is consistent")
+        {
+            REQUIRE(inconsistent == 0);
+            REQUIRE(c.get_snapshot()->tasks.size() == task_count);
+        }
+    }
+}
+
+SCENARIO("Tasks with identical schedules")
+{
+    GIVEN("A Cron instance with tasks using equivalent expressions")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10} + minutes{30} + seconds{30});
+        std::map<std::string, int> runs;
+
+        auto count_runs = [&runs](auto& i)
+                          {
+                              runs[std::string{ i.get_name() }]++;
+                          };
+
+        REQUIRE(std::get<0>(c.add_schedule(std::map<std::string, std::string>{ { "A", "@hourly ?" },
+                                                                                { "B", "0 * * * * ?" } },
+                                           count_runs)));
+        REQUIRE(c.add_schedule("C", "0 0-59 * * * ?", count_runs));
+        REQUIRE(c.add_schedule("D", "0 */2 * * * ?", count_runs));
+
+        WHEN("The minute passes")
+        {
+            c.get_clock().add(seconds{30});
+
+            THEN("The tasks expire together")
+            {
+                REQUIRE(c.tick() == 3);
+                REQUIRE(runs["A"] == 1);
+                REQUIRE(runs["B"] == 1);
+                REQUIRE(runs["C"] == 1);
+                REQUIRE(runs["D"] == 0);
+            }
+        }
+        AND_WHEN("Updating one of them to another schedule")
+        {
+            REQUIRE(c.update_schedule("B", "0 */2 * * * ?"));
+            c.get_clock().add(seconds{30});
+            c.tick();
+            c.get_clock().add(minutes{1});
+            c.tick();
+
+            THEN("Only that task follows the new schedule")
+            {
+                REQUIRE(runs["A"] == 2);
+                REQUIRE(runs["B"] == 1);
+                REQUIRE(runs["C"] == 2);
+                REQUIRE(runs["D"] == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Move-only and shared work")
+{
+    GIVEN("A Cron instance")
+    {
+        Cron<TestClock> c;
+        c.get_clock().set(sys_days{2021_y / 1 / 1} + hours{10});
+
+        WHEN("Adding work that can only be moved")
+        {
+            auto runs = std::make_unique<int>(0);
+            auto counter = runs.get();
+
+            REQUIRE(c.add_schedule("Move-only", "* * * * * ?", [runs = std::move(runs)](auto&)
+            {
+                ++*runs;
+            }));
+
+            c.tick();
+
+            THEN("It runs")
+            {
+                REQUIRE(*counter == 1);
+            }
+        }
+        AND_WHEN("Adding several tasks with the same work")
+        {
+            struct Work
+            {
+                void operator()(const TaskInformation&)
+                {
+                    ++*runs;
+                }
+
+                std::shared_ptr<int> runs;
+            };
+
+            auto runs = std::make_shared<int>(0);
+            std::map<std::string, std::string> schedules{ { "A", "* * * * * ?" }, { "B", "* * * * * ?" }, { "C", "* * * * * ?" } };
+            REQUIRE(std::get<0>(c.add_schedule(schedules, Work{ runs })));
+
+            THEN("The tasks share a single copy of the work")
+            {
+                REQUIRE(runs.use_count() == 2);
+                c.tick();
+                REQUIRE(*runs == 3);
+                c.clear_schedules();
+                REQUIRE(runs.use_count() == 1);
+            }
+        }
+        AND_WHEN("Adding work by reference")
+        {
+            auto runs = 0;
+            auto work = [&runs](auto&)
+                        {
+                            ++runs;
+                        };
+
+            REQUIRE(c.add_schedule("By reference", "* * * * * ?", std::ref(work)));
+            c.tick();
+
+            THEN("The referenced work runs")
+            {
+                REQUIRE(runs == 1);
+            }
+        }
+    }
+    GIVEN("Work of different sizes")
+    {
+        struct Small
+        {
+            void operator()(const TaskInformation&) const
+            {
+            }
+
+            void* values[TaskFunction::INLINE_SIZE / sizeof(void*)];
+        };
+
+        struct Large
+        {
+            void operator()(const TaskInformation&) const
+            {
+            }
+
+            void* values[TaskFunction::INLINE_SIZE / sizeof(void*) + 1];
+        };
+
+        THEN("Work that fits is stored inline")
+        {
+            REQUIRE(TaskFunction::is_inline<Small>());
+            REQUIRE_FALSE(TaskFunction::is_inline<Large>());
+            REQUIRE(TaskFunction::is_inline<SharedTaskFunction>());
+        }
+        AND_THEN("Both can be moved and called")
+        {
+            auto calls = 0;
+            TaskFunction small = [&calls, s = Small{}](auto&)
+                                 {
+                                     (void)s;
+                                     ++calls;
+                                 };
+            TaskFunction large = [&calls, l = Large{}](auto&)
+                                 {
+                                     (void)l;
+                                     ++calls;
+                                 };
+            TaskFunction moved{ std::move(large) };
+            small = std::move(moved);
+
+            REQUIRE_FALSE(large);
+            REQUIRE_FALSE(moved);
+            small(TaskInformation{ "Task", 1, system_clock::time_point{}, system_clock::time_point{}, 1 });
+            REQUIRE(calls == 1);
+        }
+    }
+}
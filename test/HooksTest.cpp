@@ -0,0 +1,200 @@
+#include <catch.hpp>
+#include <libcron/include/libcron/Cron.h>
+#include <libcron/externals/date/include/date/date.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace libcron;
+using namespace std::chrono;
+using namespace date;
+
+namespace
+{
+    class HookClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return 0s;
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = sys_days{ 2021_y / 1 / 1 } + hours{ 10 } + seconds{ 1 };
+    };
+
+    class RecordingHooks
+    {
+        public:
+            void on_tick_begin()
+            {
+                calls.emplace_back("begin");
+            }
+
+            void on_clock_read(system_clock::time_point)
+            {
+                calls.emplace_back("clock");
+            }
+
+            void on_task_fire(const Task& t)
+            {
+                calls.emplace_back("fire " + t.get_name());
+            }
+
+            void on_task_done(const Task& t)
+            {
+                calls.emplace_back("done " + t.get_name());
+            }
+
+            void on_reschedule(const Task& t, bool keep)
+            {
+                calls.emplace_back("reschedule " + t.get_name() + (keep ? "" : " last"));
+            }
+
+            void on_tick_end(size_t expired)
+            {
+                calls.emplace_back("end " + std::to_string(expired));
+            }
+
+            std::vector<std::string> calls{};
+    };
+
+    // Advances by one each time it is read, and by more when told to.
+    struct CountingTicks
+    {
+        static uint64_t now() noexcept
+        {
+            return ++ticks;
+        }
+
+        static void advance(uint64_t count)
+        {
+            ticks += count;
+        }
+
+        static uint64_t ticks;
+    };
+
+    uint64_t CountingTicks::ticks = 0;
+}
+
+SCENARIO("Hooks are called at the phases of a tick")
+{
+    GIVEN("A Cron instance with recording hooks")
+    {
+        Cron<HookClock, NullLock, TaskQueue, InlineExecutor, RecordingHooks> c;
+
+        c.add_schedule("A", "* * * * * ?", [&c](auto&)
+        {
+            c.get_hooks().calls.emplace_back("work");
+        });
+        c.add_schedule("B", "0 0 11 * * ?", [](auto&)
+        {
+        });
+
+        WHEN("Ticking when nothing is due")
+        {
+            c.get_clock().add(minutes{ 1 });
+            REQUIRE(c.tick() == 1);
+            c.get_hooks().calls.clear();
+            REQUIRE(c.tick() == 0);
+
+            THEN("Only the tick itself is seen")
+            {
+                REQUIRE(c.get_hooks().calls == std::vector<std::string>{ "begin", "clock", "end 0" });
+            }
+        }
+
+        AND_WHEN("Ticking with tasks due")
+        {
+            REQUIRE(c.tick(system_clock::time_point{ sys_days{ 2021_y / 1 / 1 } + hours{ 11 } }) == 2);
+
+            THEN("Each expired task is seen around its work and rescheduling")
+            {
+                auto& calls = c.get_hooks().calls;
+                REQUIRE(calls.size() == 10);
+                REQUIRE(calls.front() == "begin");
+                REQUIRE(calls[1] == "clock");
+                REQUIRE(calls.back() == "end 2");
+
+                auto a = std::find(calls.begin(), calls.end(), "fire A");
+                REQUIRE(std::distance(a, calls.end()) > 4);
+                REQUIRE(*++a == "work");
+                REQUIRE(*++a == "done A");
+                REQUIRE(*++a == "reschedule A");
+
+                auto b = std::find(calls.begin(), calls.end(), "fire B");
+                REQUIRE(std::distance(b, calls.end()) > 3);
+                REQUIRE(*++b == "done B");
+                REQUIRE(*++b == "reschedule B");
+            }
+        }
+    }
+}
+
+SCENARIO("Timing the phases of ticks")
+{
+    static_assert(std::is_empty<NullHooks>::value, "The default hooks have no state");
+
+    GIVEN("A Cron instance timing its ticks")
+    {
+        Cron<HookClock, NullLock, TaskQueue, InlineExecutor, TimingHooks<CountingTicks>> c;
+        c.add_schedule("A", "* * * * * ?", [](auto&)
+        {
+            CountingTicks::advance(100);
+        });
+        c.add_schedule("B", "* * * * * ?", [](auto&)
+        {
+            CountingTicks::advance(100);
+        });
+
+        WHEN("Nothing has ticked")
+        {
+            THEN("There are no phases")
+            {
+                REQUIRE(c.get_hooks().get_total().ticks == 0);
+                REQUIRE(c.get_hooks().get_total().total() == 0);
+            }
+        }
+
+        AND_WHEN("Ticking twice")
+        {
+            REQUIRE(c.tick() == 2);
+            c.get_clock().add(seconds{ 1 });
+            REQUIRE(c.tick() == 2);
+
+            THEN("The time between the hooks is split into phases")
+            {
+                auto last = c.get_hooks().get_last();
+                REQUIRE(last.ticks == 1);
+                REQUIRE(last.fired == 2);
+                REQUIRE(last.clock == 1);
+                // Before the first task, between the tasks, and after the last one
+                REQUIRE(last.queue == 3);
+                REQUIRE(last.callbacks == 2 * 101);
+                REQUIRE(last.reschedule == 2);
+                REQUIRE(last.total() == 1 + 3 + 202 + 2);
+            }
+            AND_THEN("The ticks are added together")
+            {
+                auto total = c.get_hooks().get_total();
+                REQUIRE(total.ticks == 2);
+                REQUIRE(total.fired == 4);
+                REQUIRE(total.callbacks == 4 * 101);
+                REQUIRE(total.total() == 2 * c.get_hooks().get_last().total());
+            }
+        }
+    }
+}
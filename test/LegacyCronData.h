@@ -0,0 +1,369 @@
+#pragma once
+
+// The regex based cron expression parser that CronData used before the hand written parser replaced it.
+// Kept as the reference implementation for the differential test and the parser benchmark.
+
+#include <set>
+#include <regex>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <libcron/TimeTypes.h>
+
+namespace libcron
+{
+    class LegacyCronData
+    {
+        public:
+            // Returns false if the expression is invalid. std::stoi throwing on huge numbers is treated as invalid.
+            bool parse(const std::string& cron_expression)
+            {
+                try
+                {
+                    parse_expression(cron_expression);
+                }
+                catch (const std::logic_error&)
+                {
+                    valid = false;
+                }
+
+                return valid;
+            }
+
+            template<typename T>
+            static uint64_t mask_of(const std::set<T>& set)
+            {
+                uint64_t mask = 0;
+
+                for (auto v : set)
+                {
+                    mask |= uint64_t{1} << static_cast<uint8_t>(v);
+                }
+
+                return mask;
+            }
+
+            std::set<Seconds> seconds{};
+            std::set<Minutes> minutes{};
+            std::set<Hours> hours{};
+            std::set<DayOfMonth> day_of_month{};
+            std::set<Months> months{};
+            std::set<DayOfWeek> day_of_week{};
+            bool valid = false;
+
+        private:
+            template<typename T>
+            static uint8_t value_of(T t)
+            {
+                return static_cast<uint8_t>(t);
+            }
+
+            void parse_expression(const std::string& cron_expression)
+            {
+                std::string tmp = std::regex_replace(cron_expression, std::regex("@yearly"), "0 0 1 1 *");
+                tmp = std::regex_replace(tmp, std::regex("@annually"), "0 0 1 1 *");
+                tmp = std::regex_replace(tmp, std::regex("@monthly"), "0 0 1 * *");
+                tmp = std::regex_replace(tmp, std::regex("@weekly"), "0 0 * * 0");
+                tmp = std::regex_replace(tmp, std::regex("@daily"), "0 0 * * *");
+                const std::string expression = std::regex_replace(tmp, std::regex("@hourly"), "0 * * * *");
+
+                std::regex split{ R"#(^\s*(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s+(.*?)\s*$)#",
+                                  std::regex_constants::ECMAScript };
+
+                std::smatch match;
+
+                if (std::regex_match(expression.begin(), expression.end(), match, split))
+                {
+                    valid = validate_numeric<Seconds>(match[1], seconds);
+                    valid &= validate_numeric<Minutes>(match[2], minutes);
+                    valid &= validate_numeric<Hours>(match[3], hours);
+                    valid &= validate_numeric<DayOfMonth>(match[4], day_of_month);
+                    valid &= validate_literal<Months>(match[5], months, month_names());
+                    valid &= validate_literal<DayOfWeek>(match[6], day_of_week, day_names());
+                    valid &= check_dom_vs_dow(match[4], match[6]);
+                    valid &= validate_date_vs_months();
+                }
+            }
+
+            static const std::vector<std::string>& month_names()
+            {
+                static const std::vector<std::string> names{ "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                                             "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+                return names;
+            }
+
+            static const std::vector<std::string>& day_names()
+            {
+                static const std::vector<std::string> names{ "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+                return names;
+            }
+
+            template<typename T>
+            bool validate_numeric(const std::string& s, std::set<T>& numbers)
+            {
+                return process_parts(split(s, ','), numbers);
+            }
+
+            template<typename T>
+            bool validate_literal(const std::string& s, std::set<T>& numbers, const std::vector<std::string>& names)
+            {
+                std::vector<std::string> parts = split(s, ',');
+
+                auto value_of_first_name = value_of(T::First);
+
+                for (const auto& name : names)
+                {
+                    std::regex m(name, std::regex_constants::ECMAScript | std::regex_constants::icase);
+
+                    for (auto& part : parts)
+                    {
+                        std::string replaced;
+                        std::regex_replace(std::back_inserter(replaced), part.begin(), part.end(), m,
+                                           std::to_string(value_of_first_name));
+
+                        part = replaced;
+                    }
+
+                    value_of_first_name++;
+                }
+
+                return process_parts(parts, numbers);
+            }
+
+            template<typename T>
+            bool process_parts(const std::vector<std::string>& parts, std::set<T>& numbers)
+            {
+                bool res = true;
+
+                for (const auto& p : parts)
+                {
+                    res &= convert(p, numbers);
+                }
+
+                return res;
+            }
+
+            template<typename T>
+            bool get_range(const std::string& s, T& low, T& high)
+            {
+                bool res = false;
+                std::regex range(R"#((\d+)-(\d+))#", std::regex_constants::ECMAScript);
+                std::smatch match;
+
+                if (std::regex_match(s.begin(), s.end(), match, range))
+                {
+                    auto left = std::stoi(match[1].str());
+                    auto right = std::stoi(match[2].str());
+
+                    if (is_within_limits<T>(left, right))
+                    {
+                        low = static_cast<T>(left);
+                        high = static_cast<T>(right);
+                        res = true;
+                    }
+                }
+
+                return res;
+            }
+
+            template<typename T>
+            bool get_step(const std::string& s, uint8_t& start, uint8_t& step)
+            {
+                bool res = false;
+                std::regex range(R"#((\d+|\*)/(\d+))#", std::regex_constants::ECMAScript);
+                std::smatch match;
+
+                if (std::regex_match(s.begin(), s.end(), match, range))
+                {
+                    int raw_start;
+
+                    if (match[1].str() == "*")
+                    {
+                        raw_start = value_of(T::First);
+                    }
+                    else
+                    {
+                        raw_start = std::stoi(match[1].str());
+                    }
+
+                    auto raw_step = std::stoi(match[2].str());
+
+                    if (is_within_limits<T>(raw_start, raw_start) && raw_step > 0)
+                    {
+                        start = static_cast<uint8_t>(raw_start);
+                        step = static_cast<uint8_t>(raw_step);
+                        res = true;
+                    }
+                }
+
+                return res;
+            }
+
+            template<typename T>
+            void add_full_range(std::set<T>& set)
+            {
+                for (auto v = value_of(T::First); v <= value_of(T::Last); ++v)
+                {
+                    set.emplace(static_cast<T>(v));
+                }
+            }
+
+            template<typename T>
+            bool add_number(std::set<T>& set, int32_t number)
+            {
+                bool res = true;
+
+                if (set.find(static_cast<T>(number)) == set.end())
+                {
+                    if (is_within_limits<T>(number, number))
+                    {
+                        set.emplace(static_cast<T>(number));
+                    }
+                    else
+                    {
+                        res = false;
+                    }
+                }
+
+                return res;
+            }
+
+            template<typename T>
+            bool is_within_limits(int32_t low, int32_t high)
+            {
+                return is_between(low, value_of(T::First), value_of(T::Last))
+                       && is_between(high, value_of(T::First), value_of(T::Last));
+            }
+
+            template<typename T>
+            bool convert(const std::string& range, std::set<T>& numbers)
+            {
+                T left;
+                T right;
+                uint8_t step_start;
+                uint8_t step;
+
+                bool res = true;
+
+                if (range == "*" || range == "?")
+                {
+                    add_full_range<T>(numbers);
+                }
+                else if (is_number(range))
+                {
+                    res = add_number<T>(numbers, std::stoi(range));
+                }
+                else if (get_range<T>(range, left, right))
+                {
+                    if (left <= right)
+                    {
+                        for (auto v = value_of(left); v <= value_of(right); ++v)
+                        {
+                            res &= add_number(numbers, v);
+                        }
+                    }
+                    else
+                    {
+                        for (auto v = value_of(left); v <= value_of(T::Last); ++v)
+                        {
+                            res = add_number(numbers, v);
+                        }
+
+                        for (auto v = value_of(T::First); v <= value_of(right); ++v)
+                        {
+                            res = add_number(numbers, v);
+                        }
+                    }
+                }
+                else if (get_step<T>(range, step_start, step))
+                {
+                    for (auto v = step_start; v <= value_of(T::Last); v += step)
+                    {
+                        res = add_number(numbers, v);
+                    }
+                }
+                else
+                {
+                    res = false;
+                }
+
+                return res;
+            }
+
+            std::vector<std::string> split(const std::string& s, char token)
+            {
+                std::vector<std::string> res;
+
+                std::string r = "[";
+                r += token;
+                r += "]";
+                std::regex splitter{ r, std::regex_constants::ECMAScript };
+
+                std::copy(std::sregex_token_iterator(s.begin(), s.end(), splitter, -1),
+                          std::sregex_token_iterator(),
+                          std::back_inserter(res));
+
+                return res;
+            }
+
+            bool is_number(const std::string& s)
+            {
+                return !s.empty()
+                       && std::find_if(s.begin(), s.end(),
+                                       [](char c)
+                                       {
+                                           return !std::isdigit(c);
+                                       }) == s.end();
+            }
+
+            bool is_between(int32_t value, int32_t low_limit, int32_t high_limit)
+            {
+                return value >= low_limit && value <= high_limit;
+            }
+
+            bool validate_date_vs_months() const
+            {
+                bool res = true;
+
+                if (months.size() == 1 && months.find(static_cast<Months>(2)) != months.end())
+                {
+                    res = false;
+
+                    for (auto i = 1; !res && i <= 29; ++i)
+                    {
+                        res = day_of_month.find(static_cast<DayOfMonth>(i)) != day_of_month.end();
+                    }
+                }
+
+                if (res)
+                {
+                    if (day_of_month.size() == 1 && day_of_month.find(DayOfMonth::Last) != day_of_month.end())
+                    {
+                        const Months months_with_31[] = { Months::January, Months::March, Months::May,
+                                                          Months::July, Months::August, Months::October,
+                                                          Months::December };
+                        res = false;
+
+                        for (auto m : months_with_31)
+                        {
+                            res |= months.find(m) != months.end();
+                        }
+                    }
+                }
+
+                return res;
+            }
+
+            bool check_dom_vs_dow(const std::string& dom, const std::string& dow) const
+            {
+                auto check = [](const std::string& l, std::string r)
+                             {
+                                 return l == "*" && (r != "*" || r == "?");
+                             };
+
+                return (dom == "?" || dow == "?")
+                       || check(dom, dow)
+                       || check(dow, dom);
+            }
+    };
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// The iterative next-fire search that CronSchedule used before the closed-form search replaced it.
+// Kept as the reference implementation for the differential test and the schedule benchmark.
+
+#include <chrono>
+#include <limits>
+#include <tuple>
+#include <date/date.h>
+#include <libcron/CronData.h>
+#include <libcron/CronSchedule.h>
+
+namespace libcron
+{
+    class LegacyCronSchedule
+    {
+        public:
+            explicit LegacyCronSchedule(const CronData& data)
+                    : data(data)
+            {
+            }
+
+            std::tuple<bool, std::chrono::system_clock::time_point>
+            calculate_from(const std::chrono::system_clock::time_point& from) const
+            {
+                using namespace std::chrono;
+                using namespace date;
+
+                auto curr = from;
+
+                bool done = false;
+                auto max_iterations = std::numeric_limits<uint16_t>::max();
+
+                while (!done && --max_iterations > 0)
+                {
+                    bool date_changed = false;
+                    year_month_day ymd = date::floor<days>(curr);
+
+                    if (data.get_months().find(static_cast<Months>(unsigned(ymd.month()))) == data.get_months().end())
+                    {
+                        auto next_month = ymd + months{1};
+                        sys_days s = next_month.year() / next_month.month() / 1;
+                        curr = s;
+                        date_changed = true;
+                    }
+                    else if (data.get_day_of_month().size() != CronData::value_of(DayOfMonth::Last))
+                    {
+                        if (data.get_day_of_month().find(static_cast<DayOfMonth>(unsigned(ymd.day()))) ==
+                            data.get_day_of_month().end())
+                        {
+                            sys_days s = ymd;
+                            curr = s;
+                            curr += days{1};
+                            date_changed = true;
+                        }
+                    }
+                    else
+                    {
+                        year_month_weekday ymw = date::floor<days>(curr);
+
+                        if (data.get_day_of_week().find(static_cast<DayOfWeek>(ymw.weekday().c_encoding())) ==
+                            data.get_day_of_week().end())
+                        {
+                            sys_days s = ymd;
+                            curr = s;
+                            curr += days{1};
+                            date_changed = true;
+                        }
+                    }
+
+                    if (!date_changed)
+                    {
+                        auto date_time = CronSchedule::to_calendar_time(curr);
+                        if (data.get_hours().find(static_cast<Hours>(date_time.hour)) == data.get_hours().end())
+                        {
+                            curr += hours{1};
+                            curr -= minutes{date_time.min};
+                            curr -= seconds{date_time.sec};
+                        }
+                        else if (data.get_minutes().find(static_cast<Minutes>(date_time.min)) ==
+                                 data.get_minutes().end())
+                        {
+                            curr += minutes{1};
+                            curr -= seconds{date_time.sec};
+                        }
+                        else if (data.get_seconds().find(static_cast<Seconds>(date_time.sec)) ==
+                                 data.get_seconds().end())
+                        {
+                            curr += seconds{1};
+                        }
+                        else
+                        {
+                            done = true;
+                        }
+                    }
+                }
+
+                curr -= curr.time_since_epoch() % seconds{1};
+
+                return std::make_tuple(max_iterations > 0, curr);
+            }
+
+        private:
+            CronData data;
+    };
+}
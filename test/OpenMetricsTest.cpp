@@ -0,0 +1,171 @@
+#include <catch.hpp>
+#include <libcron/include/libcron/Cron.h>
+#include <libcron/include/libcron/OpenMetrics.h>
+#include <libcron/externals/date/include/date/date.h>
+#include <string>
+
+using namespace libcron;
+using namespace std::chrono;
+using namespace date;
+
+namespace
+{
+    class MetricsClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return 0s;
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = sys_days{ 2021_y / 1 / 1 } + hours{ 10 } + seconds{ 1 };
+    };
+
+    bool contains(const std::string& text, const std::string& line)
+    {
+        return text.find(line + "\n") != std::string::npos;
+    }
+}
+
+SCENARIO("Exporting metrics as OpenMetrics text")
+{
+    GIVEN("A Cron instance with tasks that have run, one of them late")
+    {
+        Cron<MetricsClock> c;
+        c.add_schedule("Every second", "* * * * * ?", [](auto&)
+        {
+        });
+        c.add_schedule("Quoted \"name\"", "* * * * * ?", [](auto&)
+        {
+        });
+        c.add_schedule("Every minute", "0 * * * * ?", [](auto&)
+        {
+        });
+
+        REQUIRE(c.tick() == 2);
+        c.get_clock().add(milliseconds{ 1500 });
+        REQUIRE(c.tick() == 2);
+
+        WHEN("Rendering all tasks")
+        {
+            OpenMetricsExporter exporter;
+            std::string text = "existing\n";
+            exporter.render(c, text);
+
+            THEN("The text is appended, and ends the exposition")
+            {
+                REQUIRE(text.rfind("existing\n", 0) == 0);
+                REQUIRE(text.size() > 6);
+                REQUIRE(text.compare(text.size() - 6, 6, "# EOF\n") == 0);
+            }
+            AND_THEN("It holds the state of the scheduler and the metrics of all tasks")
+            {
+                REQUIRE(contains(text, "libcron_tasks 3"));
+                REQUIRE(contains(text, "# TYPE libcron_next_fire_seconds gauge"));
+                REQUIRE(contains(text, "libcron_tick_duration_seconds_count 2"));
+                REQUIRE(contains(text, "libcron_runs_total 4"));
+                REQUIRE(contains(text, "libcron_missed_runs_total 0"));
+                REQUIRE(contains(text, "libcron_failed_runs_total 0"));
+                REQUIRE(contains(text, "libcron_delay_seconds_bucket{le=\"0.0001\"} 2"));
+                // Half a second is counted in a bucket reaching a little beyond it.
+                REQUIRE(contains(text, "libcron_delay_seconds_bucket{le=\"0.5\"} 2"));
+                REQUIRE(contains(text, "libcron_delay_seconds_bucket{le=\"1.0\"} 4"));
+                REQUIRE(contains(text, "libcron_delay_seconds_bucket{le=\"+Inf\"} 4"));
+                REQUIRE(contains(text, "libcron_delay_seconds_sum 1.000000"));
+            }
+            AND_THEN("Each task that has run has its own series, with escaped names")
+            {
+                REQUIRE(contains(text, "libcron_task_runs_total{task=\"Every second\"} 2"));
+                REQUIRE(contains(text, "libcron_task_runs_total{task=\"Quoted \\\"name\\\"\"} 2"));
+                REQUIRE(text.find("task=\"Every minute\"") == std::string::npos);
+                REQUIRE(contains(text, "libcron_task_delay_seconds_bucket{task=\"Every second\",le=\"+Inf\"} 2"));
+                REQUIRE(contains(text, "libcron_task_delay_seconds_sum{task=\"Every second\"} 0.500000"));
+                REQUIRE(contains(text, "libcron_tasks_not_exported 0"));
+            }
+            AND_THEN("The expression cache is included")
+            {
+                REQUIRE(contains(text, "# TYPE libcron_expression_cache_hits counter"));
+                REQUIRE(text.find("\nlibcron_expression_cache_hit_ratio ") != std::string::npos);
+            }
+        }
+
+        AND_WHEN("Rendering with a cap of one task")
+        {
+            c.add_schedule("Late", "* * * * * ?", [](auto&)
+            {
+            });
+            c.get_clock().add(seconds{ 3 });
+            REQUIRE(c.tick() == 3);
+
+            OpenMetricsExporter exporter{ 1 };
+            std::string text;
+            exporter.render(c, text);
+
+            THEN("Only the task with the highest total delay has its own series")
+            {
+                REQUIRE(contains(text, "libcron_tasks 4"));
+                REQUIRE(contains(text, "libcron_tasks_not_exported 2"));
+                REQUIRE(text.find("task=\"Every second\"") == std::string::npos);
+                REQUIRE(text.find("task=\"Quoted") == std::string::npos);
+                REQUIRE(contains(text, "libcron_task_runs_total{task=\"Late\"} 1"));
+                REQUIRE(contains(text, "libcron_task_missed_runs_total{task=\"Late\"} 1"));
+                REQUIRE(contains(text, "libcron_task_failed_runs_total{task=\"Late\"} 0"));
+            }
+            AND_THEN("Rendering again gives the same text")
+            {
+                std::string again;
+                exporter.render(c, again);
+                REQUIRE(again == text);
+            }
+        }
+    }
+
+    GIVEN("Tasks sharing a name, and another task")
+    {
+        Cron<MetricsClock> c;
+        c.add_schedule("Twin", "* * * * * ?", [](auto&)
+        {
+        });
+        c.add_schedule("Twin", "* * * * * ?", [](auto&)
+        {
+        });
+        c.add_schedule("Zed", "* * * * * ?", [](auto&)
+        {
+        });
+        REQUIRE(c.tick() == 3);
+
+        THEN("They share a series adding up their metrics")
+        {
+            OpenMetricsExporter exporter;
+            std::string text;
+            exporter.render(c, text);
+
+            REQUIRE(contains(text, "libcron_task_runs_total{task=\"Twin\"} 2"));
+            REQUIRE(text.find("libcron_task_runs_total{task=\"Twin\"}") == text.rfind("libcron_task_runs_total{task=\"Twin\"}"));
+            REQUIRE(contains(text, "libcron_task_delay_seconds_bucket{task=\"Twin\",le=\"+Inf\"} 2"));
+            REQUIRE(contains(text, "libcron_task_delay_seconds_count{task=\"Twin\"} 2"));
+            REQUIRE(contains(text, "libcron_task_runs_total{task=\"Zed\"} 1"));
+            REQUIRE(contains(text, "libcron_task_delay_seconds_count{task=\"Zed\"} 1"));
+            REQUIRE(contains(text, "libcron_tasks_not_exported 0"));
+
+            AND_THEN("Rendering again gives the same text")
+            {
+                std::string again;
+                exporter.render(c, again);
+                REQUIRE(again == text);
+            }
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#include <catch.hpp>
+#include <libcron/include/libcron/TaskMetrics.h>
+#include <thread>
+#include <vector>
+
+using namespace libcron;
+using namespace std::chrono;
+
+SCENARIO("Latency buckets")
+{
+    GIVEN("The buckets of a latency histogram")
+    {
+        THEN("Each value is counted in a bucket whose highest value is within a quarter of it")
+        {
+            for (int64_t us = 0; us < 100000; us += us < 1000 ? 1 : 97)
+            {
+                auto i = LatencyBuckets::index_of(microseconds{ us });
+                REQUIRE(i < LatencyBuckets::COUNT);
+                REQUIRE(LatencyBuckets::highest(i).count() >= us);
+                REQUIRE(LatencyBuckets::highest(i).count() <= us + us / 4);
+                REQUIRE((i == 0 || LatencyBuckets::highest(i - 1).count() < us));
+            }
+        }
+        AND_THEN("Negative values are counted as zero and very large ones in the last bucket")
+        {
+            REQUIRE(LatencyBuckets::index_of(milliseconds{ -5 }) == 0);
+            REQUIRE(LatencyBuckets::index_of(nanoseconds{ 999 }) == 0);
+            REQUIRE(LatencyBuckets::index_of(hours{ 1 }) == LatencyBuckets::COUNT - 2);
+            REQUIRE(LatencyBuckets::index_of(hours{ 24 * 365 }) == LatencyBuckets::COUNT - 1);
+            REQUIRE(LatencyBuckets::highest(LatencyBuckets::COUNT - 1).count() == UINT32_MAX);
+        }
+    }
+}
+
+SCENARIO("Latency histograms")
+{
+    GIVEN("A histogram of the values from 1 to 1000 milliseconds")
+    {
+        LatencyHistogram h;
+
+        for (int ms = 1; ms <= 1000; ++ms)
+        {
+            h.record(milliseconds{ ms });
+        }
+
+        LatencyCounts counts;
+        counts.add(h);
+
+        THEN("The values at quantiles are known to within a quarter")
+        {
+            REQUIRE(counts.total() == 1000);
+            REQUIRE(counts.value_at_quantile(0.5) >= milliseconds{ 500 });
+            REQUIRE(counts.value_at_quantile(0.5) <= milliseconds{ 625 });
+            REQUIRE(counts.value_at_quantile(0.99) >= milliseconds{ 990 });
+            REQUIRE(counts.value_at_quantile(0.99) <= milliseconds{ 1250 });
+            REQUIRE(counts.value_at_quantile(0.0) >= milliseconds{ 1 });
+            REQUIRE(counts.value_at_quantile(0.0) <= milliseconds{ 2 });
+            REQUIRE(counts.value_at_quantile(1.0) == counts.value_at_quantile(0.999));
+        }
+        AND_THEN("Counts of several histograms add up")
+        {
+            LatencyCounts both;
+            both.add(counts);
+            both.add(h);
+            REQUIRE(both.total() == 2000);
+            REQUIRE((both.value_at_quantile(0.5) == counts.value_at_quantile(0.5)));
+        }
+    }
+
+    GIVEN("An empty histogram")
+    {
+        LatencyCounts counts;
+
+        THEN("All quantiles are zero")
+        {
+            REQUIRE(counts.total() == 0);
+            REQUIRE(counts.value_at_quantile(0.99) == microseconds{ 0 });
+        }
+    }
+}
+
+SCENARIO("Task metrics recorded from several threads")
+{
+    GIVEN("The metrics of a task")
+    {
+        TaskMetrics metrics;
+
+        WHEN("Runs are recorded from several threads at once")
+        {
+            std::vector<std::thread> threads;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([&metrics]()
+                                     {
+                                         for (int run = 0; run < 10000; ++run)
+                                         {
+                                             metrics.record_run(milliseconds{ 10 }, microseconds{ 50 });
+                                             metrics.record_skip();
+                                         }
+                                     });
+            }
+
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+
+            THEN("No run is lost")
+            {
+                MetricsSummary summary;
+                summary.add(metrics);
+
+                REQUIRE(summary.tasks == 1);
+                REQUIRE(summary.runs == 40000);
+                REQUIRE(summary.skipped == 40000);
+                REQUIRE(summary.missed == 0);
+                REQUIRE(summary.last_delay == milliseconds{ 10 });
+                REQUIRE(summary.last_run_time == microseconds{ 50 });
+                REQUIRE(summary.delays.total() == 40000);
+                REQUIRE(summary.run_times.total() == 40000);
+                REQUIRE(summary.delays.value_at_quantile(0.5) >= milliseconds{ 10 });
+                REQUIRE(summary.delays.value_at_quantile(0.5) < milliseconds{ 12 });
+            }
+        }
+    }
+}
@@ -0,0 +1,274 @@
+#include <catch.hpp>
+#include <libcron/include/libcron/Cron.h>
+#include <libcron/include/libcron/TraceRecorder.h>
+#include <libcron/externals/date/include/date/date.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace libcron;
+using namespace std::chrono;
+using namespace date;
+
+namespace
+{
+    class TraceClock
+            : public ICronClock
+    {
+        public:
+            system_clock::time_point now() const override
+            {
+                return current_time;
+            }
+
+            seconds utc_offset(system_clock::time_point) const override
+            {
+                return 0s;
+            }
+
+            void add(system_clock::duration time)
+            {
+                current_time += time;
+            }
+
+        private:
+            system_clock::time_point current_time = sys_days{ 2021_y / 1 / 1 } + hours{ 10 } + seconds{ 1 };
+    };
+
+    size_t occurrences(const std::string& text, const std::string& part)
+    {
+        size_t res = 0;
+
+        for (auto pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1))
+        {
+            ++res;
+        }
+
+        return res;
+    }
+}
+
+SCENARIO("Recording trace events")
+{
+    GIVEN("A recorder")
+    {
+        TraceRecorder recorder{ 5 };
+        auto now = steady_clock::now();
+
+        THEN("Its capacity is a power of two")
+        {
+            REQUIRE(recorder.get_capacity() == 8);
+        }
+
+        WHEN("Recording a run, an expiry and a skipped run")
+        {
+            recorder.record_fire("A", now, milliseconds{ 250 });
+            recorder.record_run("A", now, microseconds{ 1500 }, milliseconds{ 250 });
+            recorder.record_skip("Quoted \"name\"", now, nanoseconds{ 1500 });
+
+            std::string json = "existing";
+            recorder.write_json(json);
+
+            THEN("They are appended as trace events")
+            {
+                REQUIRE(json.rfind("existing{\"traceEvents\":[\n", 0) == 0);
+                REQUIRE(json.compare(json.size() - 27, 27, "\n],\"displayTimeUnit\":\"ms\"}\n") == 0);
+                REQUIRE(occurrences(json, "{\"name\":\"A\",\"cat\":\"fire\",\"ph\":\"i\",\"s\":\"t\",\"ts\":") == 1);
+                REQUIRE(occurrences(json, "{\"name\":\"A\",\"cat\":\"run\",\"ph\":\"X\",\"dur\":1500.000,\"ts\":") == 1);
+                REQUIRE(occurrences(json, "\"args\":{\"delay_ms\":250.000}}") == 2);
+                REQUIRE(occurrences(json, "{\"name\":\"Quoted \\\"name\\\"\",\"cat\":\"skip\"") == 1);
+                REQUIRE(occurrences(json, "\"args\":{\"delay_ms\":0.001}}") == 1);
+                REQUIRE(recorder.get_recorded() == 3);
+            }
+        }
+
+        AND_WHEN("Recording more events than fit")
+        {
+            for (int i = 0; i < 11; ++i)
+            {
+                recorder.record_fire("Task " + std::to_string(i), now, nanoseconds{ 0 });
+            }
+
+            std::string json;
+            recorder.write_json(json);
+
+            THEN("Only the latest ones are kept, oldest first")
+            {
+                REQUIRE(recorder.get_recorded() == 11);
+                REQUIRE(occurrences(json, "\"cat\":\"fire\"") == 8);
+                REQUIRE(json.find("\"Task 2\"") == std::string::npos);
+                REQUIRE(json.find("\"Task 3\"") < json.find("\"Task 10\""));
+            }
+        }
+
+        AND_WHEN("Recording a task with a long name")
+        {
+            // The last character, two bytes in UTF-8, does not fit.
+            std::string name(TraceRecorder::NAME_SIZE - 1, 'a');
+            recorder.record_fire(name + "\xc3\xa9", now, nanoseconds{ 0 });
+
+            std::string json;
+            recorder.write_json(json);
+
+            THEN("The name is cut short between characters")
+            {
+                REQUIRE(json.find("{\"name\":\"" + name + "\",") != std::string::npos);
+            }
+        }
+    }
+
+    GIVEN("Threads recording while the events are written")
+    {
+        TraceRecorder recorder{ 64 };
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 3; ++t)
+        {
+            threads.emplace_back([&recorder]()
+                                 {
+                                     for (int i = 0; i < 2000; ++i)
+                                     {
+                                         recorder.record_run("Run", steady_clock::now(), nanoseconds{ i },
+                                                             nanoseconds{ 0 });
+                                     }
+                                 });
+        }
+
+        size_t events = 0;
+
+        for (int i = 0; i < 20; ++i)
+        {
+            std::string json;
+            recorder.write_json(json);
+            events = occurrences(json, "{\"name\":\"Run\",\"cat\":\"run\"");
+            REQUIRE(events <= 64);
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        THEN("All events are recorded, and the ring holds the latest ones")
+        {
+            std::string json;
+            recorder.write_json(json);
+            REQUIRE(recorder.get_recorded() == 6000);
+            REQUIRE(occurrences(json, "{\"name\":\"Run\",\"cat\":\"run\"") == 64);
+        }
+    }
+}
+
+SCENARIO("Tracing the tasks of a Cron instance")
+{
+    GIVEN("A Cron instance running tasks on the ticking thread")
+    {
+        Cron<TraceClock> c;
+        auto recorder = std::make_shared<TraceRecorder>();
+        c.set_trace_recorder(recorder);
+        c.add_schedule("A", "* * * * * ?", [](auto&)
+        {
+        });
+        c.add_schedule("B", "* * * * * ?", [](auto&)
+        {
+        });
+
+        WHEN("Ticking twice")
+        {
+            REQUIRE(c.tick() == 2);
+            c.get_clock().add(seconds{ 1 });
+            REQUIRE(c.tick() == 2);
+
+            THEN("Each expiry and run is recorded")
+            {
+                std::string json;
+                recorder->write_json(json);
+                REQUIRE(occurrences(json, "{\"name\":\"A\",\"cat\":\"fire\"") == 2);
+                REQUIRE(occurrences(json, "{\"name\":\"B\",\"cat\":\"run\"") == 2);
+            }
+        }
+
+        AND_WHEN("Recording is stopped")
+        {
+            c.set_trace_recorder(nullptr);
+            REQUIRE(c.tick() == 2);
+
+            THEN("Nothing is recorded")
+            {
+                REQUIRE(recorder->get_recorded() == 0);
+            }
+        }
+    }
+
+    GIVEN("A Cron instance running tasks on worker threads")
+    {
+        Cron<TraceClock, Locker, TaskQueue, ThreadPoolExecutor> c;
+        auto recorder = std::make_shared<TraceRecorder>();
+        c.set_trace_recorder(recorder);
+        std::atomic<bool> release{ false };
+
+        c.add_schedule("Slow", "* * * * * ?", [&release](auto&)
+        {
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        WHEN("Ticking while the previous run is in progress")
+        {
+            REQUIRE(c.tick() == 1);
+            c.get_clock().add(seconds{ 1 });
+            REQUIRE(c.tick() == 1);
+            release = true;
+            c.get_executor().wait_until_idle();
+
+            THEN("The expiry, the skipped run and the run are recorded")
+            {
+                std::string json;
+                recorder->write_json(json);
+                REQUIRE(occurrences(json, "{\"name\":\"Slow\",\"cat\":\"fire\"") == 1);
+                REQUIRE(occurrences(json, "{\"name\":\"Slow\",\"cat\":\"skip\"") == 1);
+                REQUIRE(occurrences(json, "{\"name\":\"Slow\",\"cat\":\"run\"") == 1);
+            }
+        }
+    }
+
+    GIVEN("A thread pool allowing a single pending run")
+    {
+        Cron<TraceClock, Locker, TaskQueue, ThreadPoolExecutor> c;
+        c.get_executor().set_max_pending(1);
+        auto recorder = std::make_shared<TraceRecorder>();
+        c.set_trace_recorder(recorder);
+        std::atomic<bool> release{ false };
+
+        c.add_schedule("Slow", "* * * * * ?", [&release](auto&)
+        {
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        WHEN("Another task expires while the run is in progress")
+        {
+            REQUIRE(c.tick() == 1);
+            c.add_schedule("Other", "* * * * * ?", [](auto&)
+            {
+            }, Overlap::Concurrent);
+            c.get_clock().add(seconds{ 1 });
+            REQUIRE(c.tick() == 2);
+            release = true;
+            c.get_executor().wait_until_idle();
+
+            THEN("Its run is recorded as skipped, without an expiry")
+            {
+                std::string json;
+                recorder->write_json(json);
+                REQUIRE(occurrences(json, "{\"name\":\"Other\",\"cat\":\"skip\"") == 1);
+                REQUIRE(occurrences(json, "{\"name\":\"Other\",\"cat\":\"fire\"") == 0);
+                REQUIRE(occurrences(json, "{\"name\":\"Other\",\"cat\":\"run\"") == 0);
+            }
+        }
+    }
+}